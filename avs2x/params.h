@@ -66,13 +66,16 @@ Parameters GetParameters(const AVSValue &args, const Signature &signature, bool
     UNUSED(env);
 
     for (int i = 0; i < signature.count(); i++) {
-      if (signature[i].getName() == "use_expr" && !has_avs_expr_support) {
+      // v2.2.31: the automatic mode 4 stays, it does not choose Expr then
+      if (signature[i].getName() == "use_expr" && !has_avs_expr_support && !(args[i].Defined() && args[i].AsInt() == 4)) {
         // v2.26 when no "Expr" support in avisynth then set use_expr to undefined (default 0)
         parameters.push_back(GetParameter(AVSValue(), signature[i]));
       }
       else
         parameters.push_back(GetParameter(args[i], signature[i]));
     }
+    // v2.2.31: for use_expr=4
+    parameters.push_back(Parameter(Value(has_avs_expr_support), "avs_expr_support", false));
 
     return parameters;
 }
@@ -0,0 +1,69 @@
+#include "contextpool.h"
+
+using namespace Filtering;
+
+namespace Filtering { namespace Parser {
+
+ContextPool::ContextPool(const std::vector<Symbol> &expression, const String &scale_inputs, int clamp_float, int cpu_flags) :
+   expression(expression), scale_inputs(scale_inputs), clamp_float(clamp_float), use_scale_inputs(true), cpu_flags(cpu_flags), profiling(false)
+{
+}
+
+ContextPool::ContextPool(const std::vector<Symbol> &expression, int cpu_flags) :
+   expression(expression), clamp_float(0), use_scale_inputs(false), cpu_flags(cpu_flags), profiling(false)
+{
+}
+
+ContextPool::~ContextPool()
+{
+   for (auto ctx : idle)
+      delete ctx;
+}
+
+Context *ContextPool::acquire()
+{
+   {
+      std::lock_guard<std::mutex> guard(lock);
+      if (!idle.empty()) {
+         Context *ctx = idle.back();
+         idle.pop_back();
+         return ctx;
+      }
+   }
+   Context *ctx = use_scale_inputs ? new Context(expression, scale_inputs, clamp_float) : new Context(expression);
+   ctx->SetCpuFlags(cpu_flags);
+   ctx->EnableProfile(profiling);
+   return ctx;
+}
+
+void ContextPool::release(Context *ctx)
+{
+   std::lock_guard<std::mutex> guard(lock);
+   if (profiling) {
+      profile.add(ctx->get_profile());
+      ctx->clear_profile();
+   }
+   idle.push_back(ctx);
+}
+
+void ContextPool::EnableProfile(bool enable)
+{
+   std::lock_guard<std::mutex> guard(lock);
+   profiling = enable;
+   for (auto ctx : idle)
+      ctx->EnableProfile(enable);
+}
+
+Context::Profile ContextPool::get_profile()
+{
+   std::lock_guard<std::mutex> guard(lock);
+   return profile;
+}
+
+void ContextPool::clear_profile()
+{
+   std::lock_guard<std::mutex> guard(lock);
+   profile.clear();
+}
+
+} } // namespace Parser, Filtering
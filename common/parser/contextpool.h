@@ -0,0 +1,61 @@
+#ifndef __Mt_ContextPool_H__
+#define __Mt_ContextPool_H__
+
+#include "../utils/utils.h"
+#include "symbol.h"
+#include <mutex>
+#include <vector>
+
+namespace Filtering { namespace Parser {
+
+// Reusable Contexts for realtime evaluation, v2.2.31
+// A Context keeps its compiled program, stack and row buffers between calls, but it cannot be used by two
+// threads at the same time. Instead of building a new Context for every plane of every frame, process() leases
+// one from the pool of its plane: an idle one, or a new one when all of them are in use by other threads.
+// There are never more Contexts than threads evaluating the same plane at once.
+class ContextPool {
+public:
+   // like Context(expression, scale_inputs, clamp_float), cpu_flags: Context::SetCpuFlags
+   ContextPool(const std::vector<Symbol> &expression, const String &scale_inputs, int clamp_float, int cpu_flags);
+   // like Context(expression)
+   ContextPool(const std::vector<Symbol> &expression, int cpu_flags);
+   ~ContextPool();
+
+   ContextPool(const ContextPool &) = delete;
+   ContextPool &operator=(const ContextPool &) = delete;
+
+   // v2.2.31: profiling of the Contexts (Context::EnableProfile), counters are collected when a lease ends
+   void EnableProfile(bool enable);
+   Context::Profile get_profile();
+   void clear_profile();
+
+   class Lease {
+   public:
+      explicit Lease(ContextPool &pool) : pool(pool), ctx(pool.acquire()) {}
+      ~Lease() { pool.release(ctx); }
+      Lease(const Lease &) = delete;
+      Lease &operator=(const Lease &) = delete;
+      Context &context() const { return *ctx; }
+   private:
+      ContextPool &pool;
+      Context *ctx;
+   };
+
+private:
+   std::vector<Symbol> expression;
+   String scale_inputs;
+   int clamp_float;
+   bool use_scale_inputs;
+   int cpu_flags;
+   std::mutex lock;
+   std::vector<Context *> idle;
+   bool profiling;
+   Context::Profile profile;
+
+   Context *acquire();
+   void release(Context *ctx);
+};
+
+} } // namespace Parser, Filtering
+
+#endif
@@ -2,11 +2,11 @@
 
 using namespace Filtering;
 
-Parser::Parser::Parser()
+Parser::Parser::Parser() : neighbours(false)
 {
 }
 
-Parser::Parser::Parser(const String &parsed_string, const String &separators)
+Parser::Parser::Parser(const String &parsed_string, const String &separators) : neighbours(false)
 {
    parse(parsed_string, separators);
 }
@@ -14,6 +14,18 @@ Parser::Parser::Parser(const String &parsed_string, const String &separators)
 Parser::Parser &Parser::Parser::addSymbol(const Symbol &symbol)
 {
    symbols.push_back(symbol);
+   // emplace keeps an existing entry: lookups find the first added symbol, as the former linear search did
+   const int index = (int)symbols.size() - 1;
+   symbol_index.emplace(symbol.value, index);
+   if (!symbol.value2.empty())
+      symbol_index.emplace(symbol.value2, index);
+
+   return *this;
+}
+
+Parser::Parser &Parser::Parser::addNeighbours()
+{
+   neighbours = true;
 
    return *this;
 }
@@ -29,34 +41,108 @@ const Parser::Symbol *Parser::Parser::findSymbol(const String &value) const
     //   'A^'..'Z^' variable store and pop from stack
     //   dupN and swapN where N is an integer 0..
     // Constants that are bit-depth dependent are changed later in a 2nd pass to constants (NUMBER)
-    for (auto &symbol: symbols) {
-      /* temporarily off
-        if (value.length >= 1) {
-          if (value[0] >= 'A' && value[0] <= 'Z')
-          {
-            // user variable related
-            if (value.length == 1)
-            {
-              const Symbol s = new Symbol("A", Symbol::VARIABLE, Symbol::);
-            }
-              
-          }
-        }
-        */
-        if (symbol.value == value || symbol.value2 == value) {
-            return &symbol;
-        }
+    // v2.2.31: hashed instead of comparing with every symbol
+    auto found = symbol_index.find(value);
+    return found == symbol_index.end() ? nullptr : &symbols[found->second];
+}
+
+// "x[-1,0]": an added input variable followed by two integer offsets, no spaces
+// "x.U": an added input variable followed by a plane letter Y, U, V or A (lower case too)
+bool Parser::Parser::findNeighbour(const String &value, Symbol &result) const
+{
+    if (neighbours && value.size() >= 3 && value[value.size() - 2] == '.') {
+      static const String plane_letters = "YUVAyuva";
+      const size_t letter = plane_letters.find(value.back());
+      auto input = findSymbol(value.substr(0, value.size() - 2));
+      if (letter == String::npos || input == nullptr || input->type != Symbol::VARIABLE || input->vartype > Symbol::VARIABLE_A)
+        return false;
+      result = Symbol::Neighbour(*input, 0, 0, (int)letter % 4);
+      return true;
+    }
+
+    const size_t open = value.find('[');
+    if (!neighbours || open == String::npos || open == 0 || value.back() != ']')
+      return false;
+    auto input = findSymbol(value.substr(0, open));
+    if (input == nullptr || input->type != Symbol::VARIABLE || input->vartype > Symbol::VARIABLE_A)
+      return false;
+
+    int offsets[2];
+    size_t pos = open + 1;
+    for (int k = 0; k < 2; k++) {
+      const char separator = k == 0 ? ',' : ']';
+      const size_t end = value.find(separator, pos);
+      if (end == String::npos || end == pos)
+        return false;
+      size_t digits = pos;
+      if (value[digits] == '-' || value[digits] == '+')
+        digits++;
+      if (digits == end || end - digits > 5 || value.find_first_not_of("0123456789", digits) < end)
+        return false;
+      offsets[k] = std::stoi(value.substr(pos, end - pos));
+      pos = end + 1;
     }
+    if (pos != value.size())
+      return false;
 
-   return nullptr;
+    result = Symbol::Neighbour(*input, offsets[0], offsets[1]);
+    return true;
+}
+
+// v2.2.31: plain decimal literals ("12", "-3", "0.25") without the locale independent stream conversion of
+// Symbol(value, NUMBER, ...), which dominates the parsing of long coordinate lists.
+// At most 15 digits: mantissa and power of ten are exact doubles, their quotient is correctly rounded
+// like the stream conversion. Anything else (exponents, more digits) is left to the stream.
+bool Parser::Parser::findNumber(const String &value, double &result)
+{
+    const size_t length = value.size();
+    size_t pos = 0;
+    bool negative = false;
+    if (pos < length && (value[pos] == '-' || value[pos] == '+'))
+      negative = value[pos++] == '-';
+
+    static const double powers_of_ten[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+    int64_t mantissa = 0;
+    int digits = 0;
+    int decimals = -1; // digits after the decimal point, -1: none
+    for (; pos < length; pos++) {
+      const char c = value[pos];
+      if (c >= '0' && c <= '9') {
+        if (++digits > 15)
+          return false;
+        mantissa = mantissa * 10 + (c - '0');
+        if (decimals >= 0)
+          decimals++;
+      }
+      else if (c == '.' && decimals < 0)
+        decimals = 0;
+      else
+        return false;
+    }
+    // "", "-", ".", "1.": the stream decides
+    if (digits == 0 || decimals == 0)
+      return false;
+
+    result = (double)mantissa;
+    if (decimals > 0)
+      result /= powers_of_ten[decimals];
+    if (negative)
+      result = -result;
+    return true;
 }
 
 Parser::Symbol Parser::Parser::stringToSymbol(const String &value, bool InvalidSymbolIsZero) const
 { 
     auto found = findSymbol(value);
-    return found == nullptr
-      ? Symbol(value, Symbol::NUMBER, InvalidSymbolIsZero)
-      : *found;
+    if (found != nullptr)
+      return *found;
+    double number;
+    if (findNumber(value, number))
+      return Symbol(value, number, Symbol::NUMBER, 0, NULL);
+    Symbol neighbour;
+    if (findNeighbour(value, neighbour))
+      return neighbour;
+    return Symbol(value, Symbol::NUMBER, InvalidSymbolIsZero);
 }
 
 // String to double conversion error yields 0 value
@@ -93,7 +179,7 @@ Parser::Parser &Parser::Parser::parse_internal(const String &_parsed_string, con
         elements.clear();
         return *this;
       }
-      elements.push_back(curr_sym);
+      elements.push_back(std::move(curr_sym));
       nPos = _parsed_string.find_first_not_of(separators, nEndPos);
    }
 
@@ -106,7 +192,7 @@ Parser::Parser &Parser::Parser::parse_internal(const String &_parsed_string, con
         elements.clear();
         return *this;
       }
-      elements.push_back(curr_sym);
+      elements.push_back(std::move(curr_sym));
    }
 
    return *this;
@@ -124,48 +210,53 @@ int Parser::Parser::count() const
 
 Parser::Parser Parser::getDefaultParser()
 {
-   Parser parser;
-
-   /* arithmetic operators */
-   parser.addSymbol(Symbol::Addition).addSymbol(Symbol::Division).addSymbol(Symbol::Multiplication).addSymbol(Symbol::Substraction).addSymbol(Symbol::Modulo).addSymbol(Symbol::Power);
-   /* comparison operators */
-   parser.addSymbol(Symbol::Equal).addSymbol(Symbol::Equal2).addSymbol(Symbol::NotEqual).addSymbol(Symbol::Inferior).addSymbol(Symbol::InferiorStrict).addSymbol(Symbol::Superior).addSymbol(Symbol::SuperiorStrict);
-   /* logic operators */
-   parser.addSymbol(Symbol::And).addSymbol(Symbol::Or).addSymbol(Symbol::AndNot).addSymbol(Symbol::Xor);
-   /* unsigned binary operators */
-   parser.addSymbol(Symbol::AndUB).addSymbol(Symbol::OrUB).addSymbol(Symbol::XorUB).addSymbol(Symbol::NegateUB).addSymbol(Symbol::PosShiftUB).addSymbol(Symbol::NegShiftUB);
-   /* signed binary operators */
-   parser.addSymbol(Symbol::AndSB).addSymbol(Symbol::OrSB).addSymbol(Symbol::XorSB).addSymbol(Symbol::NegateSB).addSymbol(Symbol::PosShiftSB).addSymbol(Symbol::NegShiftSB);
-   /* ternary operator */
-   parser.addSymbol(Symbol::Interrogation);
-   /* function */
-   parser.addSymbol(Symbol::Abs).addSymbol(Symbol::Acos).addSymbol(Symbol::Asin).addSymbol(Symbol::Atan).addSymbol(Symbol::Atan2).addSymbol(Symbol::Cos).addSymbol(Symbol::Exp).addSymbol(Symbol::Log).addSymbol(Symbol::Sin).addSymbol(Symbol::Tan).addSymbol(Symbol::Min).addSymbol(Symbol::Max).addSymbol(Symbol::Clip);
-   /* rounding */
-   parser.addSymbol(Symbol::Round).addSymbol(Symbol::Floor).addSymbol(Symbol::Trunc).addSymbol(Symbol::Ceil);
-   /* number */
-   parser.addSymbol(Symbol::Pi);
-   /* auto bitdepth conversion: BITDEPTH (bitdepth) and two functions */
-   parser.addSymbol(Symbol::BITDEPTH).addSymbol(Symbol::SCRIPT_BITDEPTH);
-   parser.addSymbol(Symbol::ScaleByShift).addSymbol(Symbol::ScaleByStretch);
-   parser.addSymbol(Symbol::ScaleByShiftY).addSymbol(Symbol::ScaleByStretchY);
-   /* swap and dup */
-   parser.addSymbol(Symbol::Swap).addSymbol(Symbol::Dup);
-   parser.addSymbol(Symbol::Dup0).addSymbol(Symbol::Dup1).addSymbol(Symbol::Dup2).addSymbol(Symbol::Dup3).addSymbol(Symbol::Dup4).addSymbol(Symbol::Dup5).addSymbol(Symbol::Dup6).addSymbol(Symbol::Dup7).addSymbol(Symbol::Dup8).addSymbol(Symbol::Dup9);
-   parser.addSymbol(Symbol::Swap1).addSymbol(Symbol::Swap2).addSymbol(Symbol::Swap3).addSymbol(Symbol::Swap4).addSymbol(Symbol::Swap5).addSymbol(Symbol::Swap6).addSymbol(Symbol::Swap7).addSymbol(Symbol::Swap8).addSymbol(Symbol::Swap9);
-   /* config commands for setting base bit depth of the script */
-   parser.addSymbol(Symbol::SetScriptBitDepthI8).addSymbol(Symbol::SetScriptBitDepthI10).addSymbol(Symbol::SetScriptBitDepthI12);
-   parser.addSymbol(Symbol::SetScriptBitDepthI14).addSymbol(Symbol::SetScriptBitDepthI16).addSymbol(Symbol::SetScriptBitDepthF32);
-   parser.addSymbol(Symbol::SetFloatToClampUseI8Range).addSymbol(Symbol::SetFloatToClampUseI10Range).addSymbol(Symbol::SetFloatToClampUseI12Range).addSymbol(Symbol::SetFloatToClampUseI14Range);
-   parser.addSymbol(Symbol::SetFloatToClampUseI16Range).addSymbol(Symbol::SetFloatToClampUseF32Range).addSymbol(Symbol::SetFloatToClampUseF32Range_2);
-   /* special bit-depth adaptive constants */
-   parser.addSymbol(Symbol::RANGE_HALF).addSymbol(Symbol::RANGE_MIN).addSymbol(Symbol::RANGE_MAX).addSymbol(Symbol::YRANGE_HALF).addSymbol(Symbol::YRANGE_MIN).addSymbol(Symbol::YRANGE_MAX).addSymbol(Symbol::RANGE_SIZE);
-   parser.addSymbol(Symbol::YMIN).addSymbol(Symbol::YMAX);
-   parser.addSymbol(Symbol::CMIN).addSymbol(Symbol::CMAX);
-
-   /* Symbol X, X and Y, X and Y and Z are added additionally at before processing lut expression */
-   /* like this:       
-      Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y);
-  */
-
-   return parser;
-}
\ No newline at end of file
+   // v2.2.31: the symbol table is built once, every filter gets a copy of it
+   static const Parser defaultParser = [] {
+      Parser parser;
+
+      /* arithmetic operators */
+      parser.addSymbol(Symbol::Addition).addSymbol(Symbol::Division).addSymbol(Symbol::Multiplication).addSymbol(Symbol::Substraction).addSymbol(Symbol::Modulo).addSymbol(Symbol::Power);
+      /* comparison operators */
+      parser.addSymbol(Symbol::Equal).addSymbol(Symbol::Equal2).addSymbol(Symbol::NotEqual).addSymbol(Symbol::Inferior).addSymbol(Symbol::InferiorStrict).addSymbol(Symbol::Superior).addSymbol(Symbol::SuperiorStrict);
+      /* logic operators */
+      parser.addSymbol(Symbol::And).addSymbol(Symbol::Or).addSymbol(Symbol::AndNot).addSymbol(Symbol::Xor);
+      /* unsigned binary operators */
+      parser.addSymbol(Symbol::AndUB).addSymbol(Symbol::OrUB).addSymbol(Symbol::XorUB).addSymbol(Symbol::NegateUB).addSymbol(Symbol::PosShiftUB).addSymbol(Symbol::NegShiftUB);
+      /* signed binary operators */
+      parser.addSymbol(Symbol::AndSB).addSymbol(Symbol::OrSB).addSymbol(Symbol::XorSB).addSymbol(Symbol::NegateSB).addSymbol(Symbol::PosShiftSB).addSymbol(Symbol::NegShiftSB);
+      /* ternary operator */
+      parser.addSymbol(Symbol::Interrogation);
+      /* function */
+      parser.addSymbol(Symbol::Abs).addSymbol(Symbol::Acos).addSymbol(Symbol::Asin).addSymbol(Symbol::Atan).addSymbol(Symbol::Atan2).addSymbol(Symbol::Cos).addSymbol(Symbol::Exp).addSymbol(Symbol::Log).addSymbol(Symbol::Sin).addSymbol(Symbol::Tan).addSymbol(Symbol::Min).addSymbol(Symbol::Max).addSymbol(Symbol::Clip);
+      /* rounding */
+      parser.addSymbol(Symbol::Round).addSymbol(Symbol::Floor).addSymbol(Symbol::Trunc).addSymbol(Symbol::Ceil);
+      /* number */
+      parser.addSymbol(Symbol::Pi);
+      /* auto bitdepth conversion: BITDEPTH (bitdepth) and two functions */
+      parser.addSymbol(Symbol::BITDEPTH).addSymbol(Symbol::SCRIPT_BITDEPTH);
+      parser.addSymbol(Symbol::ScaleByShift).addSymbol(Symbol::ScaleByStretch);
+      parser.addSymbol(Symbol::ScaleByShiftY).addSymbol(Symbol::ScaleByStretchY);
+      /* swap and dup */
+      parser.addSymbol(Symbol::Swap).addSymbol(Symbol::Dup);
+      parser.addSymbol(Symbol::Dup0).addSymbol(Symbol::Dup1).addSymbol(Symbol::Dup2).addSymbol(Symbol::Dup3).addSymbol(Symbol::Dup4).addSymbol(Symbol::Dup5).addSymbol(Symbol::Dup6).addSymbol(Symbol::Dup7).addSymbol(Symbol::Dup8).addSymbol(Symbol::Dup9);
+      parser.addSymbol(Symbol::Swap1).addSymbol(Symbol::Swap2).addSymbol(Symbol::Swap3).addSymbol(Symbol::Swap4).addSymbol(Symbol::Swap5).addSymbol(Symbol::Swap6).addSymbol(Symbol::Swap7).addSymbol(Symbol::Swap8).addSymbol(Symbol::Swap9);
+      /* config commands for setting base bit depth of the script */
+      parser.addSymbol(Symbol::SetScriptBitDepthI8).addSymbol(Symbol::SetScriptBitDepthI10).addSymbol(Symbol::SetScriptBitDepthI12);
+      parser.addSymbol(Symbol::SetScriptBitDepthI14).addSymbol(Symbol::SetScriptBitDepthI16).addSymbol(Symbol::SetScriptBitDepthF32);
+      parser.addSymbol(Symbol::SetFloatToClampUseI8Range).addSymbol(Symbol::SetFloatToClampUseI10Range).addSymbol(Symbol::SetFloatToClampUseI12Range).addSymbol(Symbol::SetFloatToClampUseI14Range);
+      parser.addSymbol(Symbol::SetFloatToClampUseI16Range).addSymbol(Symbol::SetFloatToClampUseF32Range).addSymbol(Symbol::SetFloatToClampUseF32Range_2);
+      /* special bit-depth adaptive constants */
+      parser.addSymbol(Symbol::RANGE_HALF).addSymbol(Symbol::RANGE_MIN).addSymbol(Symbol::RANGE_MAX).addSymbol(Symbol::YRANGE_HALF).addSymbol(Symbol::YRANGE_MIN).addSymbol(Symbol::YRANGE_MAX).addSymbol(Symbol::RANGE_SIZE);
+      parser.addSymbol(Symbol::YMIN).addSymbol(Symbol::YMAX);
+      parser.addSymbol(Symbol::CMIN).addSymbol(Symbol::CMAX);
+
+      /* Symbol X, X and Y, X and Y and Z are added additionally at before processing lut expression */
+      /* like this:       
+         Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y);
+     */
+
+      return parser;
+   }();
+
+   return defaultParser;
+}
@@ -3,7 +3,9 @@
 
 #include "../utils/utils.h"
 #include "symbol.h"
-#include <deque>
+#include "contextpool.h"
+#include <unordered_map>
+#include <vector>
 
 namespace Filtering { namespace Parser {
 
@@ -14,8 +16,11 @@ class Parser {
    String parsed_string;
    String error_string;
    int err_pos;
-   std::deque<Symbol> elements;
-   std::deque<Symbol> symbols;
+   std::vector<Symbol> elements;
+   std::vector<Symbol> symbols;
+   // v2.2.31: index of the symbols by value and value2, the first added one wins
+   std::unordered_map<String, int> symbol_index;
+   bool neighbours; // v2.2.31: x[dx,dy] and x.Y operands of the input variables
 
 public:
    Parser();
@@ -23,8 +28,13 @@ public:
 
 public:
    Parser &addSymbol(const Symbol &symbol);
+   // accept relative pixel operands of the added input variables: x[-1,0], y[0,1] (Symbol::VARIABLE_NEIGHBOUR)
+   // and their other planes: x.Y, y.U, x.V, x.A
+   Parser &addNeighbours();
 private:
    const Symbol *findSymbol(const String &value) const;
+   bool findNeighbour(const String &value, Symbol &result) const;
+   static bool findNumber(const String &value, double &result);
    Symbol stringToSymbol(const String &value, bool InvalidSymbolIsZero) const;
    Parser& parse_internal(const String& _parsed_string, const String& separators, bool InvalidSymbolIsZero);
 public:
@@ -36,7 +46,7 @@ public:
    int getErrorPos() const { return err_pos; }
    String getFailedSymbol() const { return error_string; }
 
-   std::deque<Symbol> &getExpression() { return elements; }
+   std::vector<Symbol> &getExpression() { return elements; }
 
 };
 Parser getDefaultParser();
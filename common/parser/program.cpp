@@ -0,0 +1,830 @@
+#include "program.h"
+#include "symbol.h"
+#include "vmath.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace Filtering;
+using namespace Filtering::Parser;
+
+namespace {
+
+// unused operands are 0, they are part of the node key
+Program::Op make_op(Program::OpCode code, int src1 = 0, int src2 = 0, int src3 = 0)
+{
+   Program::Op op;
+   op.code = code;
+   op.dst = 0;
+   op.src1 = src1;
+   op.src2 = src2;
+   op.src3 = src3;
+   op.value = 0.0;
+   op.math = 0;
+   op.process0 = nullptr;
+   op.process1 = nullptr;
+   op.process2 = nullptr;
+   op.process3 = nullptr;
+   op.processScale = nullptr;
+   return op;
+}
+
+// number of value operands, returned in src
+int get_sources(const Program::Op &op, int *src)
+{
+   switch (op.code) {
+   case Program::OP_CONST: case Program::OP_INPUT: case Program::OP_CALL0:
+      return 0;
+   case Program::OP_ADD: case Program::OP_SUB: case Program::OP_MUL: case Program::OP_DIV:
+   case Program::OP_MIN: case Program::OP_MAX:
+   case Program::OP_EQ: case Program::OP_NE: case Program::OP_LE: case Program::OP_LT: case Program::OP_GE: case Program::OP_GT:
+   case Program::OP_AND: case Program::OP_OR: case Program::OP_ANDNOT: case Program::OP_XOR:
+   case Program::OP_CALL2:
+      src[0] = op.src1;
+      src[1] = op.src2;
+      return 2;
+   case Program::OP_MATH:
+      src[0] = op.src1;
+      src[1] = op.src2;
+      return VMath::arguments(op.math);
+   case Program::OP_TERNARY: case Program::OP_CLIP: case Program::OP_CALL3:
+      src[0] = op.src1;
+      src[1] = op.src2;
+      src[2] = op.src3;
+      return 3;
+   default: // unary functions, SCALE
+      src[0] = op.src1;
+      return 1;
+   }
+}
+
+// the functions of vmath.h, -1 for the others
+int math_function(const Symbol &s)
+{
+   if (s.nParameter == 1) {
+      if (s.process1 == Symbol::Exp.process1) return VMath::EXP;
+      if (s.process1 == Symbol::Log.process1) return VMath::LOG;
+      if (s.process1 == Symbol::Sin.process1) return VMath::SIN;
+      if (s.process1 == Symbol::Cos.process1) return VMath::COS;
+      if (s.process1 == Symbol::Tan.process1) return VMath::TAN;
+      if (s.process1 == Symbol::Asin.process1) return VMath::ASIN;
+      if (s.process1 == Symbol::Acos.process1) return VMath::ACOS;
+      if (s.process1 == Symbol::Atan.process1) return VMath::ATAN;
+   }
+   else if (s.nParameter == 2) {
+      if (s.process2 == Symbol::Power.process2) return VMath::POW;
+      if (s.process2 == Symbol::Atan2.process2) return VMath::ATAN2;
+   }
+   return -1;
+}
+
+} // namespace
+
+Program::Program() : nRegisters(0), nResult(0), result_id(0), input_mask(0), compute_error(Context::CE_NONE),
+integer_input_max(-1), integer_valid(false),
+bitdepth(8), sbitdepth(8), chroma(false), shift_float(false), integer_inputs(false)
+{
+}
+
+// Returns the id of an existing node with the same operation and operands if there is one
+int Program::add_node(const Op &op, bool maybe_negzero)
+{
+   Uint64 value_bits;
+   memcpy(&value_bits, &op.value, sizeof(value_bits)); // 0.0 and -0.0 are different constants
+   void *process = op.process0 ? reinterpret_cast<void *>(op.process0) :
+      op.process1 ? reinterpret_cast<void *>(op.process1) :
+      op.process2 ? reinterpret_cast<void *>(op.process2) :
+      op.process3 ? reinterpret_cast<void *>(op.process3) :
+      reinterpret_cast<void *>(op.processScale);
+   const auto key = std::make_tuple((int)op.code, op.src1, op.src2, op.src3, value_bits, process);
+
+   auto it = node_ids.find(key);
+   if (it != node_ids.end())
+      return it->second;
+
+   Node node;
+   node.op = op;
+   node.maybe_negzero = maybe_negzero;
+   nodes.push_back(node);
+   const int id = (int)nodes.size() - 1;
+   node_ids[key] = id;
+   return id;
+}
+
+int Program::add_op(OpCode opcode, int src1, int src2, int src3)
+{
+   switch (opcode) {
+   case OP_ADD: case OP_MUL: case OP_EQ: case OP_NE: case OP_AND: case OP_OR: case OP_XOR:
+      // operand order does not matter: "x y +" and "y x +" are the same value
+      if (src1 > src2)
+         std::swap(src1, src2);
+      break;
+   default:
+      break;
+   }
+
+   bool maybe_negzero;
+   switch (opcode) {
+   case OP_EQ: case OP_NE: case OP_LE: case OP_LT: case OP_GE: case OP_GT:
+   case OP_AND: case OP_OR: case OP_ANDNOT: case OP_XOR:
+   case OP_ABS:
+      maybe_negzero = false;
+      break;
+   case OP_ADD:
+      maybe_negzero = nodes[src1].maybe_negzero && nodes[src2].maybe_negzero;
+      break;
+   case OP_MIN: case OP_MAX:
+      maybe_negzero = nodes[src1].maybe_negzero || nodes[src2].maybe_negzero;
+      break;
+   case OP_TERNARY:
+      maybe_negzero = nodes[src2].maybe_negzero || nodes[src3].maybe_negzero;
+      break;
+   default:
+      maybe_negzero = true;
+      break;
+   }
+
+   return add_node(make_op(opcode, src1, src2, src3), maybe_negzero);
+}
+
+int Program::add_const(double value)
+{
+   Op op = make_op(OP_CONST);
+   op.value = value;
+   return add_node(op, value == 0.0 && std::signbit(value));
+}
+
+// -1: undefined internal variable
+int Program::add_variable(const Symbol &s, const double *variables)
+{
+   switch (s.vartype) {
+   case Symbol::VARIABLE_X: return add_node(make_op(OP_INPUT, 0), !integer_inputs);
+   case Symbol::VARIABLE_Y: return add_node(make_op(OP_INPUT, 1), !integer_inputs);
+   case Symbol::VARIABLE_Z: return add_node(make_op(OP_INPUT, 2), !integer_inputs);
+   case Symbol::VARIABLE_A: return add_node(make_op(OP_INPUT, 3), !integer_inputs);
+   case Symbol::VARIABLE_NEIGHBOUR: return add_node(make_op(OP_INPUT, 4 + s.iValue), !integer_inputs);
+   case Symbol::VARIABLE_UNDEFINED: return -1;
+   default:
+      return add_const(variables[s.vartype]);
+   }
+}
+
+// Constant operands: evaluated now with the same function as rec_compute.
+// Identities return the other operand. -1: nothing to simplify
+int Program::fold_function(const Symbol &s, int src1, int src2, int src3)
+{
+   switch (s.nParameter) {
+   case 1:
+      if (is_const(src1))
+         return add_const(s.process1(const_value(src1)));
+      return -1;
+   case 2:
+   {
+      const bool const1 = is_const(src1);
+      const bool const2 = is_const(src2);
+      const double a = const1 ? const_value(src1) : 0.0;
+      const double b = const2 ? const_value(src2) : 0.0;
+      if (const1 && const2) {
+         // integer modulo by zero (or overflow) is left for the pixel, as before
+         if (s.process2 == Symbol::Modulo.process2) {
+            const Int64 divisor = convert<Int64, double>(b);
+            if (divisor == 0 || divisor == -1)
+               return -1;
+         }
+         return add_const(s.process2(a, b));
+      }
+      if (s.process2 == Symbol::Multiplication.process2) {
+         if (const2 && b == 1.0) return src1;
+         if (const1 && a == 1.0) return src2;
+      }
+      else if (s.process2 == Symbol::Division.process2) {
+         if (const2 && b == 1.0) return src1;
+      }
+      else if (s.process2 == Symbol::Addition.process2) {
+         // -0.0 + 0.0 is 0.0
+         if (const2 && b == 0.0 && (std::signbit(b) || !nodes[src1].maybe_negzero)) return src1;
+         if (const1 && a == 0.0 && (std::signbit(a) || !nodes[src2].maybe_negzero)) return src2;
+      }
+      else if (s.process2 == Symbol::Substraction.process2) {
+         if (const2 && b == 0.0 && !std::signbit(b)) return src1;
+      }
+      return -1;
+   }
+   case 3:
+      if (is_const(src1) && is_const(src2) && is_const(src3))
+         return add_const(s.process3(const_value(src1), const_value(src2), const_value(src3)));
+      // both branches are evaluated by rec_compute, functions have no side effects
+      if (s.process3 == Symbol::Interrogation.process3 && is_const(src1))
+         return const_value(src1) > 0 ? src2 : src3;
+      return -1;
+   default:
+      return -1;
+   }
+}
+
+// Operators and functions are recognized by their process pointers, the symbol names have aliases
+int Program::add_function(const Symbol &s, int src1, int src2, int src3)
+{
+   const int folded = fold_function(s, src1, src2, src3);
+   if (folded >= 0)
+      return folded;
+
+   Op op;
+   const int math = math_function(s);
+   if (math >= 0) {
+      // the process pointer stays for the node key and the double precision runners
+      op = make_op(OP_MATH, src1, s.nParameter == 2 ? src2 : 0);
+      op.math = math;
+      if (s.nParameter == 2)
+         op.process2 = s.process2;
+      else
+         op.process1 = s.process1;
+      return add_node(op, true);
+   }
+
+   switch (s.nParameter) {
+   case 1:
+      if (s.process1 == Symbol::Abs.process1) return add_op(OP_ABS, src1);
+      if (s.process1 == Symbol::Floor.process1) return add_op(OP_FLOOR, src1);
+      if (s.process1 == Symbol::Ceil.process1) return add_op(OP_CEIL, src1);
+      // trunc and round keep the scalar function for out of range values
+      if (s.process1 == Symbol::Trunc.process1) op = make_op(OP_TRUNC, src1);
+      else if (s.process1 == Symbol::Round.process1) op = make_op(OP_ROUND, src1);
+      else op = make_op(OP_CALL1, src1);
+      op.process1 = s.process1;
+      return add_node(op, op.code == OP_CALL1);
+   case 2:
+      if (s.process2 == Symbol::Addition.process2) return add_op(OP_ADD, src1, src2);
+      if (s.process2 == Symbol::Substraction.process2) return add_op(OP_SUB, src1, src2);
+      if (s.process2 == Symbol::Multiplication.process2) return add_op(OP_MUL, src1, src2);
+      if (s.process2 == Symbol::Division.process2) return add_op(OP_DIV, src1, src2);
+      if (s.process2 == Symbol::Min.process2) return add_op(OP_MIN, src1, src2);
+      if (s.process2 == Symbol::Max.process2) return add_op(OP_MAX, src1, src2);
+      if (s.process2 == Symbol::Equal.process2) return add_op(OP_EQ, src1, src2);
+      if (s.process2 == Symbol::NotEqual.process2) return add_op(OP_NE, src1, src2);
+      if (s.process2 == Symbol::Inferior.process2) return add_op(OP_LE, src1, src2);
+      if (s.process2 == Symbol::InferiorStrict.process2) return add_op(OP_LT, src1, src2);
+      if (s.process2 == Symbol::Superior.process2) return add_op(OP_GE, src1, src2);
+      if (s.process2 == Symbol::SuperiorStrict.process2) return add_op(OP_GT, src1, src2);
+      if (s.process2 == Symbol::And.process2) return add_op(OP_AND, src1, src2);
+      if (s.process2 == Symbol::Or.process2) return add_op(OP_OR, src1, src2);
+      if (s.process2 == Symbol::AndNot.process2) return add_op(OP_ANDNOT, src1, src2);
+      if (s.process2 == Symbol::Xor.process2) return add_op(OP_XOR, src1, src2);
+      op = make_op(OP_CALL2, src1, src2);
+      op.process2 = s.process2;
+      return add_node(op, true);
+   case 3:
+      if (s.process3 == Symbol::Interrogation.process3) return add_op(OP_TERNARY, src1, src2, src3);
+      if (s.process3 == Symbol::Clip.process3) return add_op(OP_CLIP, src1, src2, src3);
+      op = make_op(OP_CALL3, src1, src2, src3);
+      op.process3 = s.process3;
+      return add_node(op, true);
+   default:
+      op = make_op(OP_CALL0);
+      op.process0 = s.process0;
+      return add_node(op, true);
+   }
+}
+
+// Mirrors Context::rec_compute on a stack of value ids, 'last' is the topmost one.
+void Program::compile(const std::vector<Symbol> &symbols, const double *variables, int _bitdepth, int _sbitdepth, bool _chroma, bool _shift_float, bool _integer_inputs)
+{
+   nodes.clear();
+   node_ids.clear();
+   compute_error = Context::CE_NONE;
+   integer_input_max = -1;
+   bitdepth = _bitdepth;
+   sbitdepth = _sbitdepth;
+   chroma = _chroma;
+   shift_float = _shift_float;
+   integer_inputs = _integer_inputs;
+
+   // return 0 on empty expression (not error!)
+   if (symbols.size() == 0) {
+      allocate_registers(add_const(0.0));
+      return;
+   }
+
+   std::vector<int> stack;
+
+   const Symbol &s_first = symbols[0];
+   switch (s_first.type)
+   {
+   case Symbol::NUMBER: stack.push_back(add_const(s_first.dValue)); break;
+   case Symbol::VARIABLE:
+   {
+      const int id = add_variable(s_first, variables);
+      if (id < 0) {
+         compute_error = Context::CE_INVALID_INTERNAL_VARIABLE; // this is internal error, cannot happen
+         stack.push_back(add_const(0.0));
+      }
+      else
+         stack.push_back(id);
+      break;
+   }
+   default:
+      compute_error = Context::CE_INVALID_FIRST_TAG;
+      allocate_registers(add_const(0.0));
+      return;
+   }
+
+   for (int i = 1; i < (int)symbols.size(); i++) {
+      const Symbol &s = symbols[i];
+      const int top = (int)stack.size() - 1;
+
+      switch (s.type)
+      {
+      case Symbol::NUMBER:
+         stack.push_back(add_const(s.dValue));
+         break;
+
+      case Symbol::VARIABLE:
+      {
+         const int id = add_variable(s, variables);
+         stack.push_back(id < 0 ? stack[top] : id); // 'last' is kept
+         break;
+      }
+
+      case Symbol::DUP:
+      {
+         const int distance = s.nParameter;
+         if (distance != 0) {
+            const int newptr = top - distance;
+            if (newptr < 0) {
+               compute_error = Context::CE_DUP_INDEX;
+               stack[top] = add_const(0.0);
+            }
+            else
+               stack[top] = stack[newptr]; // 'last' is overwritten, as in rec_compute
+         }
+         stack.push_back(stack[top]);
+         break;
+      }
+
+      case Symbol::SWAP:
+      {
+         const int newptr = top - s.nParameter;
+         if (newptr < 0) {
+            compute_error = Context::CE_SWAP_INDEX;
+            stack[top] = add_const(0.0);
+         }
+         else
+            std::swap(stack[top], stack[newptr]);
+         break;
+      }
+
+      case Symbol::FUNCTION_WITH_BITDEPTH_AS_AUTOPARAM:
+         if (is_const(stack[top]))
+            stack[top] = add_const(s.processScale(const_value(stack[top]), bitdepth, sbitdepth, chroma, shift_float));
+         else {
+            Op op = make_op(OP_SCALE, stack[top]);
+            op.processScale = s.processScale;
+            stack[top] = add_node(op, true);
+         }
+         break;
+
+      // OPERATOR, FUNCTION, TERNARY
+      default:
+         switch (s.nParameter)
+         {
+         case 2:
+            if (top >= 1) {
+               const int id = add_function(s, stack[top - 1], stack[top], 0);
+               stack.pop_back();
+               stack.back() = id;
+            }
+            else {
+               compute_error = Context::CE_NOT_ENOUGH_OPERANDS;
+               stack[top] = add_const(0.0);
+            }
+            break;
+         case 1:
+            stack[top] = add_function(s, stack[top], 0, 0);
+            break;
+         case 3:
+            if (top >= 2) {
+               const int id = add_function(s, stack[top - 2], stack[top - 1], stack[top]);
+               stack.pop_back();
+               stack.pop_back();
+               stack.back() = id;
+            }
+            else {
+               compute_error = Context::CE_NOT_ENOUGH_OPERANDS;
+               stack[top] = add_const(0.0);
+            }
+            break;
+         default: // function with zero parameters
+            stack.push_back(add_function(s, 0, 0, 0));
+            break;
+         }
+      }
+   }
+
+   allocate_registers(stack.back());
+}
+
+// Only the values the result depends on are calculated, in id order (operands first).
+// A register is released after the last read of its value and can be the destination
+// of the same instruction: every opcode reads a lane before writing it.
+void Program::allocate_registers(int result)
+{
+   const int count = (int)nodes.size();
+   int src[3];
+
+   std::vector<bool> needed(count, false);
+   needed[result] = true;
+   for (int id = result; id >= 0; id--) {
+      if (!needed[id])
+         continue;
+      const int n = get_sources(nodes[id].op, src);
+      for (int k = 0; k < n; k++)
+         needed[src[k]] = true;
+   }
+
+   std::vector<int> last_use(count, -1);
+   for (int id = 0; id < count; id++) {
+      if (!needed[id])
+         continue;
+      const int n = get_sources(nodes[id].op, src);
+      for (int k = 0; k < n; k++)
+         last_use[src[k]] = id;
+   }
+   last_use[result] = count; // kept until the end
+
+   std::vector<int> reg(count, -1);
+   std::vector<bool> reg_busy;
+   code.clear();
+   input_mask = 0;
+   for (int id = 0; id < count; id++) {
+      if (!needed[id])
+         continue;
+      Op op = nodes[id].op;
+      if (op.code == OP_INPUT)
+         input_mask |= 1 << op.src1;
+      const int n = get_sources(op, src);
+      for (int k = 0; k < n; k++)
+         if (last_use[src[k]] == id)
+            reg_busy[reg[src[k]]] = false;
+      int r = 0;
+      while (r < (int)reg_busy.size() && reg_busy[r])
+         r++;
+      if (r == (int)reg_busy.size())
+         reg_busy.push_back(false);
+      reg_busy[r] = true;
+      reg[id] = r;
+
+      op.dst = r;
+      if (n >= 1) op.src1 = reg[src[0]];
+      if (n >= 2) op.src2 = reg[src[1]];
+      if (n >= 3) op.src3 = reg[src[2]];
+      code.push_back(op);
+   }
+
+   nRegisters = (int)reg_busy.size();
+   nResult = reg[result];
+   result_id = result;
+}
+
+namespace {
+
+bool is_single(int deps) { return deps != 0 && (deps & (deps - 1)) == 0; }
+
+int input_index(int deps)
+{
+   int k = 0;
+   while (!(deps & (1 << k)))
+      k++;
+   return k;
+}
+
+// integer combinations, exact in double as well
+bool is_combine(const Program::Op &op, const std::vector<int> &deps)
+{
+   if (op.code != Program::OP_ADD && op.code != Program::OP_SUB && op.code != Program::OP_MIN && op.code != Program::OP_MAX)
+      return false;
+   return deps[op.src1] != 0 && deps[op.src2] != 0 && (deps[op.src1] & deps[op.src2]) == 0;
+}
+
+} // namespace
+
+// "x 3 * y 5 * + 8 /": leaves "x 3 *" and "y 5 *", combined by OP_ADD, tail "8 /"
+bool Program::find_separable(Separable &form) const
+{
+   const int count = (int)nodes.size();
+   int src[3];
+
+   // inputs every value depends on
+   std::vector<int> deps(count, 0);
+   for (int id = 0; id < count; id++) {
+      const Op &op = nodes[id].op;
+      if (op.code == OP_INPUT)
+         deps[id] = 1 << op.src1;
+      const int n = get_sources(op, src);
+      for (int k = 0; k < n; k++)
+         deps[id] |= deps[src[k]];
+   }
+
+   // the tail: every operation has a single varying operand
+   int id = result_id;
+   while (!is_combine(nodes[id].op, deps)) {
+      if (deps[id] == 0 || is_single(deps[id]))
+         return false;
+      const int n = get_sources(nodes[id].op, src);
+      int next = -1;
+      for (int k = 0; k < n; k++) {
+         if (deps[src[k]] == 0)
+            continue;
+         if (next >= 0)
+            return false;
+         next = src[k];
+      }
+      id = next;
+   }
+
+   form.combined = id;
+   form.nLeaves = 0;
+   return add_leaves(id, deps, form);
+}
+
+bool Program::add_leaves(int id, const std::vector<int> &deps, Separable &form) const
+{
+   const Op &op = nodes[id].op;
+   int leaf;
+   bool reversed;
+   if (is_single(deps[op.src1]) && is_single(deps[op.src2])) {
+      const int k = form.nLeaves++;
+      form.leaf[k] = op.src1;
+      form.input[k] = input_index(deps[op.src1]);
+      leaf = op.src2;
+      reversed = false;
+   }
+   else if (is_single(deps[op.src2]) && is_combine(nodes[op.src1].op, deps)) {
+      if (!add_leaves(op.src1, deps, form))
+         return false;
+      leaf = op.src2;
+      reversed = false;
+   }
+   else if (is_single(deps[op.src1]) && is_combine(nodes[op.src2].op, deps)) {
+      if (!add_leaves(op.src2, deps, form))
+         return false;
+      leaf = op.src1;
+      reversed = true;
+   }
+   else
+      return false;
+
+   const int k = form.nLeaves++;
+   form.leaf[k] = leaf;
+   form.input[k] = input_index(deps[leaf]);
+   form.op[k] = op.code;
+   form.reversed[k] = reversed;
+   return true;
+}
+
+void Program::select_result(int id)
+{
+   allocate_registers(id);
+}
+
+void Program::replace_with_input(int id)
+{
+   nodes[id].op = make_op(OP_INPUT, 0);
+   allocate_registers(result_id);
+}
+
+namespace {
+
+const double INT_LIMIT = 2147483647.0;
+
+struct Interval {
+   double lo, hi;
+};
+
+// smallest power of two above m
+double bit_range(double m)
+{
+   double p = 1.0;
+   while (p <= m)
+      p *= 2.0;
+   return p;
+}
+
+} // namespace
+
+// Interval analysis over the register code: every value must be an integer with bounds inside int32,
+// then int32 arithmetic gives the same values as double. -0.0 does not matter without division and
+// lane by lane functions, NaN and infinity cannot occur.
+bool Program::check_integer(int input_max)
+{
+   if (input_max == integer_input_max)
+      return integer_valid;
+   integer_input_max = input_max;
+   integer_valid = false;
+   int_code.clear();
+
+   std::vector<Interval> range(nRegisters, Interval { 0.0, 0.0 });
+   std::vector<bool> reg_const(nRegisters, false);
+   std::vector<double> reg_value(nRegisters, 0.0);
+
+   for (auto &op : code) {
+      IntOp iop;
+      iop.dst = op.dst;
+      iop.src1 = op.src1;
+      iop.src2 = op.src2;
+      iop.src3 = op.src3;
+      iop.value = 0;
+      const Interval a = range[op.src1];
+      const Interval b = range[op.src2];
+      const Interval c = range[op.src3];
+      Interval r = { -1.0, 1.0 }; // bool results
+      bool constant = false;
+
+      switch (op.code) {
+      case OP_CONST:
+         if (!(std::fabs(op.value) <= INT_LIMIT) || op.value != std::floor(op.value))
+            return false;
+         iop.code = IOP_CONST;
+         iop.value = (int)op.value;
+         r = { op.value, op.value };
+         constant = true;
+         break;
+      case OP_INPUT: iop.code = IOP_INPUT; r = { 0.0, (double)input_max }; break;
+      case OP_ADD: iop.code = IOP_ADD; r = { a.lo + b.lo, a.hi + b.hi }; break;
+      case OP_SUB: iop.code = IOP_SUB; r = { a.lo - b.hi, a.hi - b.lo }; break;
+      case OP_MUL:
+      {
+         iop.code = IOP_MUL;
+         const double p1 = a.lo * b.lo, p2 = a.lo * b.hi, p3 = a.hi * b.lo, p4 = a.hi * b.hi;
+         r = { std::min(std::min(p1, p2), std::min(p3, p4)), std::max(std::max(p1, p2), std::max(p3, p4)) };
+         break;
+      }
+      case OP_MIN: iop.code = IOP_MIN; r = { std::min(a.lo, b.lo), std::min(a.hi, b.hi) }; break;
+      case OP_MAX: iop.code = IOP_MAX; r = { std::max(a.lo, b.lo), std::max(a.hi, b.hi) }; break;
+      case OP_EQ: iop.code = IOP_EQ; break;
+      case OP_NE: iop.code = IOP_NE; break;
+      case OP_LE: iop.code = IOP_LE; break;
+      case OP_LT: iop.code = IOP_LT; break;
+      case OP_GE: iop.code = IOP_GE; break;
+      case OP_GT: iop.code = IOP_GT; break;
+      case OP_AND: iop.code = IOP_AND; break;
+      case OP_OR: iop.code = IOP_OR; break;
+      case OP_ANDNOT: iop.code = IOP_ANDNOT; break;
+      case OP_XOR: iop.code = IOP_XOR; break;
+      case OP_ABS:
+         iop.code = IOP_ABS;
+         r = { a.lo >= 0 ? a.lo : a.hi <= 0 ? -a.hi : 0.0, std::max(std::fabs(a.lo), std::fabs(a.hi)) };
+         break;
+      case OP_FLOOR: case OP_CEIL: case OP_TRUNC: case OP_ROUND:
+         iop.code = IOP_COPY;
+         r = a;
+         break;
+      case OP_TERNARY: iop.code = IOP_TERNARY; r = { std::min(b.lo, c.lo), std::max(b.hi, c.hi) }; break;
+      case OP_CLIP: iop.code = IOP_CLIP; r = { std::min(c.lo, std::max(b.lo, a.lo)), std::min(c.hi, std::max(b.hi, a.hi)) }; break;
+      case OP_CALL1:
+         if (op.process1 != Symbol::NegateSB.process1)
+            return false;
+         iop.code = IOP_BITNOT;
+         r = { -a.hi - 1.0, -a.lo - 1.0 };
+         break;
+      case OP_CALL2:
+      {
+         const bool unsigned_op = op.process2 == Symbol::AndUB.process2 || op.process2 == Symbol::OrUB.process2 ||
+            op.process2 == Symbol::XorUB.process2 || op.process2 == Symbol::PosShiftUB.process2 || op.process2 == Symbol::NegShiftUB.process2;
+         // negative values are clipped to 0 by the unsigned operators
+         if (unsigned_op && a.lo < 0)
+            return false;
+
+         if (op.process2 == Symbol::AndUB.process2 || op.process2 == Symbol::OrUB.process2 || op.process2 == Symbol::XorUB.process2 ||
+            op.process2 == Symbol::AndSB.process2 || op.process2 == Symbol::OrSB.process2 || op.process2 == Symbol::XorSB.process2) {
+            if (unsigned_op && b.lo < 0)
+               return false;
+            const bool is_and = op.process2 == Symbol::AndUB.process2 || op.process2 == Symbol::AndSB.process2;
+            const bool is_or = op.process2 == Symbol::OrUB.process2 || op.process2 == Symbol::OrSB.process2;
+            iop.code = is_and ? IOP_BITAND : is_or ? IOP_BITOR : IOP_BITXOR;
+            const double p = bit_range(std::max(std::max(std::fabs(a.lo), std::fabs(a.hi)), std::max(std::fabs(b.lo), std::fabs(b.hi))));
+            if (a.lo >= 0 && b.lo >= 0)
+               r = { 0.0, is_and ? std::min(a.hi, b.hi) : p - 1.0 };
+            else
+               r = { -p, p - 1.0 };
+            break;
+         }
+
+         const bool pos_shift = op.process2 == Symbol::PosShiftUB.process2 || op.process2 == Symbol::PosShiftSB.process2;
+         const bool neg_shift = op.process2 == Symbol::NegShiftUB.process2 || op.process2 == Symbol::NegShiftSB.process2;
+         if ((!pos_shift && !neg_shift) || !reg_const[op.src2])
+            return false;
+         // constant shift count, negative: the other direction
+         const double count = pos_shift ? reg_value[op.src2] : -reg_value[op.src2];
+         if (std::fabs(count) > 31)
+            return false;
+         const double factor = std::ldexp(1.0, (int)std::fabs(count));
+         iop.value = (int)std::fabs(count);
+         if (count >= 0) {
+            if (a.lo < 0)
+               return false;
+            iop.code = IOP_SHL;
+            r = { a.lo * factor, a.hi * factor };
+         }
+         else {
+            iop.code = IOP_SHR;
+            r = { std::floor(a.lo / factor), std::floor(a.hi / factor) };
+         }
+         break;
+      }
+      default: // division, lane by lane functions, scaling
+         return false;
+      }
+
+      if (!(r.lo >= -INT_LIMIT && r.hi <= INT_LIMIT))
+         return false;
+      range[op.dst] = r;
+      reg_const[op.dst] = constant;
+      reg_value[op.dst] = constant ? op.value : 0.0;
+      int_code.push_back(iop);
+   }
+
+   integer_valid = true;
+   return true;
+}
+
+// Single precision evaluation without SSE4.1, the same results as run_program_float_sse41/avx2:
+// min/max/clip follow minps/maxps (the second operand for NaN), comparisons are ordered.
+
+namespace {
+
+inline float float_min(float x, float y) { return x < y ? x : y; }
+inline float float_max(float x, float y) { return x > y ? x : y; }
+inline float float_bool(bool b) { return b ? 1.0f : -1.0f; }
+
+// like convert<Int64, Float>, values from 2^23 (no fraction) and NaN are left to the scalar function
+inline float float_to_int64_range(float x, bool round, double (*process)(double x))
+{
+   if (!(std::fabs(x) < 8388608.0f))
+      return (float)process(x);
+   if (round)
+      x = x >= 0.0f ? x + 0.5f : x - 0.5f;
+   return std::trunc(x) + 0.0f;
+}
+
+} // namespace
+
+void Filtering::Parser::run_program_float_c(const Program &program, const double * const *inputs, double *dst, float *regs)
+{
+   const int BLOCK = Program::BLOCK_SIZE;
+
+   for (auto &op : program.get_code()) {
+      float *d = regs + op.dst * BLOCK;
+      const float *a = regs + op.src1 * BLOCK;
+      const float *b = regs + op.src2 * BLOCK;
+      const float *c = regs + op.src3 * BLOCK;
+
+      if (op.code == Program::OP_MATH) {
+         VMath::run_float_c(op.math, d, a, b, BLOCK);
+         continue;
+      }
+
+      for (int i = 0; i < BLOCK; i++) {
+         float r = 0.0f;
+         switch (op.code) {
+         case Program::OP_CONST: r = (float)op.value; break;
+         case Program::OP_INPUT: r = (float)inputs[op.src1][i]; break;
+         case Program::OP_ADD: r = a[i] + b[i]; break;
+         case Program::OP_SUB: r = a[i] - b[i]; break;
+         case Program::OP_MUL: r = a[i] * b[i]; break;
+         case Program::OP_DIV: r = a[i] / b[i]; break;
+         case Program::OP_MIN: r = float_min(a[i], b[i]); break;
+         case Program::OP_MAX: r = float_max(a[i], b[i]); break;
+         case Program::OP_EQ: r = float_bool(std::fabs(a[i] - b[i]) < 0.000001f); break;
+         case Program::OP_NE: r = float_bool(std::fabs(a[i] - b[i]) >= 0.000001f); break;
+         case Program::OP_LE: r = float_bool(a[i] <= b[i]); break;
+         case Program::OP_LT: r = float_bool(a[i] < b[i]); break;
+         case Program::OP_GE: r = float_bool(a[i] >= b[i]); break;
+         case Program::OP_GT: r = float_bool(a[i] > b[i]); break;
+         case Program::OP_AND: r = float_bool(a[i] > 0.0f && b[i] > 0.0f); break;
+         case Program::OP_OR: r = float_bool(a[i] > 0.0f || b[i] > 0.0f); break;
+         case Program::OP_ANDNOT: r = float_bool(a[i] > 0.0f && b[i] <= 0.0f); break;
+         case Program::OP_XOR: r = float_bool((a[i] > 0.0f && b[i] <= 0.0f) || (a[i] <= 0.0f && b[i] > 0.0f)); break;
+         case Program::OP_ABS: r = std::fabs(a[i]); break;
+         case Program::OP_FLOOR: r = std::floor(a[i]); break;
+         case Program::OP_CEIL: r = std::ceil(a[i]); break;
+         case Program::OP_TRUNC: r = float_to_int64_range(a[i], false, op.process1); break;
+         case Program::OP_ROUND: r = float_to_int64_range(a[i], true, op.process1); break;
+         case Program::OP_TERNARY: r = a[i] > 0.0f ? b[i] : c[i]; break;
+         case Program::OP_CLIP: r = float_min(c[i], float_max(b[i], a[i])); break;
+         case Program::OP_CALL0: r = (float)op.process0(); break;
+         case Program::OP_CALL1: r = (float)op.process1(a[i]); break;
+         case Program::OP_CALL2: r = (float)op.process2(a[i], b[i]); break;
+         case Program::OP_CALL3: r = (float)op.process3(a[i], b[i], c[i]); break;
+         case Program::OP_MATH: break; // whole block above
+         case Program::OP_SCALE:
+            r = (float)op.processScale(a[i], program.get_bitdepth(), program.get_sbitdepth(), program.get_chroma(), program.get_shift_float());
+            break;
+         }
+         d[i] = r;
+      }
+   }
+
+   const float *result = regs + program.result_register() * BLOCK;
+   for (int i = 0; i < BLOCK; i++)
+      dst[i] = result[i];
+}
@@ -0,0 +1,221 @@
+#ifndef __Mt_Program_H__
+#define __Mt_Program_H__
+
+#include "../utils/utils.h"
+#include <map>
+#include <tuple>
+#include <vector>
+
+namespace Filtering { namespace Parser {
+
+class Symbol;
+
+// Compiled form of an expression, v2.2.31
+// The rpn symbol list is translated once into a flat register program, for a given
+// bit depth and luma/chroma plane type:
+// - the stack is simulated at compile time: every operator creates a value, dup and swap only
+//   move value references around, they cost nothing at run time
+// - bit depth dependent constants (range_max, ymin, bitdepth, ...) become plain numbers
+// - stack errors (missing operands, dup/swap out of range) are detected here, evaluation
+//   reproduces the same fallback values as Context::rec_compute
+// - values are mapped onto a small register file, each register holds BLOCK_SIZE lanes and is
+//   reused as soon as its value is not needed anymore
+// Arithmetic, comparison, logic, min/max/clip and rounding have their own opcodes and are
+// evaluated on a whole block of pixels at once. Other functions are called lane by lane, exp, log, ^, sin,
+// cos, tan, asin, acos, atan and atan2 too (OP_MATH, the C library in double precision; with precision "float"
+// the vector math functions of vmath.h on the whole block).
+// Evaluation is done in double precision, results are identical to Context::rec_compute.
+// With precision "float" the same program runs in single precision (run_program_float_xxx).
+// Optimizations done while compiling, all of them keep the results bit-identical:
+// - operators and functions with constant operands are evaluated at compile time
+//   (e.g. "range_max 2 /", "16 scaleb", "bitdepth 8 == x y ?")
+// - identities: "x 1 *", "1 x *", "x 1 /", "x 0 -", and "x 0 +" when x cannot be -0.0
+// - common subexpressions are calculated once: "x y - abs x y - abs +" or "x y + y x + *"
+// - values which do not contribute to the result are not calculated
+class Program {
+public:
+
+   enum OpCode {
+      OP_CONST,   // dst = value
+      OP_INPUT,   // dst = input[src1] (x, y, z, a, then the relative pixel operands)
+      OP_ADD,
+      OP_SUB,
+      OP_MUL,
+      OP_DIV,
+      OP_MIN,
+      OP_MAX,
+      OP_EQ,
+      OP_NE,
+      OP_LE,
+      OP_LT,
+      OP_GE,
+      OP_GT,
+      OP_AND,
+      OP_OR,
+      OP_ANDNOT,
+      OP_XOR,
+      OP_ABS,
+      OP_FLOOR,
+      OP_CEIL,
+      OP_TRUNC,
+      OP_ROUND,
+      OP_TERNARY, // dst = src1 > 0 ? src2 : src3
+      OP_CLIP,    // dst = clip(src1, src2, src3)
+      OP_CALL0,   // lane by lane fallbacks
+      OP_CALL1,
+      OP_CALL2,
+      OP_CALL3,
+      OP_MATH,    // dst = VMath function 'math' of src1 (and src2), v2.2.31
+      OP_SCALE    // scaleb/scalef family, bit depths are fixed for the program
+   };
+
+   struct Op {
+      OpCode code;
+      int dst;
+      int src1, src2, src3;
+      double value;
+      int math;   // VMath::Function of OP_MATH
+      double (*process0)();
+      double (*process1)(double x);
+      double (*process2)(double x, double y);
+      double (*process3)(double x, double y, double z);
+      double (*processScale)(double x, int y, int z, bool chroma, bool shift_float);
+   };
+
+   // Integer evaluation, v2.2.31
+   // When interval analysis proves that every value is an integer within the int32 range for integer inputs
+   // in 0..input_max, the program is also translated to int32 opcodes. The results are the same as in double.
+   enum IntOpCode {
+      IOP_CONST,
+      IOP_INPUT,
+      IOP_COPY,   // floor, ceil, trunc, round of an integer
+      IOP_ADD,
+      IOP_SUB,
+      IOP_MUL,
+      IOP_MIN,
+      IOP_MAX,
+      IOP_EQ,
+      IOP_NE,
+      IOP_LE,
+      IOP_LT,
+      IOP_GE,
+      IOP_GT,
+      IOP_AND,
+      IOP_OR,
+      IOP_ANDNOT,
+      IOP_XOR,
+      IOP_ABS,
+      IOP_TERNARY,
+      IOP_CLIP,
+      IOP_BITAND, // &u &s
+      IOP_BITOR,  // |u |s
+      IOP_BITXOR, // @u @s
+      IOP_BITNOT, // ~s
+      IOP_SHL,    // << by a constant, value: bits
+      IOP_SHR     // >> by a constant, arithmetic
+   };
+
+   struct IntOp {
+      IntOpCode code;
+      int dst;
+      int src1, src2, src3;
+      int value;
+   };
+
+   // number of pixels evaluated by one pass over the program
+   static const int BLOCK_SIZE = 32;
+
+   Program();
+
+   // variables: value of each Symbol::VarType for this bitdepth and plane type, x/y/z/a excluded
+   // integer_inputs: x, y, z, a are never -0.0 (integer pixels, scaled or not)
+   void compile(const std::vector<Symbol> &symbols, const double *variables, int bitdepth, int sbitdepth, bool chroma, bool shift_float, bool integer_inputs);
+
+   int get_bitdepth() const { return bitdepth; }
+   bool get_chroma() const { return chroma; }
+   int get_sbitdepth() const { return sbitdepth; }
+   bool get_shift_float() const { return shift_float; }
+   bool get_integer_inputs() const { return integer_inputs; }
+
+   int get_compute_error() const { return compute_error; }
+   int register_count() const { return nRegisters; }
+   int result_register() const { return nResult; }
+   // bit k is set when input k (x, y, z, a, neighbours from bit 4) is read by the program
+   int get_input_mask() const { return input_mask; }
+
+   // Separable form, v2.2.31: result = tail(leaf[0] op[1] leaf[1] op[2] leaf[2] ...), combined left to right,
+   // every leaf depends on one input only and the tail on the combined value only
+   struct Separable {
+      int nLeaves;
+      int leaf[4];      // value ids
+      int input[4];     // the input of each leaf
+      OpCode op[4];     // OP_ADD, OP_SUB, OP_MIN or OP_MAX; op[0] unused
+      bool reversed[4]; // leaf op value instead of value op leaf
+      int combined;     // value id of the last combination
+   };
+   bool find_separable(Separable &form) const;
+   // The program calculates value id instead of the result
+   void select_result(int id);
+   // Value id is read from input x instead of being calculated
+   void replace_with_input(int id);
+   const std::vector<Op> &get_code() const { return code; }
+   // true when the integer code is valid for inputs in 0..input_max, result of the last check is kept
+   bool check_integer(int input_max);
+   const std::vector<IntOp> &get_int_code() const { return int_code; }
+
+private:
+
+   std::vector<Op> code;
+   std::vector<IntOp> int_code;
+   int integer_input_max; // -1: not checked
+   bool integer_valid;
+   int nRegisters;
+   int nResult;
+   int result_id;
+   int input_mask;
+   int compute_error;
+
+   int bitdepth;
+   int sbitdepth;
+   bool chroma;
+   bool shift_float;
+   bool integer_inputs;
+
+   // values of the simulated stack, the index is the value id. Operands are always older values.
+   struct Node {
+      Op op;              // dst unused, sources are value ids
+      bool maybe_negzero; // false: the value can never be -0.0
+   };
+   std::vector<Node> nodes;
+   std::map<std::tuple<int, int, int, int, Uint64, void *>, int> node_ids; // for common subexpressions
+
+   int add_node(const Op &op, bool maybe_negzero);
+   int add_op(OpCode opcode, int src1 = 0, int src2 = 0, int src3 = 0);
+   int add_const(double value);
+   int add_variable(const Symbol &s, const double *variables);
+   int add_function(const Symbol &s, int src1, int src2, int src3);
+   int fold_function(const Symbol &s, int src1, int src2, int src3);
+   bool is_const(int id) const { return nodes[id].op.code == OP_CONST; }
+   double const_value(int id) const { return nodes[id].op.value; }
+
+   void allocate_registers(int result);
+   bool add_leaves(int id, const std::vector<int> &deps, Separable &form) const;
+};
+
+// Evaluates one block of Program::BLOCK_SIZE pixels.
+// inputs: x, y, z, a and neighbour blocks (only the ones referenced by the program are read)
+// regs: register_count() * BLOCK_SIZE doubles, 32 byte aligned
+void run_program_avx2(const Program &program, const double * const *inputs, double *dst, double *regs);
+void run_program_sse41(const Program &program, const double * const *inputs, double *dst, double *regs);
+// Integer program (Program::check_integer), regs: register_count() * BLOCK_SIZE ints, 32 byte aligned
+void run_program_int_avx2(const Program &program, const int * const *inputs, int *dst, int *regs);
+void run_program_int_sse41(const Program &program, const int * const *inputs, int *dst, int *regs);
+// Single precision (Context precision "float"), the same block layout. Values are float32 in the registers,
+// inputs and result are converted from/to double. regs: register_count() * BLOCK_SIZE floats, 32 byte aligned
+void run_program_float_avx2(const Program &program, const double * const *inputs, double *dst, float *regs);
+void run_program_float_sse41(const Program &program, const double * const *inputs, double *dst, float *regs);
+void run_program_float_c(const Program &program, const double * const *inputs, double *dst, float *regs);
+
+} } // namespace Parser, Filtering
+
+#endif
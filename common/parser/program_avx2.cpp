@@ -0,0 +1,491 @@
+#include "program.h"
+#include "vmath.h"
+#include <immintrin.h>
+
+using namespace Filtering;
+using namespace Filtering::Parser;
+
+// Operators are applied on registers of Program::BLOCK_SIZE doubles, 8 lanes per iteration.
+// Every opcode reproduces the scalar symbol functions exactly: min/max operand order,
+// ordered comparisons for NaN, and a scalar fallback for rounding out of the Int64 range.
+
+namespace {
+
+const int BLOCK = Program::BLOCK_SIZE;
+
+MT_FORCEINLINE __m256d select(__m256d mask, __m256d if_true, __m256d if_false)
+{
+  return _mm256_blendv_pd(if_false, if_true, mask);
+}
+
+MT_FORCEINLINE __m256d bool_result(__m256d mask)
+{
+  return select(mask, _mm256_set1_pd(1.0), _mm256_set1_pd(-1.0));
+}
+
+template<typename F>
+MT_FORCEINLINE void unary(double *d, const double *a, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8) {
+    __m256d r0 = f(_mm256_load_pd(a + i));
+    __m256d r1 = f(_mm256_load_pd(a + i + 4));
+    _mm256_store_pd(d + i, r0);
+    _mm256_store_pd(d + i + 4, r1);
+  }
+}
+
+template<typename F>
+MT_FORCEINLINE void binary(double *d, const double *a, const double *b, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8) {
+    __m256d r0 = f(_mm256_load_pd(a + i), _mm256_load_pd(b + i));
+    __m256d r1 = f(_mm256_load_pd(a + i + 4), _mm256_load_pd(b + i + 4));
+    _mm256_store_pd(d + i, r0);
+    _mm256_store_pd(d + i + 4, r1);
+  }
+}
+
+template<typename F>
+MT_FORCEINLINE void ternary(double *d, const double *a, const double *b, const double *c, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8) {
+    __m256d r0 = f(_mm256_load_pd(a + i), _mm256_load_pd(b + i), _mm256_load_pd(c + i));
+    __m256d r1 = f(_mm256_load_pd(a + i + 4), _mm256_load_pd(b + i + 4), _mm256_load_pd(c + i + 4));
+    _mm256_store_pd(d + i, r0);
+    _mm256_store_pd(d + i + 4, r1);
+  }
+}
+
+// trunc and round convert through Int64 in the scalar code: lanes outside of
+// the exactly representable range (and NaN) are left to the scalar function
+void to_int64_range(double *d, const double *a, bool round, double (*process)(double x))
+{
+  const __m256d limit = _mm256_set1_pd(9007199254740992.0); // 2^53: no fraction above
+  const __m256d signmask = _mm256_set1_pd(-0.0);
+  const __m256d half = _mm256_set1_pd(0.5);
+  const __m256d zero = _mm256_setzero_pd();
+  for (int i = 0; i < BLOCK; i += 4) {
+    __m256d x = _mm256_load_pd(a + i);
+    __m256d in_range = _mm256_cmp_pd(_mm256_andnot_pd(signmask, x), limit, _CMP_LT_OQ);
+    if (_mm256_movemask_pd(in_range) != 0xF) {
+      for (int j = 0; j < 4; j++)
+        d[i + j] = process(a[i + j]);
+      continue;
+    }
+    if (round) {
+      // x >= 0 ? x + 0.5 : x - 0.5
+      __m256d positive = _mm256_cmp_pd(x, zero, _CMP_GE_OQ);
+      x = select(positive, _mm256_add_pd(x, half), _mm256_sub_pd(x, half));
+    }
+    // +0.0: Int64 conversion has no negative zero
+    x = _mm256_add_pd(_mm256_round_pd(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), zero);
+    _mm256_store_pd(d + i, x);
+  }
+}
+
+} // namespace
+
+void Filtering::Parser::run_program_avx2(const Program &program, const double * const *inputs, double *dst, double *regs)
+{
+  const __m256d zero = _mm256_setzero_pd();
+  const __m256d signmask = _mm256_set1_pd(-0.0);
+  const __m256d epsilon = _mm256_set1_pd(0.000001);
+
+  for (auto &op : program.get_code()) {
+    double *d = regs + op.dst * BLOCK;
+    const double *a = regs + op.src1 * BLOCK;
+    const double *b = regs + op.src2 * BLOCK;
+    const double *c = regs + op.src3 * BLOCK;
+
+    switch (op.code) {
+    case Program::OP_CONST:
+    {
+      const __m256d v = _mm256_set1_pd(op.value);
+      for (int i = 0; i < BLOCK; i += 4)
+        _mm256_store_pd(d + i, v);
+      break;
+    }
+    case Program::OP_INPUT:
+      memcpy(d, inputs[op.src1], BLOCK * sizeof(double));
+      break;
+    case Program::OP_ADD: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_add_pd(x, y); }); break;
+    case Program::OP_SUB: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_sub_pd(x, y); }); break;
+    case Program::OP_MUL: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_mul_pd(x, y); }); break;
+    case Program::OP_DIV: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_div_pd(x, y); }); break;
+    // x < y ? x : y and x > y ? x : y, same as minpd/maxpd
+    case Program::OP_MIN: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_min_pd(x, y); }); break;
+    case Program::OP_MAX: binary(d, a, b, [](__m256d x, __m256d y) { return _mm256_max_pd(x, y); }); break;
+    case Program::OP_EQ:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        return bool_result(_mm256_cmp_pd(_mm256_andnot_pd(signmask, _mm256_sub_pd(x, y)), epsilon, _CMP_LT_OQ));
+      });
+      break;
+    case Program::OP_NE:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        return bool_result(_mm256_cmp_pd(_mm256_andnot_pd(signmask, _mm256_sub_pd(x, y)), epsilon, _CMP_GE_OQ));
+      });
+      break;
+    case Program::OP_LE: binary(d, a, b, [](__m256d x, __m256d y) { return bool_result(_mm256_cmp_pd(x, y, _CMP_LE_OQ)); }); break;
+    case Program::OP_LT: binary(d, a, b, [](__m256d x, __m256d y) { return bool_result(_mm256_cmp_pd(x, y, _CMP_LT_OQ)); }); break;
+    case Program::OP_GE: binary(d, a, b, [](__m256d x, __m256d y) { return bool_result(_mm256_cmp_pd(x, y, _CMP_GE_OQ)); }); break;
+    case Program::OP_GT: binary(d, a, b, [](__m256d x, __m256d y) { return bool_result(_mm256_cmp_pd(x, y, _CMP_GT_OQ)); }); break;
+    case Program::OP_AND:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        return bool_result(_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), _mm256_cmp_pd(y, zero, _CMP_GT_OQ)));
+      });
+      break;
+    case Program::OP_OR:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        return bool_result(_mm256_or_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), _mm256_cmp_pd(y, zero, _CMP_GT_OQ)));
+      });
+      break;
+    case Program::OP_ANDNOT:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        return bool_result(_mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), _mm256_cmp_pd(y, zero, _CMP_LE_OQ)));
+      });
+      break;
+    case Program::OP_XOR:
+      binary(d, a, b, [&](__m256d x, __m256d y) {
+        // (x > 0 && y <= 0) || (x <= 0 && y > 0), NaN is neither
+        __m256d m1 = _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), _mm256_cmp_pd(y, zero, _CMP_LE_OQ));
+        __m256d m2 = _mm256_and_pd(_mm256_cmp_pd(x, zero, _CMP_LE_OQ), _mm256_cmp_pd(y, zero, _CMP_GT_OQ));
+        return bool_result(_mm256_or_pd(m1, m2));
+      });
+      break;
+    case Program::OP_ABS: unary(d, a, [&](__m256d x) { return _mm256_andnot_pd(signmask, x); }); break;
+    case Program::OP_FLOOR: unary(d, a, [](__m256d x) { return _mm256_round_pd(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }); break;
+    case Program::OP_CEIL: unary(d, a, [](__m256d x) { return _mm256_round_pd(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }); break;
+    case Program::OP_TRUNC: to_int64_range(d, a, false, op.process1); break;
+    case Program::OP_ROUND: to_int64_range(d, a, true, op.process1); break;
+    case Program::OP_TERNARY:
+      ternary(d, a, b, c, [&](__m256d x, __m256d y, __m256d z) { return select(_mm256_cmp_pd(x, zero, _CMP_GT_OQ), y, z); });
+      break;
+    case Program::OP_CLIP:
+      // min(z, max(y, x))
+      ternary(d, a, b, c, [](__m256d x, __m256d y, __m256d z) { return _mm256_min_pd(z, _mm256_max_pd(y, x)); });
+      break;
+    case Program::OP_CALL0:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = op.process0();
+      break;
+    case Program::OP_CALL1:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = op.process1(a[i]);
+      break;
+    case Program::OP_CALL2:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = op.process2(a[i], b[i]);
+      break;
+    case Program::OP_CALL3:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = op.process3(a[i], b[i], c[i]);
+      break;
+    case Program::OP_MATH: // double precision: the C library, as the interpreter
+      if (op.process2)
+        for (int i = 0; i < BLOCK; i++)
+          d[i] = op.process2(a[i], b[i]);
+      else
+        for (int i = 0; i < BLOCK; i++)
+          d[i] = op.process1(a[i]);
+      break;
+    case Program::OP_SCALE:
+    {
+      const int bitdepth = program.get_bitdepth();
+      const int sbitdepth = program.get_sbitdepth();
+      const bool chroma = program.get_chroma();
+      const bool shift_float = program.get_shift_float();
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = op.processScale(a[i], bitdepth, sbitdepth, chroma, shift_float);
+      break;
+    }
+    }
+  }
+
+  memcpy(dst, regs + program.result_register() * BLOCK, BLOCK * sizeof(double));
+}
+
+// Integer programs: 8 int32 lanes, the value ranges are proven not to overflow.
+// Comparison results are 1 / -1: (mask ^ -1) | 1 for a true mask of all ones.
+
+namespace {
+
+template<typename F>
+MT_FORCEINLINE void int_unary(int *d, const int *a, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_si256((__m256i *)(d + i), f(_mm256_load_si256((const __m256i *)(a + i))));
+}
+
+template<typename F>
+MT_FORCEINLINE void int_binary(int *d, const int *a, const int *b, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_si256((__m256i *)(d + i), f(_mm256_load_si256((const __m256i *)(a + i)), _mm256_load_si256((const __m256i *)(b + i))));
+}
+
+template<typename F>
+MT_FORCEINLINE void int_ternary(int *d, const int *a, const int *b, const int *c, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_si256((__m256i *)(d + i), f(_mm256_load_si256((const __m256i *)(a + i)), _mm256_load_si256((const __m256i *)(b + i)), _mm256_load_si256((const __m256i *)(c + i))));
+}
+
+} // namespace
+
+void Filtering::Parser::run_program_int_avx2(const Program &program, const int * const *inputs, int *dst, int *regs)
+{
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i one = _mm256_set1_epi32(1);
+  const __m256i all = _mm256_set1_epi32(-1);
+  // true mask -> 1, false -> -1
+  auto bool_true = [&](__m256i mask) { return _mm256_or_si256(_mm256_xor_si256(mask, all), one); };
+  // false mask -> 1, true -> -1
+  auto bool_false = [&](__m256i mask) { return _mm256_or_si256(mask, one); };
+
+  for (auto &op : program.get_int_code()) {
+    int *d = regs + op.dst * BLOCK;
+    const int *a = regs + op.src1 * BLOCK;
+    const int *b = regs + op.src2 * BLOCK;
+    const int *c = regs + op.src3 * BLOCK;
+
+    switch (op.code) {
+    case Program::IOP_CONST:
+    {
+      const __m256i v = _mm256_set1_epi32(op.value);
+      for (int i = 0; i < BLOCK; i += 8)
+        _mm256_store_si256((__m256i *)(d + i), v);
+      break;
+    }
+    case Program::IOP_INPUT: memcpy(d, inputs[op.src1], BLOCK * sizeof(int)); break;
+    case Program::IOP_COPY: if (d != a) memcpy(d, a, BLOCK * sizeof(int)); break;
+    case Program::IOP_ADD: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_add_epi32(x, y); }); break;
+    case Program::IOP_SUB: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_sub_epi32(x, y); }); break;
+    case Program::IOP_MUL: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_mullo_epi32(x, y); }); break;
+    case Program::IOP_MIN: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_min_epi32(x, y); }); break;
+    case Program::IOP_MAX: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_max_epi32(x, y); }); break;
+    case Program::IOP_EQ: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_cmpeq_epi32(x, y)); }); break;
+    case Program::IOP_NE: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_false(_mm256_cmpeq_epi32(x, y)); }); break;
+    case Program::IOP_LE: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_false(_mm256_cmpgt_epi32(x, y)); }); break;
+    case Program::IOP_LT: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_cmpgt_epi32(y, x)); }); break;
+    case Program::IOP_GE: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_false(_mm256_cmpgt_epi32(y, x)); }); break;
+    case Program::IOP_GT: int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_cmpgt_epi32(x, y)); }); break;
+    case Program::IOP_AND:
+      int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_and_si256(_mm256_cmpgt_epi32(x, zero), _mm256_cmpgt_epi32(y, zero))); });
+      break;
+    case Program::IOP_OR:
+      int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_or_si256(_mm256_cmpgt_epi32(x, zero), _mm256_cmpgt_epi32(y, zero))); });
+      break;
+    case Program::IOP_ANDNOT:
+      int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_andnot_si256(_mm256_cmpgt_epi32(y, zero), _mm256_cmpgt_epi32(x, zero))); });
+      break;
+    case Program::IOP_XOR:
+      int_binary(d, a, b, [&](__m256i x, __m256i y) { return bool_true(_mm256_xor_si256(_mm256_cmpgt_epi32(x, zero), _mm256_cmpgt_epi32(y, zero))); });
+      break;
+    case Program::IOP_ABS: int_unary(d, a, [](__m256i x) { return _mm256_abs_epi32(x); }); break;
+    case Program::IOP_TERNARY:
+      int_ternary(d, a, b, c, [&](__m256i x, __m256i y, __m256i z) { return _mm256_blendv_epi8(z, y, _mm256_cmpgt_epi32(x, zero)); });
+      break;
+    case Program::IOP_CLIP:
+      int_ternary(d, a, b, c, [](__m256i x, __m256i y, __m256i z) { return _mm256_min_epi32(z, _mm256_max_epi32(y, x)); });
+      break;
+    case Program::IOP_BITAND: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_and_si256(x, y); }); break;
+    case Program::IOP_BITOR: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_or_si256(x, y); }); break;
+    case Program::IOP_BITXOR: int_binary(d, a, b, [](__m256i x, __m256i y) { return _mm256_xor_si256(x, y); }); break;
+    case Program::IOP_BITNOT: int_unary(d, a, [&](__m256i x) { return _mm256_xor_si256(x, all); }); break;
+    case Program::IOP_SHL:
+    {
+      const __m128i count = _mm_cvtsi32_si128(op.value);
+      int_unary(d, a, [&](__m256i x) { return _mm256_sll_epi32(x, count); });
+      break;
+    }
+    case Program::IOP_SHR:
+    {
+      const __m128i count = _mm_cvtsi32_si128(op.value);
+      int_unary(d, a, [&](__m256i x) { return _mm256_sra_epi32(x, count); });
+      break;
+    }
+    }
+  }
+
+  memcpy(dst, regs + program.result_register() * BLOCK, BLOCK * sizeof(int));
+}
+
+// Single precision programs (Context precision "float"): 8 float lanes per iteration, the same opcodes as the
+// double evaluator in float arithmetic. Inputs are converted from the double blocks, the result back to double.
+
+namespace {
+
+MT_FORCEINLINE __m256 select_ps(__m256 mask, __m256 if_true, __m256 if_false)
+{
+  return _mm256_blendv_ps(if_false, if_true, mask);
+}
+
+MT_FORCEINLINE __m256 bool_result_ps(__m256 mask)
+{
+  return select_ps(mask, _mm256_set1_ps(1.0f), _mm256_set1_ps(-1.0f));
+}
+
+template<typename F>
+MT_FORCEINLINE void float_unary(float *d, const float *a, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_ps(d + i, f(_mm256_load_ps(a + i)));
+}
+
+template<typename F>
+MT_FORCEINLINE void float_binary(float *d, const float *a, const float *b, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_ps(d + i, f(_mm256_load_ps(a + i), _mm256_load_ps(b + i)));
+}
+
+template<typename F>
+MT_FORCEINLINE void float_ternary(float *d, const float *a, const float *b, const float *c, F f)
+{
+  for (int i = 0; i < BLOCK; i += 8)
+    _mm256_store_ps(d + i, f(_mm256_load_ps(a + i), _mm256_load_ps(b + i), _mm256_load_ps(c + i)));
+}
+
+// like convert<Int64, Float>, lanes from 2^23 (no fraction) and NaN are left to the scalar function
+void float_to_int64_range(float *d, const float *a, bool round, double (*process)(double x))
+{
+  const __m256 limit = _mm256_set1_ps(8388608.0f);
+  const __m256 signmask = _mm256_set1_ps(-0.0f);
+  const __m256 half = _mm256_set1_ps(0.5f);
+  const __m256 zero = _mm256_setzero_ps();
+  for (int i = 0; i < BLOCK; i += 8) {
+    __m256 x = _mm256_load_ps(a + i);
+    __m256 in_range = _mm256_cmp_ps(_mm256_andnot_ps(signmask, x), limit, _CMP_LT_OQ);
+    if (_mm256_movemask_ps(in_range) != 0xFF) {
+      for (int j = 0; j < 8; j++)
+        d[i + j] = (float)process(a[i + j]);
+      continue;
+    }
+    if (round) {
+      __m256 positive = _mm256_cmp_ps(x, zero, _CMP_GE_OQ);
+      x = select_ps(positive, _mm256_add_ps(x, half), _mm256_sub_ps(x, half));
+    }
+    x = _mm256_add_ps(_mm256_round_ps(x, _MM_FROUND_TO_ZERO | _MM_FROUND_NO_EXC), zero);
+    _mm256_store_ps(d + i, x);
+  }
+}
+
+} // namespace
+
+void Filtering::Parser::run_program_float_avx2(const Program &program, const double * const *inputs, double *dst, float *regs)
+{
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 signmask = _mm256_set1_ps(-0.0f);
+  const __m256 epsilon = _mm256_set1_ps(0.000001f);
+
+  for (auto &op : program.get_code()) {
+    float *d = regs + op.dst * BLOCK;
+    const float *a = regs + op.src1 * BLOCK;
+    const float *b = regs + op.src2 * BLOCK;
+    const float *c = regs + op.src3 * BLOCK;
+
+    switch (op.code) {
+    case Program::OP_CONST:
+    {
+      const __m256 v = _mm256_set1_ps((float)op.value);
+      for (int i = 0; i < BLOCK; i += 8)
+        _mm256_store_ps(d + i, v);
+      break;
+    }
+    case Program::OP_INPUT:
+    {
+      const double *in = inputs[op.src1];
+      for (int i = 0; i < BLOCK; i += 8) {
+        const __m128 lo = _mm256_cvtpd_ps(_mm256_load_pd(in + i));
+        const __m128 hi = _mm256_cvtpd_ps(_mm256_load_pd(in + i + 4));
+        _mm256_store_ps(d + i, _mm256_insertf128_ps(_mm256_castps128_ps256(lo), hi, 1));
+      }
+      break;
+    }
+    case Program::OP_ADD: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_add_ps(x, y); }); break;
+    case Program::OP_SUB: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_sub_ps(x, y); }); break;
+    case Program::OP_MUL: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_mul_ps(x, y); }); break;
+    case Program::OP_DIV: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_div_ps(x, y); }); break;
+    case Program::OP_MIN: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_min_ps(x, y); }); break;
+    case Program::OP_MAX: float_binary(d, a, b, [](__m256 x, __m256 y) { return _mm256_max_ps(x, y); }); break;
+    case Program::OP_EQ:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        return bool_result_ps(_mm256_cmp_ps(_mm256_andnot_ps(signmask, _mm256_sub_ps(x, y)), epsilon, _CMP_LT_OQ));
+      });
+      break;
+    case Program::OP_NE:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        return bool_result_ps(_mm256_cmp_ps(_mm256_andnot_ps(signmask, _mm256_sub_ps(x, y)), epsilon, _CMP_GE_OQ));
+      });
+      break;
+    case Program::OP_LE: float_binary(d, a, b, [](__m256 x, __m256 y) { return bool_result_ps(_mm256_cmp_ps(x, y, _CMP_LE_OQ)); }); break;
+    case Program::OP_LT: float_binary(d, a, b, [](__m256 x, __m256 y) { return bool_result_ps(_mm256_cmp_ps(x, y, _CMP_LT_OQ)); }); break;
+    case Program::OP_GE: float_binary(d, a, b, [](__m256 x, __m256 y) { return bool_result_ps(_mm256_cmp_ps(x, y, _CMP_GE_OQ)); }); break;
+    case Program::OP_GT: float_binary(d, a, b, [](__m256 x, __m256 y) { return bool_result_ps(_mm256_cmp_ps(x, y, _CMP_GT_OQ)); }); break;
+    case Program::OP_AND:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        return bool_result_ps(_mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), _mm256_cmp_ps(y, zero, _CMP_GT_OQ)));
+      });
+      break;
+    case Program::OP_OR:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        return bool_result_ps(_mm256_or_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), _mm256_cmp_ps(y, zero, _CMP_GT_OQ)));
+      });
+      break;
+    case Program::OP_ANDNOT:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        return bool_result_ps(_mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), _mm256_cmp_ps(y, zero, _CMP_LE_OQ)));
+      });
+      break;
+    case Program::OP_XOR:
+      float_binary(d, a, b, [&](__m256 x, __m256 y) {
+        __m256 m1 = _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), _mm256_cmp_ps(y, zero, _CMP_LE_OQ));
+        __m256 m2 = _mm256_and_ps(_mm256_cmp_ps(x, zero, _CMP_LE_OQ), _mm256_cmp_ps(y, zero, _CMP_GT_OQ));
+        return bool_result_ps(_mm256_or_ps(m1, m2));
+      });
+      break;
+    case Program::OP_ABS: float_unary(d, a, [&](__m256 x) { return _mm256_andnot_ps(signmask, x); }); break;
+    case Program::OP_FLOOR: float_unary(d, a, [](__m256 x) { return _mm256_round_ps(x, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }); break;
+    case Program::OP_CEIL: float_unary(d, a, [](__m256 x) { return _mm256_round_ps(x, _MM_FROUND_TO_POS_INF | _MM_FROUND_NO_EXC); }); break;
+    case Program::OP_TRUNC: float_to_int64_range(d, a, false, op.process1); break;
+    case Program::OP_ROUND: float_to_int64_range(d, a, true, op.process1); break;
+    case Program::OP_TERNARY:
+      float_ternary(d, a, b, c, [&](__m256 x, __m256 y, __m256 z) { return select_ps(_mm256_cmp_ps(x, zero, _CMP_GT_OQ), y, z); });
+      break;
+    case Program::OP_CLIP:
+      float_ternary(d, a, b, c, [](__m256 x, __m256 y, __m256 z) { return _mm256_min_ps(z, _mm256_max_ps(y, x)); });
+      break;
+    case Program::OP_CALL0:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = (float)op.process0();
+      break;
+    case Program::OP_CALL1:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = (float)op.process1(a[i]);
+      break;
+    case Program::OP_CALL2:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = (float)op.process2(a[i], b[i]);
+      break;
+    case Program::OP_CALL3:
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = (float)op.process3(a[i], b[i], c[i]);
+      break;
+    case Program::OP_MATH: VMath::run_float_avx2(op.math, d, a, b, BLOCK); break;
+    case Program::OP_SCALE:
+    {
+      const int bitdepth = program.get_bitdepth();
+      const int sbitdepth = program.get_sbitdepth();
+      const bool chroma = program.get_chroma();
+      const bool shift_float = program.get_shift_float();
+      for (int i = 0; i < BLOCK; i++)
+        d[i] = (float)op.processScale(a[i], bitdepth, sbitdepth, chroma, shift_float);
+      break;
+    }
+    }
+  }
+
+  const float *result = regs + program.result_register() * BLOCK;
+  for (int i = 0; i < BLOCK; i += 4)
+    _mm256_store_pd(dst + i, _mm256_cvtps_pd(_mm_load_ps(result + i)));
+}
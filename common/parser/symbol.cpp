@@ -1,4 +1,6 @@
 #include "symbol.h"
+#include "../constraints/constraints.h"
+#include <cmath>
 #include <math.h>
 #include <sstream>
 #include <string>
@@ -267,6 +269,7 @@ Symbol Symbol::SetFloatToClampUseI14Range("clamp_f_i14", -14.0, FUNCTION_CONFIG_
 Symbol Symbol::SetFloatToClampUseI16Range("clamp_f_i16", -16.0, FUNCTION_CONFIG_SCRIPT_BITDEPTH, 0, NULL);
 Symbol Symbol::SetFloatToClampUseF32Range("clamp_f_f32", -32.0, FUNCTION_CONFIG_SCRIPT_BITDEPTH, 0, NULL);
 Symbol Symbol::SetFloatToClampUseF32Range_2("clamp_f", -32.0, FUNCTION_CONFIG_SCRIPT_BITDEPTH, 0, NULL);
+Symbol Symbol::PrecisionF32("precision_f32", 32.0, FUNCTION_CONFIG_PRECISION, 0, NULL);
 
 Symbol Symbol::Dup("dup", DUP, 0); // dup 0
 Symbol Symbol::Dup0("dup0", DUP, 0); // duplicates Nth stack element to the top
@@ -394,6 +397,23 @@ type(type), vartype(VARIABLE_UNDEFINED), value(value), value2(""), nParameter(nP
 {
 }
 
+// x[-1,0], x.U: the symbol of the input, with the offset or the plane in its name
+Symbol Symbol::Neighbour(const Symbol &input, int dx, int dy, int plane)
+{
+  Symbol s = input;
+  s.vartype = VARIABLE_NEIGHBOUR;
+  if (plane >= 0)
+    s.value = input.value + "." + "YUVA"[plane];
+  else
+    s.value = input.value + "[" + std::to_string(dx) + "," + std::to_string(dy) + "]";
+  s.value2 = "";
+  s.iValue = input.vartype - VARIABLE_X;
+  s.dx = dx;
+  s.dy = dy;
+  s.plane = plane;
+  return s;
+}
+
 // called from rec_compute_old, why
 double Symbol::getValue(double x, double y, double z) const
 {
@@ -501,15 +521,21 @@ bool Context::SetScaleInputs(String scale_inputs)
 }
 
 
-Context::Context(const std::deque<Symbol> &expression, String scale_inputs, int param_clamp_float_i) : Context(expression)
+Context::Context(const std::vector<Symbol> &expression, String scale_inputs, int param_clamp_float_i) : Context(expression)
 {
   clamp_float_i = param_clamp_float_i; // SetScaleInputs can override to true
   SetScaleInputs(scale_inputs);
 }
 
-Context::Context(const std::deque<Symbol> &expression)
+Context::Context(const std::vector<Symbol> &expression)
 {
    nPos_infix = -1;
+   cpu_flags = CPU_NONE;
+   program_valid = false;
+   single_precision = false;
+   profiling = false;
+   row_buffer = nullptr;
+   row_buffer_size = 0;
    pSymbols.reserve(expression.size());
    exprstack.reserve(expression.size());
 
@@ -546,11 +572,27 @@ Context::Context(const std::deque<Symbol> &expression)
          sbitdepth = -(int)it.dValue;
        }
      }
+     else if (it.type == Symbol::FUNCTION_CONFIG_PRECISION) {
+       single_precision = true;
+     }
      else {
        pSymbols.push_back(it);
      }
    }
 
+   // v2.2.31: relative pixel and other plane operands, the same offset or plane of an input is read once
+   for (auto &s : pSymbols) {
+     if (s.type != Symbol::VARIABLE || s.vartype != Symbol::VARIABLE_NEIGHBOUR)
+       continue;
+     int k = 0;
+     while (k < (int)neighbours.size() && !(neighbours[k].input == s.iValue && neighbours[k].dx == s.dx && neighbours[k].dy == s.dy && neighbours[k].plane == s.plane))
+       k++;
+     if (k == (int)neighbours.size())
+       neighbours.push_back({ s.iValue, s.dx, s.dy, s.plane });
+     s.iValue = k;
+   }
+   neighbour_values.resize(neighbours.size());
+
    //sbitdepth = default_sbitdepth;
 
    // fill predefined constants for faster rec_compute access. Integer bit-depth only
@@ -611,6 +653,19 @@ Context::Context(const std::deque<Symbol> &expression)
 
 Context::~Context()
 {
+  if (row_buffer)
+    _aligned_free(row_buffer);
+}
+
+void *Context::scratch(int index, size_t bytes)
+{
+  if ((size_t)index >= scratch_buffers.size())
+    scratch_buffers.resize(index + 1);
+  std::vector<double> &buffer = scratch_buffers[index];
+  const size_t size = (bytes + sizeof(double) - 1) / sizeof(double);
+  if (buffer.size() < size)
+    buffer.resize(size);
+  return buffer.data();
 }
 
 double Context::rec_compute()
@@ -639,6 +694,7 @@ double Context::rec_compute()
     case Symbol::VARIABLE_Y: { last = y; break; }
     case Symbol::VARIABLE_Z: { last = z; break; }
     case Symbol::VARIABLE_A: { last = a; break; }
+    case Symbol::VARIABLE_NEIGHBOUR: { last = neighbour_values[s_first.iValue]; break; }
     case Symbol::VARIABLE_BITDEPTH: { last = bitdepth; break; } // bit-depth for autoscale
     case Symbol::VARIABLE_SCRIPT_BITDEPTH: { last = (double)sbitdepth; break; } // source bit depth for autoscale
 
@@ -687,6 +743,7 @@ double Context::rec_compute()
       case Symbol::VARIABLE_Y: { last = y; break; }
       case Symbol::VARIABLE_Z: { last = z; break; }
       case Symbol::VARIABLE_A: { last = a; break; }
+      case Symbol::VARIABLE_NEIGHBOUR: { last = neighbour_values[s.iValue]; break; }
       case Symbol::VARIABLE_BITDEPTH: { last = bitdepth; break; } // bit-depth for autoscale
       case Symbol::VARIABLE_SCRIPT_BITDEPTH: { last = (double)sbitdepth; break; } // source bit depth for autoscale
 
@@ -850,6 +907,573 @@ double Context::compute_1(double _x, int _bitdepth, bool _chroma)
   return rec_compute();
 }
 
+// bit depth dependent constants, same as in rec_compute
+void Context::get_variables(double *variables, int _bitdepth, bool _chroma) const
+{
+  const bool is_float = _bitdepth == 32;
+  const int lc = _chroma ? 1 : 0;
+  const int bits = is_float ? 0 : _bitdepth - 8;
+
+  variables[Symbol::VARIABLE_BITDEPTH] = _bitdepth;
+  variables[Symbol::VARIABLE_SCRIPT_BITDEPTH] = (double)sbitdepth;
+  variables[Symbol::VARIABLE_RANGE_HALF] = is_float ? range_half_f[lc] : a_range_half[bits];
+  variables[Symbol::VARIABLE_RANGE_MIN] = is_float ? range_min_f[lc] : a_range_min[bits];
+  variables[Symbol::VARIABLE_RANGE_MAX] = is_float ? range_max_f[lc] : a_range_max[bits];
+  variables[Symbol::VARIABLE_YRANGE_HALF] = is_float ? range_half_f[0] : a_range_half[bits];
+  variables[Symbol::VARIABLE_YRANGE_MIN] = is_float ? range_min_f[0] : a_range_min[bits];
+  variables[Symbol::VARIABLE_YRANGE_MAX] = is_float ? range_max_f[0] : a_range_max[bits];
+  variables[Symbol::VARIABLE_RANGE_SIZE] = is_float ? range_size_f : a_range_size[bits];
+  variables[Symbol::VARIABLE_YMIN] = is_float ? ymin_f : a_ymin[bits];
+  variables[Symbol::VARIABLE_YMAX] = is_float ? ymax_f : a_ymax[bits];
+  variables[Symbol::VARIABLE_CMIN] = is_float ? cmin_f : a_cmin[bits];
+  variables[Symbol::VARIABLE_CMAX] = is_float ? cmax_f : a_cmax[bits];
+}
+
+void Context::prepare_program(int _bitdepth, bool _chroma, bool integer_inputs)
+{
+  if (program_valid && program.get_bitdepth() == _bitdepth && program.get_chroma() == _chroma && program.get_integer_inputs() == integer_inputs)
+    return;
+
+  double variables[Symbol::VARIABLE_UNDEFINED] = {};
+  get_variables(variables, _bitdepth, _chroma);
+  program.compile(pSymbols, variables, _bitdepth, sbitdepth, _chroma, shift_float, integer_inputs);
+  program_valid = true;
+
+  // registers + 4 input blocks + neighbour blocks + 1 output block
+  const int nBlocks = 4 + (int)neighbours.size();
+  const int size = (program.register_count() + nBlocks + 1) * Program::BLOCK_SIZE;
+  if (size > row_buffer_size) {
+    if (row_buffer)
+      _aligned_free(row_buffer);
+    row_buffer = (double *)_aligned_malloc(size * sizeof(double), 32);
+    row_buffer_size = size;
+  }
+  double *p = row_buffer + program.register_count() * Program::BLOCK_SIZE;
+  for (int i = 0; i < nBlocks; i++) {
+    block_inputs[i] = p;
+    p += Program::BLOCK_SIZE;
+  }
+  block_output = p;
+  // unused inputs and partial blocks are evaluated as well
+  memset(block_inputs[0], 0, nBlocks * Program::BLOCK_SIZE * sizeof(double));
+}
+
+// integer evaluation needs a SIMD evaluator, the interpreter works in double only
+bool Context::prepare_integer(int input_max)
+{
+  if (!(cpu_flags & (CPU_AVX2 | CPU_SSE4_1)))
+    return false;
+  if (!program.check_integer(input_max))
+    return false;
+  // unused inputs and partial blocks
+  memset(block_inputs[0], 0, (4 + neighbours.size()) * Program::BLOCK_SIZE * sizeof(double));
+  return true;
+}
+
+// int blocks use the same buffer as the double ones
+void Context::get_int_blocks(int **inputs, int *&output)
+{
+  for (int k = 0; k < 4 + (int)neighbours.size(); k++)
+    inputs[k] = reinterpret_cast<int *>(block_inputs[k]);
+  output = reinterpret_cast<int *>(block_output);
+}
+
+void Context::Profile::clear()
+{
+  for (int k = 0; k < PATH_COUNT; k++)
+    blocks[k] = 0;
+  for (int k = 0; k <= Program::OP_SCALE; k++)
+    ops[k] = 0;
+  int_ops = 0;
+}
+
+void Context::Profile::add(const Profile &other)
+{
+  for (int k = 0; k < PATH_COUNT; k++)
+    blocks[k] += other.blocks[k];
+  for (int k = 0; k <= Program::OP_SCALE; k++)
+    ops[k] += other.ops[k];
+  int_ops += other.int_ops;
+}
+
+const char *Context::Profile::path_name(int path)
+{
+  static const char *names[PATH_COUNT] = { "double", "int", "float", "interpreter" };
+  return path >= 0 && path < PATH_COUNT ? names[path] : "";
+}
+
+const char *Context::Profile::op_name(int code)
+{
+  static const char *names[Program::OP_SCALE + 1] = {
+    "const", "input", "add", "sub", "mul", "div", "min", "max", "eq", "ne", "le", "lt", "ge", "gt",
+    "and", "or", "andnot", "xor", "abs", "floor", "ceil", "trunc", "round", "ternary", "clip",
+    "call0", "call1", "call2", "call3", "math", "scale"
+  };
+  return code >= 0 && code <= Program::OP_SCALE ? names[code] : "";
+}
+
+// one more block evaluated, the double program stands for the interpreted expression
+void Context::count_block(int path)
+{
+  profile.blocks[path]++;
+  if (path == Profile::PATH_INT) {
+    profile.int_ops += program.get_int_code().size() * Program::BLOCK_SIZE;
+    return;
+  }
+  for (const Program::Op &op : program.get_code())
+    profile.ops[op.code] += Program::BLOCK_SIZE;
+}
+
+void Context::run_block_int()
+{
+  if (profiling)
+    count_block(Profile::PATH_INT);
+  int *inputs[4 + MAX_NEIGHBOURS], *output;
+  get_int_blocks(inputs, output);
+  int *regs = reinterpret_cast<int *>(row_buffer);
+  if (cpu_flags & CPU_AVX2)
+    run_program_int_avx2(program, inputs, output, regs);
+  else
+    run_program_int_sse41(program, inputs, output, regs);
+}
+
+void Context::run_block(int nInputs)
+{
+  if (profiling)
+    count_block(single_precision ? Profile::PATH_FLOAT : (cpu_flags & (CPU_AVX2 | CPU_SSE4_1)) ? Profile::PATH_DOUBLE : Profile::PATH_INTERPRETER);
+  if (single_precision) {
+    // the registers take half of their double size
+    float *regs = reinterpret_cast<float *>(row_buffer);
+    if (cpu_flags & CPU_AVX2)
+      run_program_float_avx2(program, block_inputs, block_output, regs);
+    else if (cpu_flags & CPU_SSE4_1)
+      run_program_float_sse41(program, block_inputs, block_output, regs);
+    else
+      run_program_float_c(program, block_inputs, block_output, regs);
+    return;
+  }
+  if (cpu_flags & CPU_AVX2) {
+    run_program_avx2(program, block_inputs, block_output, row_buffer);
+    return;
+  }
+  if (cpu_flags & CPU_SSE4_1) {
+    run_program_sse41(program, block_inputs, block_output, row_buffer);
+    return;
+  }
+  // interpreter
+  const int _bitdepth = program.get_bitdepth();
+  const bool _chroma = program.get_chroma();
+  const double *bx = block_inputs[0];
+  const double *by = block_inputs[1];
+  const double *bz = block_inputs[2];
+  const double *ba = block_inputs[3];
+  if (!neighbours.empty()) {
+    for (int i = 0; i < Program::BLOCK_SIZE; i++) {
+      for (int k = 0; k < (int)neighbours.size(); k++)
+        neighbour_values[k] = block_inputs[4 + k][i];
+      block_output[i] = compute_4(bx[i], by[i], bz[i], ba[i], _bitdepth, _chroma);
+    }
+    return;
+  }
+  switch (nInputs) {
+  case 1:
+    for (int i = 0; i < Program::BLOCK_SIZE; i++)
+      block_output[i] = compute_1(bx[i], _bitdepth, _chroma);
+    break;
+  case 2:
+    for (int i = 0; i < Program::BLOCK_SIZE; i++)
+      block_output[i] = compute_2(bx[i], by[i], _bitdepth, _chroma);
+    break;
+  case 3:
+    for (int i = 0; i < Program::BLOCK_SIZE; i++)
+      block_output[i] = compute_3(bx[i], by[i], bz[i], _bitdepth, _chroma);
+    break;
+  default:
+    for (int i = 0; i < Program::BLOCK_SIZE; i++)
+      block_output[i] = compute_4(bx[i], by[i], bz[i], ba[i], _bitdepth, _chroma);
+    break;
+  }
+}
+
+void Context::compute_row(double *dst, const double * const *srcs, int nInputs, int width, int _bitdepth, bool _chroma)
+{
+  prepare_program(_bitdepth, _chroma, false);
+
+  for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+    const int n = min(Program::BLOCK_SIZE, width - x);
+    for (int k = 0; k < nInputs + (int)neighbours.size(); k++)
+      memcpy(block_inputs[input_block(k, nInputs)], srcs[k] + x, n * sizeof(double));
+    run_block(nInputs);
+    memcpy(dst + x, block_output, n * sizeof(double));
+  }
+  compute_error = program.get_compute_error();
+}
+
+int Context::get_used_inputs(int bits_per_pixel)
+{
+  const bool scale = scale_int && sbitdepth != bits_per_pixel;
+  prepare_program(scale ? sbitdepth : bits_per_pixel, false, true);
+  return program.get_input_mask();
+}
+
+int Context::get_program_length(int bits_per_pixel)
+{
+  if (bits_per_pixel == 32)
+    prepare_program(32, false, false);
+  else {
+    const bool scale = scale_int && sbitdepth != bits_per_pixel;
+    prepare_program(scale ? sbitdepth : bits_per_pixel, false, true);
+  }
+  return (int)program.get_code().size();
+}
+
+// evaluates a program reading input x only (or the same value for all inputs), count values
+static void run_program_values(const Program &p, int cpu_flags, const double *in, double *out, int count)
+{
+  const int BLOCK = Program::BLOCK_SIZE;
+  double *regs = (double *)_aligned_malloc((p.register_count() + 2) * BLOCK * sizeof(double), 32);
+  double *block_in = regs + p.register_count() * BLOCK;
+  double *block_out = block_in + BLOCK;
+  const double *inputs[4] = { block_in, block_in, block_in, block_in };
+  memset(block_in, 0, BLOCK * sizeof(double));
+  for (int i = 0; i < count; i += BLOCK) {
+    const int n = min(BLOCK, count - i);
+    memcpy(block_in, in + i, n * sizeof(double));
+    if (cpu_flags & CPU_AVX2)
+      run_program_avx2(p, inputs, block_out, regs);
+    else
+      run_program_sse41(p, inputs, block_out, regs);
+    memcpy(out + i, block_out, n * sizeof(double));
+  }
+  _aligned_free(regs);
+}
+
+bool Context::compute_separable(SeparableTables &tables, int bits_per_pixel)
+{
+  // the parts are evaluated by the compiled program only
+  if (!(cpu_flags & (CPU_AVX2 | CPU_SSE4_1)))
+    return false;
+
+  const bool scale = scale_int && sbitdepth != bits_per_pixel;
+  prepare_program(scale ? sbitdepth : bits_per_pixel, false, true);
+
+  Program::Separable form;
+  if (program.get_compute_error() != CE_NONE || !program.find_separable(form))
+    return false;
+
+  // expression values of all pixel values
+  const int size = 1 << bits_per_pixel;
+  std::vector<double> in(size), out(max(size, MAX_SEPARABLE_TAIL));
+  if (bits_per_pixel == 8) {
+    Byte ramp[256];
+    for (int i = 0; i < 256; i++) ramp[i] = (Byte)i;
+    convert_inputs_byte(in.data(), ramp, 256);
+  }
+  else {
+    std::vector<Word> ramp(size);
+    for (int i = 0; i < size; i++) ramp[i] = (Word)i;
+    convert_inputs_word(in.data(), ramp.data(), size, bits_per_pixel);
+  }
+
+  // leaves: integers only, combined in int they give the same values as in double.
+  // -0.0 is excluded, the integer combination would lose it.
+  const Int64 limit = 1 << 30;
+  Int64 lo = 0, hi = 0;
+  tables.nLeaves = form.nLeaves;
+  for (int k = 0; k < form.nLeaves; k++) {
+    Program leaf = program;
+    leaf.select_result(form.leaf[k]);
+    run_program_values(leaf, cpu_flags, in.data(), out.data(), size);
+
+    std::vector<int> &values = tables.leaves[k];
+    values.resize(size);
+    Int64 leaf_lo = limit, leaf_hi = -limit;
+    for (int i = 0; i < size; i++) {
+      const double v = out[i];
+      if (!(v >= -(double)limit && v <= (double)limit) || v != std::floor(v) || (v == 0 && std::signbit(v)))
+        return false;
+      values[i] = (int)v;
+      leaf_lo = min(leaf_lo, (Int64)values[i]);
+      leaf_hi = max(leaf_hi, (Int64)values[i]);
+    }
+
+    tables.input[k] = form.input[k];
+    tables.op[k] = form.op[k];
+    tables.reversed[k] = form.reversed[k];
+    if (k == 0) {
+      lo = leaf_lo;
+      hi = leaf_hi;
+      continue;
+    }
+    switch (form.op[k]) {
+    case Program::OP_ADD: lo += leaf_lo; hi += leaf_hi; break;
+    case Program::OP_SUB:
+      if (form.reversed[k]) { const Int64 l = leaf_lo - hi; hi = leaf_hi - lo; lo = l; }
+      else { lo -= leaf_hi; hi -= leaf_lo; }
+      break;
+    case Program::OP_MIN: lo = min(lo, leaf_lo); hi = min(hi, leaf_hi); break;
+    default: lo = max(lo, leaf_lo); hi = max(hi, leaf_hi); break; // OP_MAX
+    }
+    if (lo < -limit || hi > limit)
+      return false;
+  }
+  if (hi - lo + 1 > MAX_SEPARABLE_TAIL)
+    return false;
+
+  // tail over all possible combined values
+  const int count = (int)(hi - lo + 1);
+  Program tail = program;
+  tail.replace_with_input(form.combined);
+  in.resize(count);
+  for (int i = 0; i < count; i++) in[i] = (double)(lo + i);
+  run_program_values(tail, cpu_flags, in.data(), out.data(), count);
+
+  tables.lo = (int)lo;
+  tables.tail.resize(count);
+  if (bits_per_pixel == 8) {
+    std::vector<Byte> pixels(count);
+    convert_output_byte(pixels.data(), out.data(), count);
+    for (int i = 0; i < count; i++) tables.tail[i] = pixels[i];
+  }
+  else
+    convert_output_word(tables.tail.data(), out.data(), count, bits_per_pixel);
+
+  compute_error = CE_NONE;
+  return true;
+}
+
+// conversions: see compute_byte_x
+void Context::compute_row_byte(Byte *dst, const Byte * const *srcs, int nInputs, int width)
+{
+  const bool scale = scale_int && sbitdepth != 8;
+  prepare_program(scale ? sbitdepth : 8, false, true);
+
+  if (!scale && prepare_integer(255)) {
+    int *in[4 + MAX_NEIGHBOURS], *out;
+    get_int_blocks(in, out);
+    for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+      const int n = min(Program::BLOCK_SIZE, width - x);
+      for (int k = 0; k < nInputs + (int)neighbours.size(); k++) {
+        int *block = in[input_block(k, nInputs)];
+        for (int i = 0; i < n; i++) block[i] = srcs[k][x + i];
+      }
+      run_block_int();
+      for (int i = 0; i < n; i++) dst[x + i] = (Byte)min(max(out[i], 0), 255);
+    }
+    compute_error = program.get_compute_error();
+    return;
+  }
+
+  for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+    const int n = min(Program::BLOCK_SIZE, width - x);
+    for (int k = 0; k < nInputs + (int)neighbours.size(); k++)
+      convert_inputs_byte(block_inputs[input_block(k, nInputs)], srcs[k] + x, n);
+    run_block(nInputs);
+    convert_output_byte(dst + x, block_output, n);
+  }
+  compute_error = program.get_compute_error();
+}
+
+// conversions: see compute_word_x
+void Context::compute_row_word(Word *dst, const Word * const *srcs, int nInputs, int width, int bits_per_pixel)
+{
+  const bool scale = scale_int && sbitdepth != bits_per_pixel;
+  prepare_program(scale ? sbitdepth : bits_per_pixel, false, true);
+
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  if (!scale && prepare_integer(max_pixel_value)) {
+    int *in[4 + MAX_NEIGHBOURS], *out;
+    get_int_blocks(in, out);
+    for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+      const int n = min(Program::BLOCK_SIZE, width - x);
+      for (int k = 0; k < nInputs + (int)neighbours.size(); k++) {
+        int *block = in[input_block(k, nInputs)];
+        for (int i = 0; i < n; i++) block[i] = min((int)srcs[k][x + i], max_pixel_value); // clamp input below 16 bit
+      }
+      run_block_int();
+      for (int i = 0; i < n; i++) dst[x + i] = (Word)min(max(out[i], 0), max_pixel_value);
+    }
+    compute_error = program.get_compute_error();
+    return;
+  }
+
+  for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+    const int n = min(Program::BLOCK_SIZE, width - x);
+    for (int k = 0; k < nInputs + (int)neighbours.size(); k++)
+      convert_inputs_word(block_inputs[input_block(k, nInputs)], srcs[k] + x, n, bits_per_pixel);
+    run_block(nInputs);
+    convert_output_word(dst + x, block_output, n, bits_per_pixel);
+  }
+  compute_error = program.get_compute_error();
+}
+
+void Context::convert_inputs_byte(double *in, const Byte *src, int n) const
+{
+  const bool scale = scale_int && sbitdepth != 8;
+  const int bitdiff = sbitdepth - 8;
+  const double factor = ((1 << sbitdepth) - 1) / 255.0;
+
+  if (!scale)
+    for (int i = 0; i < n; i++) in[i] = src[i];
+  else if (!fullrange_autoscale)
+    for (int i = 0; i < n; i++) in[i] = src[i] << bitdiff;
+  else
+    for (int i = 0; i < n; i++) in[i] = src[i] * factor;
+}
+
+void Context::convert_output_byte(Byte *dst, const double *out, int n) const
+{
+  const bool scale = scale_int && sbitdepth != 8;
+  const int bitdiff = sbitdepth - 8;
+  const double factor = ((1 << sbitdepth) - 1) / 255.0;
+
+  if (!scale)
+    for (int i = 0; i < n; i++) dst[i] = clip<Byte, double>(out[i]);
+  else if (!fullrange_autoscale)
+    for (int i = 0; i < n; i++) dst[i] = clip<Byte, double>(out[i] / (1 << bitdiff));
+  else
+    for (int i = 0; i < n; i++) dst[i] = clip<Byte, double>(out[i] / factor);
+}
+
+void Context::convert_inputs_word(double *in, const Word *src, int n, int bits_per_pixel) const
+{
+  const bool scale = scale_int && sbitdepth != bits_per_pixel;
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int bitdiff = sbitdepth - bits_per_pixel; // plus or minus
+  const double shift_factor = (double)(1 << (bitdiff < 0 ? -bitdiff : 0));
+  const double full_factor = (double)((1 << sbitdepth) - 1) / ((1 << bits_per_pixel) - 1);
+
+  if (bits_per_pixel != 16) { // clamp input below 16 bit
+    for (int i = 0; i < n; i++) in[i] = min((int)src[i], max_pixel_value);
+  }
+  else {
+    for (int i = 0; i < n; i++) in[i] = src[i];
+  }
+  if (!scale)
+    ;
+  else if (!fullrange_autoscale) {
+    if (bitdiff > 0)
+      for (int i = 0; i < n; i++) in[i] = (double)((int)in[i] << bitdiff);
+    else
+      for (int i = 0; i < n; i++) in[i] = in[i] / shift_factor;
+  }
+  else
+    for (int i = 0; i < n; i++) in[i] = in[i] * full_factor;
+}
+
+void Context::convert_output_word(Word *dst, const double *out, int n, int bits_per_pixel) const
+{
+  const bool scale = scale_int && sbitdepth != bits_per_pixel;
+  const Word max_pixel_value = (Word)((1 << bits_per_pixel) - 1);
+  const int bitdiff = sbitdepth - bits_per_pixel; // plus or minus
+  const double shift_factor = (double)(1 << (bitdiff < 0 ? -bitdiff : 0));
+  const double full_factor = (double)((1 << sbitdepth) - 1) / ((1 << bits_per_pixel) - 1);
+
+  if (!scale)
+    for (int i = 0; i < n; i++) dst[i] = clip<Word, double>(out[i]);
+  else if (!fullrange_autoscale) {
+    if (bitdiff > 0)
+      for (int i = 0; i < n; i++) dst[i] = clip<Word, double>(out[i] / (1 << bitdiff));
+    else
+      for (int i = 0; i < n; i++) dst[i] = clip<Word, double>(out[i] * shift_factor);
+  }
+  else
+    for (int i = 0; i < n; i++) dst[i] = clip<Word, double>(out[i] / full_factor);
+  if (bits_per_pixel != 16)
+    for (int i = 0; i < n; i++) dst[i] = min(dst[i], max_pixel_value);
+}
+
+// conversions: see compute_float_x
+void Context::compute_row_float(Float *dst, const Float * const *srcs, int nInputs, int width, bool _chroma)
+{
+  const bool scale = scale_float && sbitdepth != 32;
+  const bool shift = !scale && shift_float && _chroma;
+
+  prepare_program(scale ? sbitdepth : 32, _chroma, false);
+
+  for (int x = 0; x < width; x += Program::BLOCK_SIZE) {
+    const int n = min(Program::BLOCK_SIZE, width - x);
+    for (int k = 0; k < nInputs + (int)neighbours.size(); k++) {
+      const Float *src = srcs[k] + x;
+      double *in = block_inputs[input_block(k, nInputs)];
+      if (shift)
+        for (int i = 0; i < n; i++) in[i] = (double)src[i] + 0.5f;
+      else if (!scale)
+        for (int i = 0; i < n; i++) in[i] = src[i];
+      else if (_chroma)
+        for (int i = 0; i < n; i++) in[i] = float_input_scalefactor * ((double)src[i] - chroma_center_f) + chroma_center_i;
+      else
+        for (int i = 0; i < n; i++) in[i] = float_input_scalefactor * (double)src[i];
+    }
+    run_block(nInputs);
+    const double *out = block_output;
+    Float *d = dst + x;
+    if (shift)
+      for (int i = 0; i < n; i++) d[i] = (float)(out[i] - 0.5f);
+    else if (!scale)
+      for (int i = 0; i < n; i++) d[i] = (float)(out[i]);
+    else if (_chroma)
+      for (int i = 0; i < n; i++) {
+        float result = (float)(out[i]);
+        d[i] = float_input_invscalefactor * (result - chroma_center_i) + chroma_center_f;
+      }
+    else
+      for (int i = 0; i < n; i++) d[i] = (float)(float_input_invscalefactor * out[i]);
+
+    if (_chroma) { // clamp_float == 2: clamp to 0..1 instead of -0.5..+0.5
+      if (clamp_float_i == 1)
+        for (int i = 0; i < n; i++) d[i] = max(min(d[i], chroma_hi_f), chroma_lo_f);
+      else if (clamp_float_i == 2)
+        for (int i = 0; i < n; i++) d[i] = max(min(d[i], 1.0f), 0.0f);
+    }
+    else if (clamp_float_i > 0)
+      for (int i = 0; i < n; i++) d[i] = max(min(d[i], 1.0f), 0.0f);
+  }
+  compute_error = program.get_compute_error();
+}
+
+// LUT rows are evaluated in chunks of 256 entries
+void Context::compute_lut_row(double *dst, const int *values, int nInputs, int ramp_input, int bits_per_pixel)
+{
+  double rows[4][256];
+  const double *srcs[4];
+  for (int k = 0; k < nInputs; k++) {
+    if (k != ramp_input)
+      for (int i = 0; i < 256; i++) rows[k][i] = values[k];
+    srcs[k] = rows[k];
+  }
+  for (int i0 = 0; i0 < (1 << bits_per_pixel); i0 += 256) {
+    for (int i = 0; i < 256; i++) rows[ramp_input][i] = i0 + i;
+    compute_row(dst + i0, srcs, nInputs, 256, bits_per_pixel, false);
+  }
+}
+
+void Context::compute_lut_row_byte(Byte *dst, const int *values, int nInputs, int ramp_input)
+{
+  Byte rows[4][256];
+  const Byte *srcs[4];
+  for (int k = 0; k < nInputs; k++) {
+    for (int i = 0; i < 256; i++) rows[k][i] = (Byte)(k == ramp_input ? i : values[k]);
+    srcs[k] = rows[k];
+  }
+  compute_row_byte(dst, srcs, nInputs, 256);
+}
+
+void Context::compute_lut_row_word(Word *dst, const int *values, int nInputs, int ramp_input, int bits_per_pixel)
+{
+  Word rows[4][256];
+  const Word *srcs[4];
+  for (int k = 0; k < nInputs; k++) {
+    if (k != ramp_input)
+      for (int i = 0; i < 256; i++) rows[k][i] = (Word)values[k];
+    srcs[k] = rows[k];
+  }
+  for (int i0 = 0; i0 < (1 << bits_per_pixel); i0 += 256) {
+    for (int i = 0; i < 256; i++) rows[ramp_input][i] = (Word)(i0 + i);
+    compute_row_word(dst + i0, srcs, nInputs, 256, bits_per_pixel);
+  }
+}
+
 String Context::rec_infix()
 {
     const Symbol &s = pSymbols[--nPos_infix];
@@ -862,6 +1486,7 @@ String Context::rec_infix()
       case Symbol::VARIABLE_Y:
       case Symbol::VARIABLE_Z:
       case Symbol::VARIABLE_A:
+      case Symbol::VARIABLE_NEIGHBOUR:
       case Symbol::VARIABLE_BITDEPTH:
       case Symbol::VARIABLE_SCRIPT_BITDEPTH:
       case Symbol::VARIABLE_RANGE_HALF:
@@ -932,7 +1557,8 @@ String Context::infix()
 
 bool Context::check()
 {
-   return true;
+   // v2.2.31: every relative pixel operand is an input of the compiled program
+   return neighbours.size() <= MAX_NEIGHBOURS;
 }
 
 int Context::get_compute_error()
@@ -2,8 +2,9 @@
 #define __Mt_Symbol_H__
 
 #include "../utils/utils.h"
-#include <deque>
+#include "program.h"
 #include <stack>
+#include <vector>
 
 
 namespace Filtering { namespace Parser {
@@ -21,6 +22,7 @@ public:
       DUP,
       SWAP,
       FUNCTION_CONFIG_SCRIPT_BITDEPTH,
+      FUNCTION_CONFIG_PRECISION, // v2.2.31: precision="float" of the lut filters, put in front of the expression
       OPERATOR,
       FUNCTION,
       TERNARY,
@@ -50,6 +52,11 @@ public:
      VARIABLE_CMIN,
      VARIABLE_CMAX,
 
+     // relative pixel of an input, x[-1,0] (v2.2.31): iValue is the input (0..3), dx and dy the offset.
+     // Same pixel of another plane, x.Y: plane is 0..3 (Y, U, V, A), -1 for x[-1,0].
+     // In a Context iValue is the index in Context::get_neighbours() instead.
+     VARIABLE_NEIGHBOUR,
+
      VARIABLE_UNDEFINED,
    } VarType;
 
@@ -63,6 +70,9 @@ public:
    int nParameter;
    double dValue;
    int iValue; // user/internal variable index, input index, etc...
+   int dx = 0; // VARIABLE_NEIGHBOUR offset
+   int dy = 0;
+   int plane = -1; // VARIABLE_NEIGHBOUR of another plane
    typedef double (*Process0)();
    typedef double (*Process1)(double x);
    typedef double (*Process2)(double x, double y);
@@ -99,6 +109,8 @@ public:
    Symbol(String value, Type type, VarType vartype);
    // numbers
    Symbol(String value, double dValue, Type type, int nParameter, Process1 process);
+   // relative pixel of an input variable (x, y, z, a), plane >= 0: the pixel of another plane instead (no offset)
+   static Symbol Neighbour(const Symbol &input, int dx, int dy, int plane = -1);
 
 
    // void setValue(double dValue); dead code
@@ -193,6 +205,8 @@ public:
    static Symbol SetFloatToClampUseI16Range;
    static Symbol SetFloatToClampUseF32Range;
    static Symbol SetFloatToClampUseF32Range_2;
+   // v2.2.31: not a keyword, added by the filters for precision="float"
+   static Symbol PrecisionF32;
    // v.2.2.5 extensions
    static Symbol Swap;
    static Symbol Dup;
@@ -218,6 +232,32 @@ public:
    static Symbol Dup9;
 };
 
+// Relative pixel operand of an expression, v2.2.31
+// Its value is the pixel of input (0..3: x, y, z, a) at (column + dx, row + dy), clamped to the plane.
+// plane >= 0 (0..3: Y, U, V, A): the pixel of that plane of the input at the position of the current one, resampled
+// when the plane sizes differ (dx, dy: 0)
+struct Neighbour {
+   int input;
+   int dx;
+   int dy;
+   int plane;
+};
+// distinct relative pixel operands of one expression
+const int MAX_NEIGHBOURS = 24;
+
+// Tables of a separable expression, v2.2.31, see Context::compute_separable
+// result pixel = tail[combined - lo], combined = leaves[0][p0] op[1] leaves[1][p1] ..., left to right,
+// pk is the pixel of input[k] (x, y, z, a)
+struct SeparableTables {
+   int nLeaves;
+   int input[4];
+   Program::OpCode op[4];        // OP_ADD, OP_SUB, OP_MIN, OP_MAX; op[0] unused
+   bool reversed[4];             // leaves[k][pk] op combined
+   std::vector<int> leaves[4];   // 1 << bits_per_pixel entries
+   int lo;
+   std::vector<Word> tail;
+};
+
 class Context {
 
    std::vector<Symbol> pSymbols;
@@ -226,6 +266,8 @@ class Context {
    int compute_error; // CE_xx
 
    double x, y, z, a;
+   std::vector<Neighbour> neighbours; // v2.2.31: distinct relative pixel operands
+   std::vector<double> neighbour_values; // their values for rec_compute
    int bitdepth; // bit depth
    int luma_chroma; // 0: luma(non-chroma) 1: chroma
 
@@ -277,19 +319,79 @@ class Context {
    float chroma_hi_f;
    double sbitdepth_f; // source bit depth of values to scale, avoid conversions
 
+   // row evaluation v2.2.31
+   // the expression is compiled for the bit depth and plane type of the last compute_row call
+   int cpu_flags;
+   Program program;
+   bool program_valid;
+   bool single_precision; // v2.2.31: the program runs in float32 (Symbol::PrecisionF32), see run_program_float_xxx
+   double *row_buffer; // registers, then input blocks x, y, z, a, the neighbours and the output block
+   int row_buffer_size;
+   double *block_inputs[4 + MAX_NEIGHBOURS];
+   double *block_output;
+   std::vector<std::vector<double>> scratch_buffers; // v2.2.31: see scratch()
+
+public:
+   // Opt-in profiling counters of the row evaluation, v2.2.31 (mt_exprstats)
+   // A block is Program::BLOCK_SIZE lanes, partial blocks at the row ends are evaluated as whole ones, too.
+   // ops: instructions of the compiled program executed, per lane, counted on every path
+   struct Profile {
+     enum Path { PATH_DOUBLE, PATH_INT, PATH_FLOAT, PATH_INTERPRETER, PATH_COUNT };
+     uint64_t blocks[PATH_COUNT];
+     uint64_t ops[Program::OP_SCALE + 1];
+     uint64_t int_ops; // instructions of the int32 program (PATH_INT)
+
+     Profile() { clear(); }
+     void clear();
+     void add(const Profile &other);
+     static const char *path_name(int path);
+     static const char *op_name(int code);
+   };
+private:
+   bool profiling;
+   Profile profile;
+   void count_block(int path);
+
    void calc_helpers();
 
+   void get_variables(double *variables, int _bitdepth, bool _chroma) const;
+   void prepare_program(int _bitdepth, bool _chroma, bool integer_inputs);
+   void run_block(int nInputs);
+   // block of srcs[k] in the compute_row functions: x, y, z, a are followed by the neighbours
+   int input_block(int k, int nInputs) const { return k < nInputs ? k : 4 + k - nInputs; }
+   bool prepare_integer(int input_max);
+   void get_int_blocks(int **inputs, int *&output);
+   void run_block_int();
+   // pixel <-> expression value conversions of compute_row_byte and compute_row_word
+   void convert_inputs_byte(double *in, const Byte *src, int n) const;
+   void convert_output_byte(Byte *dst, const double *out, int n) const;
+   void convert_inputs_word(double *in, const Word *src, int n, int bits_per_pixel) const;
+   void convert_output_word(Word *dst, const double *out, int n, int bits_per_pixel) const;
+
    double rec_compute();
    double rec_compute_old();
    String rec_infix();
 
 public:
    
-   Context(const std::deque<Symbol> &expression);
-   Context(const std::deque<Symbol> &expression, String scale_inputs, int param_clamp_float);
+   Context(const std::vector<Symbol> &expression);
+   Context(const std::vector<Symbol> &expression, String scale_inputs, int param_clamp_float);
 
    ~Context();
 
+   Context(const Context &) = delete;
+   Context &operator=(const Context &) = delete;
+
+   // CPU_AVX2 or CPU_SSE4_1: rows are evaluated by the compiled program, otherwise pixel by pixel
+   void SetCpuFlags(int flags) { cpu_flags = flags; }
+   // v2.2.31: count the evaluated blocks and instructions (Profile), off by default
+   void EnableProfile(bool enable) { profiling = enable; }
+   const Profile &get_profile() const { return profile; }
+   void clear_profile() { profile.clear(); }
+   // v2.2.31: memory of the caller kept with the Context (the realtime rows of mt_luts), freed with it.
+   // At least bytes of buffer index (0, 1, ...), 8 byte aligned, the content is kept until the next call.
+   void *scratch(int index, size_t bytes);
+
    bool SetScaleInputs(String scale_inputs); // v2.2.15-
 
    bool check();
@@ -311,6 +413,37 @@ public:
    double compute_2(double x, double y, int bitdepth, bool chroma);
    double compute_3(double x, double y, double z, int bitdepth, bool chroma);
    double compute_4(double x, double y, double z, double a, int bitdepth, bool chroma);
+
+   // Evaluate a whole row, srcs holds nInputs rows in x, y, z, a order. dst may be the same as srcs[0].
+   // Results and get_compute_error() are identical to the per-pixel compute_xxx functions:
+   // compute_row: no conversion, like compute_1..compute_4
+   // compute_row_byte: like compute_byte_x..compute_byte_xyza
+   // compute_row_word: like compute_word_x..compute_word_xyza, inputs are clamped to the valid range below 16 bits
+   // compute_row_float: like compute_float_x..compute_float_xyza
+   void compute_row(double *dst, const double * const *srcs, int nInputs, int width, int _bitdepth, bool _chroma);
+   void compute_row_byte(Byte *dst, const Byte * const *srcs, int nInputs, int width);
+   void compute_row_word(Word *dst, const Word * const *srcs, int nInputs, int width, int bits_per_pixel);
+   void compute_row_float(Float *dst, const Float * const *srcs, int nInputs, int width, bool _chroma);
+   // Relative pixel operands (x[-1,0]) and other plane operands (x.Y) of the expression, v2.2.31. The compute_row functions read them after the
+   // nInputs rows: srcs[nInputs + k] is the row of get_neighbours()[k], gathered by the caller with clamped borders.
+   // The LUT and separable functions do not support them.
+   const std::vector<Neighbour> &get_neighbours() const { return neighbours; }
+   // LUT construction: one row of 1 << bits_per_pixel entries, input ramp_input runs over all pixel values,
+   // the other inputs are fixed to values[k]. compute_lut_row: unconverted integer inputs, like compute_float_xy_intinput
+   void compute_lut_row(double *dst, const int *values, int nInputs, int ramp_input, int bits_per_pixel);
+   void compute_lut_row_byte(Byte *dst, const int *values, int nInputs, int ramp_input);
+   void compute_lut_row_word(Word *dst, const int *values, int nInputs, int ramp_input, int bits_per_pixel);
+   // Inputs the expression really reads when evaluated on bits_per_pixel integer pixels (compute_row_byte,
+   // compute_row_word and the lut rows): bit 0 = x, 1 = y, 2 = z, 3 = a
+   int get_used_inputs(int bits_per_pixel);
+   // v2.2.31: instructions of the compiled expression for bits_per_pixel pixels (32: float), a cost estimate
+   int get_program_length(int bits_per_pixel);
+   // Expressions of the form tail(h1(x) op h2(y) ...) with integer h values, op: + - min max (Program::find_separable)
+   // are split into a 1D table per input and one over the combined values, results are the same as compute_row_byte
+   // and compute_row_word. False when the expression has no such form, a leaf value is not an integer or the combined
+   // range is too large. Needs CPU_AVX2 or CPU_SSE4_1.
+   static const int MAX_SEPARABLE_TAIL = 1 << 20;
+   bool compute_separable(SeparableTables &tables, int bits_per_pixel);
    // v2.2.1: variable a
    //double compute(double x, double y = -1.0, double z = -1.0, double a = -1.0, int bitdepth, bool chroma);
    
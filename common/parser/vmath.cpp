@@ -0,0 +1,128 @@
+#include "vmath_impl.h"
+#include <cstdint>
+#include <cstring>
+
+using namespace Filtering;
+using namespace Filtering::Parser;
+
+// Scalar backends of the kernels: the reference values, and single precision without SSE4.1.
+// The bit operations go through the integer representation like the SIMD versions.
+
+namespace {
+
+struct D1 {
+  typedef double T;
+  typedef double V;
+  typedef bool M;
+  static const int N = 1;
+  static const int FULL = 1;
+
+  static uint64_t bits(double x) { uint64_t u; memcpy(&u, &x, sizeof(u)); return u; }
+  static double value(uint64_t u) { double x; memcpy(&x, &u, sizeof(x)); return x; }
+
+  static V load(const double *p) { return *p; }
+  static void store(double *p, V x) { *p = x; }
+  static V set(double x) { return x; }
+  static V add(V a, V b) { return a + b; }
+  static V sub(V a, V b) { return a - b; }
+  static V mul(V a, V b) { return a * b; }
+  static V div(V a, V b) { return a / b; }
+  static V sqrt(V a) { return std::sqrt(a); }
+  static V round(V a) { return std::nearbyint(a); }
+  static V floor(V a) { return std::floor(a); }
+  static V abs(V a) { return value(bits(a) & 0x7FFFFFFFFFFFFFFFull); }
+  static V signbits(V a) { return value(bits(a) & 0x8000000000000000ull); }
+  static V bxor(V a, V b) { return value(bits(a) ^ bits(b)); }
+  static M lt(V a, V b) { return a < b; }
+  static M le(V a, V b) { return a <= b; }
+  static M gt(V a, V b) { return a > b; }
+  static M ge(V a, V b) { return a >= b; }
+  static M eq(V a, V b) { return a == b; }
+  static M mand(M a, M b) { return a && b; }
+  static M mor(M a, M b) { return a || b; }
+  static M mandnot(M a, M b) { return a && !b; }
+  static V select(M m, V a, V b) { return m ? a : b; }
+  static int mask_bits(M m) { return m ? 1 : 0; }
+  static V clear_low32(V a) { return value(bits(a) & 0xFFFFFFFF00000000ull); }
+  // k + 1.5 * 2^52 + 1023 holds k + 1023 in the low mantissa bits
+  static V pow2i(V k) { return value(bits(k + 6755399441056767.0) << 52); }
+  static V exponent(V a) { return value((bits(a) >> 52) | 0x4330000000000000ull) - 4503599627370496.0; }
+  static V mantissa(V a) { return value((bits(a) & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull); }
+};
+
+struct F1 {
+  typedef float T;
+  typedef float V;
+  typedef bool M;
+  static const int N = 1;
+  static const int FULL = 1;
+
+  static uint32_t bits(float x) { uint32_t u; memcpy(&u, &x, sizeof(u)); return u; }
+  static float value(uint32_t u) { float x; memcpy(&x, &u, sizeof(x)); return x; }
+
+  static V load(const float *p) { return *p; }
+  static void store(float *p, V x) { *p = x; }
+  static V set(float x) { return x; }
+  static V add(V a, V b) { return a + b; }
+  static V sub(V a, V b) { return a - b; }
+  static V mul(V a, V b) { return a * b; }
+  static V div(V a, V b) { return a / b; }
+  static V sqrt(V a) { return std::sqrt(a); }
+  static V round(V a) { return std::nearbyint(a); }
+  static V floor(V a) { return std::floor(a); }
+  static V abs(V a) { return value(bits(a) & 0x7FFFFFFFu); }
+  static V signbits(V a) { return value(bits(a) & 0x80000000u); }
+  static V bxor(V a, V b) { return value(bits(a) ^ bits(b)); }
+  static M lt(V a, V b) { return a < b; }
+  static M le(V a, V b) { return a <= b; }
+  static M gt(V a, V b) { return a > b; }
+  static M ge(V a, V b) { return a >= b; }
+  static M eq(V a, V b) { return a == b; }
+  static M mand(M a, M b) { return a && b; }
+  static M mor(M a, M b) { return a || b; }
+  static M mandnot(M a, M b) { return a && !b; }
+  static V select(M m, V a, V b) { return m ? a : b; }
+  static int mask_bits(M m) { return m ? 1 : 0; }
+  // k + 1.5 * 2^23 + 127 holds k + 127 in the low mantissa bits
+  static V pow2i(V k) { return value(bits(k + 12583039.0f) << 23); }
+  static V exponent(V a) { return value(((bits(a) >> 23) & 0xFF) | 0x4B000000u) - 8388608.0f; }
+  static V mantissa(V a) { return value((bits(a) & 0x007FFFFFu) | 0x3F800000u); }
+};
+
+using namespace VMathImpl;
+
+double pow_fallback(double x, double y)
+{
+  if (y == std::floor(y) && std::fabs(y) <= 2.0)
+    return powi<D1>(x, (int)std::fabs(y), y < 0);
+  return std::pow(x, y);
+}
+
+} // namespace
+
+int VMath::arguments(int function)
+{
+  return function == POW || function == ATAN2 ? 2 : 1;
+}
+
+double VMath::pow(double x, double y) { return scalar2<D1, pow_kernel<D1>, pow_fallback>(x, y); }
+double VMath::tan(double x) { return scalar1<D1, tan_kernel<D1>, tan_fallback>(x); }
+
+void VMath::run_float_c(int function, float *d, const float *a, const float *b, int count)
+{
+  if (function == POW || function == TAN) {
+    for (int i = 0; i < count; i++)
+      d[i] = (float)(function == POW ? VMath::pow(a[i], b[i]) : VMath::tan(a[i]));
+    return;
+  }
+  switch (function) {
+  case EXP: for (int i = 0; i < count; i++) d[i] = scalar1<F1, expf_kernel<F1>, expf_fallback>(a[i]); break;
+  case LOG: for (int i = 0; i < count; i++) d[i] = scalar1<F1, logf_kernel<F1>, logf_fallback>(a[i]); break;
+  case SIN: for (int i = 0; i < count; i++) d[i] = scalar1<F1, sinf_kernel<F1>, sinf_fallback>(a[i]); break;
+  case COS: for (int i = 0; i < count; i++) d[i] = scalar1<F1, cosf_kernel<F1>, cosf_fallback>(a[i]); break;
+  case ASIN: for (int i = 0; i < count; i++) d[i] = scalar1<F1, asinf_kernel<F1>, asinf_fallback>(a[i]); break;
+  case ACOS: for (int i = 0; i < count; i++) d[i] = scalar1<F1, acosf_kernel<F1>, acosf_fallback>(a[i]); break;
+  case ATAN: for (int i = 0; i < count; i++) d[i] = scalar1<F1, atanf_kernel<F1>, atanf_fallback>(a[i]); break;
+  case ATAN2: for (int i = 0; i < count; i++) d[i] = scalar2<F1, atan2f_kernel<F1>, atan2f_fallback>(a[i], b[i]); break;
+  }
+}
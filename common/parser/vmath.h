@@ -0,0 +1,58 @@
+#ifndef __Mt_VMath_H__
+#define __Mt_VMath_H__
+
+namespace Filtering { namespace Parser { namespace VMath {
+
+// Vectorized math functions of the expression engine, v2.2.31
+// exp, log, ^ (pow), sin, cos, tan, asin, acos, atan and atan2 in single precision are polynomial/rational
+// approximations built from add, sub, mul, div, sqrt, rounding and exponent bit manipulation only. They are used
+// by the compiled programs with precision="float" (OP_MATH) only, double precision evaluation (symbols,
+// interpreter, compile time folding, compiled programs) keeps the C library and its results.
+// The C, SSE4.1 and AVX2 block versions run the same operations on 1/4/8 lanes and give bit-identical results.
+// No fused multiply-add is used, the kernels must not be contracted.
+// Arguments outside of the fast range of a function are passed lane by lane to the C library function.
+//
+// Single precision, against the correctly rounded result (ulp: units in the last place):
+//   exp |x| <= 87, log normal x > 0           < 1 ulp
+//   sin, cos |x| <= 8192                      < 2 ulp
+//   asin, acos                                < 2.5 ulp
+//   atan, atan2                               < 3.5 ulp
+//   pow, tan                                  calculated in double (below) and rounded to float
+// Double precision pow and tan, only used inside the float versions, against a 64 bit mantissa reference:
+//   pow   normal x > 0, |y*log(x)| <= 708     < 1 ulp for |y| <= 4, < 2.5 ulp for |y| <= 100
+//         y = 0.5                             sqrt(x), correctly rounded
+//         integral |y| <= 2, any x            multiplied out: "x 2 ^" is x*x, "x -2 ^" 1/(x*x) (< 1.5 ulp)
+//   tan   |x| <= 2^20                         < 2.5 ulp  (fdlibm sin/cos kernels, one division)
+// The measured figures are listed in vmath_impl.h.
+
+enum Function {
+   EXP,
+   LOG,
+   POW,   // x ^ y
+   SIN,
+   COS,
+   TAN,
+   ASIN,
+   ACOS,
+   ATAN,
+   ATAN2, // atan2(y, x): the first argument is y
+   FUNCTION_COUNT
+};
+
+// 1 or 2
+int arguments(int function);
+
+// the double versions of the float pow and tan, the reference of their block versions
+double pow(double x, double y);
+double tan(double x);
+
+// count: multiple of 8, 32 byte aligned arrays. b: second argument of pow and atan2.
+// d may be the same array as a or b.
+// single precision, pow and tan are calculated by the double version
+void run_float_c(int function, float *d, const float *a, const float *b, int count);
+void run_float_sse41(int function, float *d, const float *a, const float *b, int count);
+void run_float_avx2(int function, float *d, const float *a, const float *b, int count);
+
+} } } // namespace VMath, Parser, Filtering
+
+#endif
@@ -0,0 +1,103 @@
+#include "vmath_impl.h"
+#include <immintrin.h>
+
+using namespace Filtering;
+using namespace Filtering::Parser;
+
+// AVX2 backends of the kernels: 4 doubles or 8 floats per value
+
+namespace {
+
+struct D4 {
+  typedef double T;
+  typedef __m256d V;
+  typedef __m256d M;
+  static const int N = 4;
+  static const int FULL = 15;
+
+  static MT_FORCEINLINE V load(const double *p) { return _mm256_load_pd(p); }
+  static MT_FORCEINLINE void store(double *p, V x) { _mm256_store_pd(p, x); }
+  static MT_FORCEINLINE V set(double x) { return _mm256_set1_pd(x); }
+  static MT_FORCEINLINE V add(V a, V b) { return _mm256_add_pd(a, b); }
+  static MT_FORCEINLINE V sub(V a, V b) { return _mm256_sub_pd(a, b); }
+  static MT_FORCEINLINE V mul(V a, V b) { return _mm256_mul_pd(a, b); }
+  static MT_FORCEINLINE V div(V a, V b) { return _mm256_div_pd(a, b); }
+  static MT_FORCEINLINE V sqrt(V a) { return _mm256_sqrt_pd(a); }
+  static MT_FORCEINLINE V round(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V floor(V a) { return _mm256_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V abs(V a) { return _mm256_andnot_pd(_mm256_set1_pd(-0.0), a); }
+  static MT_FORCEINLINE V signbits(V a) { return _mm256_and_pd(_mm256_set1_pd(-0.0), a); }
+  static MT_FORCEINLINE V bxor(V a, V b) { return _mm256_xor_pd(a, b); }
+  static MT_FORCEINLINE M lt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LT_OQ); }
+  static MT_FORCEINLINE M le(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_LE_OQ); }
+  static MT_FORCEINLINE M gt(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GT_OQ); }
+  static MT_FORCEINLINE M ge(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_GE_OQ); }
+  static MT_FORCEINLINE M eq(V a, V b) { return _mm256_cmp_pd(a, b, _CMP_EQ_OQ); }
+  static MT_FORCEINLINE M mand(M a, M b) { return _mm256_and_pd(a, b); }
+  static MT_FORCEINLINE M mor(M a, M b) { return _mm256_or_pd(a, b); }
+  static MT_FORCEINLINE M mandnot(M a, M b) { return _mm256_andnot_pd(b, a); }
+  static MT_FORCEINLINE V select(M m, V a, V b) { return _mm256_blendv_pd(b, a, m); }
+  static MT_FORCEINLINE int mask_bits(M m) { return _mm256_movemask_pd(m); }
+  static MT_FORCEINLINE V clear_low32(V a) { return _mm256_and_pd(a, _mm256_castsi256_pd(_mm256_set1_epi64x((long long)0xFFFFFFFF00000000ull))); }
+  static MT_FORCEINLINE V pow2i(V k) { return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_castpd_si256(_mm256_add_pd(k, _mm256_set1_pd(6755399441056767.0))), 52)); }
+  static MT_FORCEINLINE V exponent(V a)
+  {
+    __m256i e = _mm256_or_si256(_mm256_srli_epi64(_mm256_castpd_si256(a), 52), _mm256_set1_epi64x(0x4330000000000000ll));
+    return _mm256_sub_pd(_mm256_castsi256_pd(e), _mm256_set1_pd(4503599627370496.0));
+  }
+  static MT_FORCEINLINE V mantissa(V a)
+  {
+    __m256i m = _mm256_and_si256(_mm256_castpd_si256(a), _mm256_set1_epi64x(0x000FFFFFFFFFFFFFll));
+    return _mm256_castsi256_pd(_mm256_or_si256(m, _mm256_set1_epi64x(0x3FF0000000000000ll)));
+  }
+};
+
+struct F8 {
+  typedef float T;
+  typedef __m256 V;
+  typedef __m256 M;
+  static const int N = 8;
+  static const int FULL = 255;
+
+  static MT_FORCEINLINE V load(const float *p) { return _mm256_load_ps(p); }
+  static MT_FORCEINLINE void store(float *p, V x) { _mm256_store_ps(p, x); }
+  static MT_FORCEINLINE V set(float x) { return _mm256_set1_ps(x); }
+  static MT_FORCEINLINE V add(V a, V b) { return _mm256_add_ps(a, b); }
+  static MT_FORCEINLINE V sub(V a, V b) { return _mm256_sub_ps(a, b); }
+  static MT_FORCEINLINE V mul(V a, V b) { return _mm256_mul_ps(a, b); }
+  static MT_FORCEINLINE V div(V a, V b) { return _mm256_div_ps(a, b); }
+  static MT_FORCEINLINE V sqrt(V a) { return _mm256_sqrt_ps(a); }
+  static MT_FORCEINLINE V round(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V floor(V a) { return _mm256_round_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V abs(V a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+  static MT_FORCEINLINE V signbits(V a) { return _mm256_and_ps(_mm256_set1_ps(-0.0f), a); }
+  static MT_FORCEINLINE V bxor(V a, V b) { return _mm256_xor_ps(a, b); }
+  static MT_FORCEINLINE M lt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+  static MT_FORCEINLINE M le(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_LE_OQ); }
+  static MT_FORCEINLINE M gt(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GT_OQ); }
+  static MT_FORCEINLINE M ge(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_GE_OQ); }
+  static MT_FORCEINLINE M eq(V a, V b) { return _mm256_cmp_ps(a, b, _CMP_EQ_OQ); }
+  static MT_FORCEINLINE M mand(M a, M b) { return _mm256_and_ps(a, b); }
+  static MT_FORCEINLINE M mor(M a, M b) { return _mm256_or_ps(a, b); }
+  static MT_FORCEINLINE M mandnot(M a, M b) { return _mm256_andnot_ps(b, a); }
+  static MT_FORCEINLINE V select(M m, V a, V b) { return _mm256_blendv_ps(b, a, m); }
+  static MT_FORCEINLINE int mask_bits(M m) { return _mm256_movemask_ps(m); }
+  static MT_FORCEINLINE V pow2i(V k) { return _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_castps_si256(_mm256_add_ps(k, _mm256_set1_ps(12583039.0f))), 23)); }
+  static MT_FORCEINLINE V exponent(V a)
+  {
+    __m256i e = _mm256_and_si256(_mm256_srli_epi32(_mm256_castps_si256(a), 23), _mm256_set1_epi32(0xFF));
+    return _mm256_sub_ps(_mm256_castsi256_ps(_mm256_or_si256(e, _mm256_set1_epi32(0x4B000000))), _mm256_set1_ps(8388608.0f));
+  }
+  static MT_FORCEINLINE V mantissa(V a)
+  {
+    __m256i m = _mm256_and_si256(_mm256_castps_si256(a), _mm256_set1_epi32(0x007FFFFF));
+    return _mm256_castsi256_ps(_mm256_or_si256(m, _mm256_set1_epi32(0x3F800000)));
+  }
+};
+
+} // namespace
+
+void VMath::run_float_avx2(int function, float *d, const float *a, const float *b, int count)
+{
+  VMathImpl::run_float<F8, D4>(function, d, a, b, count);
+}
@@ -0,0 +1,568 @@
+#ifndef __Mt_VMath_Impl_H__
+#define __Mt_VMath_Impl_H__
+
+// Kernels of the vector math functions (vmath.h), included by vmath.cpp (scalar), vmath_sse41.cpp and
+// vmath_avx2.cpp. They are written once against a backend B and instantiated per instruction set:
+//   typedef V (value), M (lane mask), const int N (lanes), FULL (mask_bits of an all true mask)
+//   load, store, set, add, sub, mul, div, sqrt, round (to nearest even), floor, abs, signbits (sign bits only),
+//   bxor (bitwise), lt, le, gt, ge, eq (ordered), mand, mor, mandnot (a and not b), select, mask_bits
+//   pow2i(k): 2^k for an integral k in the normal exponent range
+//   exponent(x): biased exponent as value, mantissa(x): x scaled into [1, 2), both for positive normal x
+//   clear_low32(x) (double): the low 32 bits of the mantissa zeroed
+// Every backend applies the same IEEE operations in the same order on every lane, the results are identical.
+// Kernels also return a mask of the lanes within their fast range, the others are recalculated by the
+// fallback (the C library function).
+//
+// Measured maximum errors (ulp, 2^22 random arguments per range, against long double for double and against
+// the rounded double result for float, special values compared with the C library):
+//   double pow 0.89 (|y| <= 4), 2.39 (|y| <= 100), 1.46 (1 / (x * x)), tan 2.17
+//   float  exp 0.97, log 0.81, sin 1.85, cos 1.96, asin 2.35, acos 1.26, atan 2.80, atan2 3.10,
+//          pow and tan by the double kernels: 0.50
+
+#include "vmath.h"
+#include "../utils/utils.h"
+#include <cmath>
+
+// a * b + c must stay two roundings (gcc: -ffp-contract=off is set for the vmath files in CMakeLists.txt)
+#if defined(__clang__)
+#pragma STDC FP_CONTRACT OFF
+#elif defined(_MSC_VER)
+#pragma fp_contract (off)
+#endif
+
+namespace {
+
+namespace VMathImpl {
+
+// r = c[0] + x * (c[1] + x * (... + x * c[n-1]))
+template<class B, typename T, int n>
+MT_FORCEINLINE typename B::V horner(typename B::V x, const T (&c)[n])
+{
+  typename B::V r = B::set(c[n - 1]);
+  for (int j = n - 2; j >= 0; j--)
+    r = B::add(B::mul(r, x), B::set(c[j]));
+  return r;
+}
+
+// ------------------------------------------------------------------------------------------------------
+// double precision
+
+// a + b = s + e exactly
+template<class B>
+MT_FORCEINLINE void two_sum(typename B::V a, typename B::V b, typename B::V &s, typename B::V &e)
+{
+  s = B::add(a, b);
+  typename B::V bb = B::sub(s, a);
+  e = B::add(B::sub(a, B::sub(s, bb)), B::sub(b, bb));
+}
+
+// a * b = p + e exactly (Dekker, no fma), |a|, |b| < 2^996
+template<class B>
+MT_FORCEINLINE void two_prod(typename B::V a, typename B::V b, typename B::V &p, typename B::V &e)
+{
+  typedef typename B::V V;
+  const V split = B::set(134217729.0); // 2^27 + 1
+  V ca = B::mul(split, a);
+  V ah = B::sub(ca, B::sub(ca, a));
+  V al = B::sub(a, ah);
+  V cb = B::mul(split, b);
+  V bh = B::sub(cb, B::sub(cb, b));
+  V bl = B::sub(b, bh);
+  p = B::mul(a, b);
+  e = B::add(B::add(B::add(B::sub(B::mul(ah, bh), p), B::mul(ah, bl)), B::mul(al, bh)), B::mul(al, bl));
+}
+
+// ln2 split as in fdlibm: k * LN2_HI is exact for |k| < 2^21
+const double LN2_HI = 6.93147180369123816490e-01;
+const double LN2_LO = 1.90821492927058770002e-10;
+const double INV_LN2 = 1.44269504088896338700e+00;
+
+// exp(hi - lo) * 2^k, |hi - lo| <= 0.5 ln2, fdlibm rational approximation
+template<class B>
+MT_FORCEINLINE typename B::V exp_core(typename B::V hi, typename B::V lo, typename B::V k)
+{
+  typedef typename B::V V;
+  static const double P[] = {
+    1.66666666666666019037e-01, -2.77777777770155933842e-03, 6.61375632143793436117e-05,
+    -1.65339022054652515390e-06, 4.13813679705723846039e-08
+  };
+  V r = B::sub(hi, lo);
+  V t = B::mul(r, r);
+  V c = B::sub(r, B::mul(t, horner<B>(t, P)));
+  V y = B::sub(B::set(1.0), B::sub(B::sub(lo, B::div(B::mul(r, c), B::sub(B::set(2.0), c))), hi));
+  return B::mul(y, B::pow2i(k));
+}
+
+// log(x) = hi + lo, x positive and normal. x = 2^k (1 + f), log(1 + f) = 2 atanh(s), s = f / (2 + f):
+// 2 s in double-double, the series tail s^3 (2/3 + 2/5 s^2 + ...) is 1% of it
+template<class B>
+MT_FORCEINLINE void log_dd(typename B::V x, typename B::V &hi, typename B::V &lo)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  static const double Q[] = {
+    2.0 / 3, 2.0 / 5, 2.0 / 7, 2.0 / 9, 2.0 / 11, 2.0 / 13, 2.0 / 15, 2.0 / 17, 2.0 / 19, 2.0 / 21, 2.0 / 23, 2.0 / 25
+  };
+  const V one = B::set(1.0);
+  const V two = B::set(2.0);
+  V k = B::sub(B::exponent(x), B::set(1023.0));
+  V m = B::mantissa(x);
+  M big = B::gt(m, B::set(1.41421356237309504880));
+  m = B::select(big, B::mul(m, B::set(0.5)), m);
+  k = B::select(big, B::add(k, one), k);
+  V f = B::sub(m, one); // exact
+  V den = B::add(two, f);
+  V den_lo = B::sub(f, B::sub(den, two)); // 2 + f = den + den_lo
+  V s = B::div(f, den);
+  V ph, pl;
+  two_prod<B>(s, den, ph, pl);
+  V s_lo = B::div(B::sub(B::sub(B::sub(f, ph), pl), B::mul(s, den_lo)), den);
+  V z = B::mul(s, s);
+  V tail = B::mul(B::mul(s, z), horner<B>(z, Q));
+  V sum, err;
+  two_sum<B>(B::mul(k, B::set(LN2_HI)), B::add(s, s), sum, err);
+  V rest = B::add(err, B::add(B::mul(k, B::set(LN2_LO)), B::add(B::add(s_lo, s_lo), tail)));
+  hi = B::add(sum, rest);
+  lo = B::sub(rest, B::sub(hi, sum));
+}
+
+// integral |y| <= 2: multiplied out, see pow_fallback
+template<class B>
+MT_FORCEINLINE typename B::M pow_small_integer(typename B::V y)
+{
+  return B::mand(B::eq(B::floor(y), y), B::le(B::abs(y), B::set(2.0)));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V powi(typename B::V x, int n, bool inverse)
+{
+  typename B::V r = B::set(1.0);
+  typename B::V p = x;
+  while (true) {
+    if (n & 1)
+      r = B::mul(r, p);
+    n >>= 1;
+    if (!n)
+      break;
+    p = B::mul(p, p);
+  }
+  return inverse ? B::div(B::set(1.0), r) : r;
+}
+
+// exp(y * log(x)) with the product in double-double
+template<class B>
+MT_FORCEINLINE typename B::V pow_kernel(typename B::V x, typename B::V y, typename B::M &valid)
+{
+  typedef typename B::V V;
+  V lh, ll;
+  log_dd<B>(x, lh, ll);
+  V ph, pe;
+  two_prod<B>(y, lh, ph, pe);
+  V pl = B::add(pe, B::mul(y, ll));
+  V k = B::round(B::mul(ph, B::set(INV_LN2)));
+  V hi = B::sub(ph, B::mul(k, B::set(LN2_HI)));
+  V lo = B::sub(B::mul(k, B::set(LN2_LO)), pl);
+  V r = exp_core<B>(hi, lo, k);
+  r = B::select(B::eq(y, B::set(0.5)), B::sqrt(x), r);
+  valid = B::mand(B::ge(x, B::set(2.2250738585072014e-308)), B::lt(x, B::set(HUGE_VAL)));
+  valid = B::mand(valid, B::lt(B::abs(y), B::set(1.3407807929942597e+154))); // 2^512
+  valid = B::mand(valid, B::le(B::abs(ph), B::set(708.0)));
+  valid = B::mandnot(valid, pow_small_integer<B>(y));
+  return r;
+}
+
+// fdlibm sin and cos kernels on [-pi/4, pi/4], x + y is the reduced argument
+template<class B>
+MT_FORCEINLINE typename B::V ksin(typename B::V x, typename B::V y)
+{
+  typedef typename B::V V;
+  static const double S[] = {
+    8.33333333332248946124e-03, -1.98412698298579493134e-04, 2.75573137070700676789e-06
+  };
+  static const double S5[] = { -2.50507602534068634195e-08, 1.58969099521155010221e-10 };
+  V z = B::mul(x, x);
+  V w = B::mul(z, z);
+  V r = B::add(horner<B>(z, S), B::mul(B::mul(z, w), horner<B>(z, S5)));
+  V v = B::mul(z, x);
+  V t = B::sub(B::mul(z, B::sub(B::mul(B::set(0.5), y), B::mul(v, r))), y);
+  return B::sub(x, B::sub(t, B::mul(v, B::set(-1.66666666666666324348e-01))));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V kcos(typename B::V x, typename B::V y)
+{
+  typedef typename B::V V;
+  static const double C[] = {
+    4.16666666666666019037e-02, -1.38888888888741095749e-03, 2.48015872894767294178e-05
+  };
+  static const double C4[] = {
+    -2.75573143513906633035e-07, 2.08757232129817482790e-09, -1.13596475577881948265e-11
+  };
+  const V one = B::set(1.0);
+  V z = B::mul(x, x);
+  V w = B::mul(z, z);
+  V r = B::add(B::mul(z, horner<B>(z, C)), B::mul(B::mul(w, w), horner<B>(z, C4)));
+  V hz = B::mul(B::set(0.5), z);
+  w = B::sub(one, hz);
+  return B::add(w, B::add(B::sub(B::sub(one, w), hz), B::sub(B::mul(z, r), B::mul(x, y))));
+}
+
+// x = k pi/2 + r + rr, n = k mod 4, |x| <= 2^20: k * PIO2_x are exact, x - k * PIO2_1 too
+template<class B>
+MT_FORCEINLINE void trig_reduce(typename B::V x, typename B::V &r, typename B::V &rr, typename B::V &n)
+{
+  typedef typename B::V V;
+  V k = B::round(B::mul(x, B::set(6.36619772367581382433e-01)));
+  V t = B::sub(x, B::mul(k, B::set(1.57079632673412561417e+00)));
+  V r1, e1;
+  two_sum<B>(t, B::mul(k, B::set(-6.07710050630396597660e-11)), r1, e1);
+  V lo = B::sub(B::sub(e1, B::mul(k, B::set(2.02226624871116645580e-21))), B::mul(k, B::set(8.47842766036889956997e-32)));
+  r = B::add(r1, lo);
+  rr = B::add(B::sub(r1, r), lo);
+  n = B::sub(k, B::mul(B::set(4.0), B::floor(B::mul(k, B::set(0.25)))));
+}
+
+const double TRIG_MAX = 1048576.0;
+
+template<class B>
+MT_FORCEINLINE typename B::V tan_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  V r, rr, n;
+  valid = B::le(B::abs(x), B::set(TRIG_MAX));
+  trig_reduce<B>(x, r, rr, n);
+  V s = ksin<B>(r, rr);
+  V c = kcos<B>(r, rr);
+  M odd = B::mor(B::eq(n, B::set(1.0)), B::eq(n, B::set(3.0)));
+  V v = B::select(odd, B::div(B::bxor(c, B::set(-0.0)), s), B::div(s, c));
+  return B::select(B::lt(B::abs(x), B::set(1.4901161193847656e-08)), x, v);
+}
+
+inline double tan_fallback(double x) { return std::tan(x); }
+
+// ------------------------------------------------------------------------------------------------------
+// single precision, cephes approximations
+
+template<class B>
+MT_FORCEINLINE typename B::V expf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  static const float P[] = {
+    5.0000001201E-1f, 1.6666665459E-1f, 4.1665795894E-2f, 8.3334519073E-3f, 1.3981999507E-3f, 1.9875691500E-4f
+  };
+  valid = B::le(B::abs(x), B::set(87.0f));
+  V k = B::round(B::mul(x, B::set(1.44269504088896341f)));
+  V r = B::sub(x, B::mul(k, B::set(0.693359375f)));
+  r = B::sub(r, B::mul(k, B::set(-2.12194440e-4f)));
+  V z = B::mul(r, r);
+  V y = B::add(B::add(B::mul(horner<B>(r, P), z), r), B::set(1.0f));
+  return B::mul(y, B::pow2i(k));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V logf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  static const float P[] = {
+    3.3333331174E-1f, -2.4999993993E-1f, 2.0000714765E-1f, -1.6668057665E-1f, 1.4249322787E-1f,
+    -1.2420140846E-1f, 1.1676998740E-1f, -1.1514610310E-1f, 7.0376836292E-2f
+  };
+  const V one = B::set(1.0f);
+  valid = B::mand(B::ge(x, B::set(1.17549435e-38f)), B::lt(x, B::set(HUGE_VALF)));
+  V e = B::sub(B::exponent(x), B::set(127.0f));
+  V m = B::mantissa(x);
+  M big = B::ge(m, B::set(1.41421356f));
+  V f = B::select(big, B::sub(B::mul(m, B::set(0.5f)), one), B::sub(m, one));
+  e = B::select(big, B::add(e, one), e);
+  V z = B::mul(f, f);
+  V y = B::mul(f, B::mul(z, horner<B>(f, P)));
+  y = B::add(y, B::mul(B::set(-2.12194440e-4f), e));
+  y = B::add(y, B::mul(B::set(-0.5f), z));
+  V r = B::add(f, y);
+  return B::add(r, B::mul(B::set(0.693359375f), e));
+}
+
+// |x| = j pi/4 + r, j even, q = j mod 8. pi/4 in 4 parts, the first 3 products are exact for |x| <= TRIGF_MAX
+template<class B>
+MT_FORCEINLINE void trigf_reduce(typename B::V ax, typename B::V &r, typename B::V &q)
+{
+  typedef typename B::V V;
+  V j = B::floor(B::mul(ax, B::set(1.27323954473516f)));
+  j = B::add(j, B::sub(j, B::mul(B::set(2.0f), B::floor(B::mul(j, B::set(0.5f))))));
+  r = B::sub(ax, B::mul(j, B::set(0.78515625f)));
+  r = B::sub(r, B::mul(j, B::set(2.4187564849853515625e-4f)));
+  r = B::sub(r, B::mul(j, B::set(3.7747668102383614e-8f)));
+  r = B::sub(r, B::mul(j, B::set(1.2816720341285448e-12f)));
+  q = B::sub(j, B::mul(B::set(8.0f), B::floor(B::mul(j, B::set(0.125f)))));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V ksinf(typename B::V r)
+{
+  static const float S[] = { -1.6666654611E-1f, 8.3321608736E-3f, -1.9515295891E-4f };
+  typename B::V z = B::mul(r, r);
+  return B::add(B::mul(B::mul(horner<B>(z, S), z), r), r);
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V kcosf(typename B::V r)
+{
+  static const float C[] = { 4.166664568298827E-002f, -1.388731625493765E-003f, 2.443315711809948E-005f };
+  typename B::V z = B::mul(r, r);
+  typename B::V y = B::mul(B::mul(horner<B>(z, C), z), z);
+  return B::add(B::sub(y, B::mul(B::set(0.5f), z)), B::set(1.0f));
+}
+
+const float TRIGF_MAX = 8192.0f;
+
+template<class B>
+MT_FORCEINLINE typename B::V sinf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  V ax = B::abs(x);
+  valid = B::le(ax, B::set(TRIGF_MAX));
+  V r, q;
+  trigf_reduce<B>(ax, r, q);
+  V v = B::select(B::mor(B::eq(q, B::set(2.0f)), B::eq(q, B::set(6.0f))), kcosf<B>(r), ksinf<B>(r));
+  v = B::select(B::ge(q, B::set(4.0f)), B::bxor(v, B::set(-0.0f)), v);
+  return B::bxor(v, B::signbits(x));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V cosf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  V ax = B::abs(x);
+  valid = B::le(ax, B::set(TRIGF_MAX));
+  V r, q;
+  trigf_reduce<B>(ax, r, q);
+  V v = B::select(B::mor(B::eq(q, B::set(2.0f)), B::eq(q, B::set(6.0f))), ksinf<B>(r), kcosf<B>(r));
+  return B::select(B::mor(B::eq(q, B::set(2.0f)), B::eq(q, B::set(4.0f))), B::bxor(v, B::set(-0.0f)), v);
+}
+
+const float PIF = 3.14159265358979323846f;
+const float PIO2F = 1.5707963267948966192f;
+const float PIO4F = 0.7853981633974483096f;
+
+template<class B>
+MT_FORCEINLINE typename B::V atanf_core(typename B::V ax)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  static const float P[] = { -3.33329491539E-1f, 1.99777106478E-1f, -1.38776856032E-1f, 8.05374449538e-2f };
+  const V one = B::set(1.0f);
+  M mid = B::gt(ax, B::set(0.4142135623730950f));
+  M big = B::gt(ax, B::set(2.414213562373095f));
+  V num = B::select(big, B::set(-1.0f), B::select(mid, B::sub(ax, one), ax));
+  V den = B::select(big, ax, B::select(mid, B::add(ax, one), one));
+  V base = B::select(big, B::set(PIO2F), B::select(mid, B::set(PIO4F), B::set(0.0f)));
+  V x = B::div(num, den);
+  V z = B::mul(x, x);
+  return B::add(base, B::add(B::mul(B::mul(horner<B>(z, P), z), x), x));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V atanf_kernel(typename B::V x, typename B::M &valid)
+{
+  valid = B::eq(x, x);
+  return B::bxor(atanf_core<B>(B::abs(x)), B::signbits(x));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V atan2f_kernel(typename B::V y, typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  const V inf = B::set(HUGE_VALF);
+  valid = B::mand(B::lt(B::abs(x), inf), B::lt(B::abs(y), inf));
+  valid = B::mandnot(valid, B::eq(x, B::set(0.0f)));
+  V z = atanf_core<B>(B::abs(B::div(y, x)));
+  V r = B::select(B::lt(x, B::set(0.0f)), B::sub(B::set(PIF), z), z);
+  return B::bxor(r, B::signbits(y));
+}
+
+// asin on [0, 0.5]
+template<class B>
+MT_FORCEINLINE typename B::V asinf_small(typename B::V s, typename B::V z)
+{
+  static const float P[] = { 1.6666752422E-1f, 7.4953002686E-2f, 4.5470025998E-2f, 2.4181311049E-2f, 4.2163199048E-2f };
+  return B::add(B::mul(B::mul(horner<B>(z, P), z), s), s);
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V asinf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  V ax = B::abs(x);
+  valid = B::le(ax, B::set(1.0f));
+  M big = B::gt(ax, B::set(0.5f));
+  V z = B::select(big, B::mul(B::set(0.5f), B::sub(B::set(1.0f), ax)), B::mul(ax, ax));
+  V s = B::select(big, B::sqrt(z), ax);
+  V r = asinf_small<B>(s, z);
+  r = B::select(big, B::sub(B::set(PIO2F), B::add(r, r)), r);
+  return B::bxor(r, B::signbits(x));
+}
+
+template<class B>
+MT_FORCEINLINE typename B::V acosf_kernel(typename B::V x, typename B::M &valid)
+{
+  typedef typename B::V V;
+  typedef typename B::M M;
+  const V half = B::set(0.5f);
+  const V one = B::set(1.0f);
+  valid = B::le(B::abs(x), one);
+  M neg = B::lt(x, B::set(-0.5f));
+  M pos = B::gt(x, half);
+  V s = B::select(neg, B::sqrt(B::mul(half, B::add(one, x))), B::select(pos, B::sqrt(B::mul(half, B::sub(one, x))), x));
+  V a = asinf_small<B>(s, B::mul(s, s));
+  V a2 = B::add(a, a);
+  return B::select(neg, B::sub(B::set(PIF), a2), B::select(pos, a2, B::sub(B::set(PIO2F), a)));
+}
+
+inline float expf_fallback(float x) { return (float)std::exp((double)x); }
+inline float logf_fallback(float x) { return (float)std::log((double)x); }
+inline float sinf_fallback(float x) { return (float)std::sin((double)x); }
+inline float cosf_fallback(float x) { return (float)std::cos((double)x); }
+inline float asinf_fallback(float x) { return (float)std::asin((double)x); }
+inline float acosf_fallback(float x) { return (float)std::acos((double)x); }
+inline float atanf_fallback(float x) { return (float)std::atan((double)x); }
+inline float atan2f_fallback(float y, float x) { return (float)std::atan2((double)y, (double)x); }
+
+// ------------------------------------------------------------------------------------------------------
+// drivers
+
+// scalar backend: the reference value
+template<class S, typename S::V (*kernel)(typename S::V, typename S::M &), typename S::T (*fallback)(typename S::T)>
+MT_FORCEINLINE typename S::T scalar1(typename S::T x)
+{
+  typename S::M valid;
+  typename S::T r = kernel(x, valid);
+  return valid ? r : fallback(x);
+}
+
+template<class S, typename S::V (*kernel)(typename S::V, typename S::V, typename S::M &), typename S::T (*fallback)(typename S::T, typename S::T)>
+MT_FORCEINLINE typename S::T scalar2(typename S::T x, typename S::T y)
+{
+  typename S::M valid;
+  typename S::T r = kernel(x, y, valid);
+  return valid ? r : fallback(x, y);
+}
+
+// SIMD backend: lanes outside of the kernel range are replaced by the fallback
+template<class B, typename B::V (*kernel)(typename B::V, typename B::M &), typename B::T (*fallback)(typename B::T)>
+MT_FORCEINLINE void block1(typename B::T *d, const typename B::T *a, int count)
+{
+  for (int i = 0; i < count; i += B::N) {
+    typename B::M valid;
+    typename B::V r = kernel(B::load(a + i), valid);
+    const int bits = B::mask_bits(valid);
+    if (bits != B::FULL) {
+      alignas(32) typename B::T lanes[B::N];
+      B::store(lanes, r);
+      for (int j = 0; j < B::N; j++)
+        if (!((bits >> j) & 1))
+          lanes[j] = fallback(a[i + j]);
+      r = B::load(lanes);
+    }
+    B::store(d + i, r);
+  }
+}
+
+template<class B, typename B::V (*kernel)(typename B::V, typename B::V, typename B::M &), typename B::T (*fallback)(typename B::T, typename B::T)>
+MT_FORCEINLINE void block2(typename B::T *d, const typename B::T *a, const typename B::T *b, int count)
+{
+  for (int i = 0; i < count; i += B::N) {
+    typename B::M valid;
+    typename B::V r = kernel(B::load(a + i), B::load(b + i), valid);
+    const int bits = B::mask_bits(valid);
+    if (bits != B::FULL) {
+      alignas(32) typename B::T lanes[B::N];
+      B::store(lanes, r);
+      for (int j = 0; j < B::N; j++)
+        if (!((bits >> j) & 1))
+          lanes[j] = fallback(a[i + j], b[i + j]);
+      r = B::load(lanes);
+    }
+    B::store(d + i, r);
+  }
+}
+
+// double tan and pow of a SIMD backend, for the float versions
+template<class B>
+void run_double(int function, double *d, const double *a, const double *b, int count)
+{
+  using namespace Filtering::Parser;
+  switch (function) {
+  case VMath::TAN: block1<B, tan_kernel<B>, tan_fallback>(d, a, count); break;
+  case VMath::POW:
+  {
+    // the same exponent everywhere (constant in the expression): integral ones are multiplied out
+    const double y = b[0];
+    bool uniform = y == std::floor(y) && std::fabs(y) <= 2.0;
+    for (int i = 1; i < count && uniform; i++)
+      uniform = b[i] == y;
+    if (uniform) {
+      const int n = (int)std::fabs(y);
+      for (int i = 0; i < count; i += B::N)
+        B::store(d + i, powi<B>(B::load(a + i), n, y < 0));
+      break;
+    }
+    for (int i = 0; i < count; i += B::N) {
+      typename B::M valid;
+      typename B::V r = pow_kernel<B>(B::load(a + i), B::load(b + i), valid);
+      const int bits = B::mask_bits(valid);
+      if (bits != B::FULL) {
+        alignas(32) double lanes[B::N];
+        B::store(lanes, r);
+        for (int j = 0; j < B::N; j++)
+          if (!((bits >> j) & 1))
+            lanes[j] = VMath::pow(a[i + j], b[i + j]);
+        r = B::load(lanes);
+      }
+      B::store(d + i, r);
+    }
+    break;
+  }
+  }
+}
+
+template<class B, class D>
+void run_float(int function, float *d, const float *a, const float *b, int count)
+{
+  using namespace Filtering::Parser;
+  switch (function) {
+  case VMath::EXP: block1<B, expf_kernel<B>, expf_fallback>(d, a, count); break;
+  case VMath::LOG: block1<B, logf_kernel<B>, logf_fallback>(d, a, count); break;
+  case VMath::SIN: block1<B, sinf_kernel<B>, sinf_fallback>(d, a, count); break;
+  case VMath::COS: block1<B, cosf_kernel<B>, cosf_fallback>(d, a, count); break;
+  case VMath::ASIN: block1<B, asinf_kernel<B>, asinf_fallback>(d, a, count); break;
+  case VMath::ACOS: block1<B, acosf_kernel<B>, acosf_fallback>(d, a, count); break;
+  case VMath::ATAN: block1<B, atanf_kernel<B>, atanf_fallback>(d, a, count); break;
+  case VMath::ATAN2: block2<B, atan2f_kernel<B>, atan2f_fallback>(d, a, b, count); break;
+  case VMath::TAN:
+  case VMath::POW:
+  {
+    // by the double kernels, BLOCK_SIZE values at a time (tan: sin/cos in float would lose up to 6 ulp)
+    alignas(32) double x[32], y[32], r[32];
+    for (int i = 0; i < count; i += 32) {
+      const int n = count - i < 32 ? count - i : 32;
+      for (int j = 0; j < n; j++) {
+        x[j] = a[i + j];
+        y[j] = b[i + j];
+      }
+      run_double<D>(function, r, x, y, n);
+      for (int j = 0; j < n; j++)
+        d[i + j] = (float)r[j];
+    }
+    break;
+  }
+  }
+}
+
+} // namespace VMathImpl
+
+} // namespace
+
+#endif
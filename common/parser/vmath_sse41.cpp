@@ -0,0 +1,103 @@
+#include "vmath_impl.h"
+#include <smmintrin.h>
+
+using namespace Filtering;
+using namespace Filtering::Parser;
+
+// SSE4.1 backends of the kernels: 2 doubles or 4 floats per value
+
+namespace {
+
+struct D2 {
+  typedef double T;
+  typedef __m128d V;
+  typedef __m128d M;
+  static const int N = 2;
+  static const int FULL = 3;
+
+  static MT_FORCEINLINE V load(const double *p) { return _mm_load_pd(p); }
+  static MT_FORCEINLINE void store(double *p, V x) { _mm_store_pd(p, x); }
+  static MT_FORCEINLINE V set(double x) { return _mm_set1_pd(x); }
+  static MT_FORCEINLINE V add(V a, V b) { return _mm_add_pd(a, b); }
+  static MT_FORCEINLINE V sub(V a, V b) { return _mm_sub_pd(a, b); }
+  static MT_FORCEINLINE V mul(V a, V b) { return _mm_mul_pd(a, b); }
+  static MT_FORCEINLINE V div(V a, V b) { return _mm_div_pd(a, b); }
+  static MT_FORCEINLINE V sqrt(V a) { return _mm_sqrt_pd(a); }
+  static MT_FORCEINLINE V round(V a) { return _mm_round_pd(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V floor(V a) { return _mm_round_pd(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V abs(V a) { return _mm_andnot_pd(_mm_set1_pd(-0.0), a); }
+  static MT_FORCEINLINE V signbits(V a) { return _mm_and_pd(_mm_set1_pd(-0.0), a); }
+  static MT_FORCEINLINE V bxor(V a, V b) { return _mm_xor_pd(a, b); }
+  static MT_FORCEINLINE M lt(V a, V b) { return _mm_cmplt_pd(a, b); }
+  static MT_FORCEINLINE M le(V a, V b) { return _mm_cmple_pd(a, b); }
+  static MT_FORCEINLINE M gt(V a, V b) { return _mm_cmpgt_pd(a, b); }
+  static MT_FORCEINLINE M ge(V a, V b) { return _mm_cmpge_pd(a, b); }
+  static MT_FORCEINLINE M eq(V a, V b) { return _mm_cmpeq_pd(a, b); }
+  static MT_FORCEINLINE M mand(M a, M b) { return _mm_and_pd(a, b); }
+  static MT_FORCEINLINE M mor(M a, M b) { return _mm_or_pd(a, b); }
+  static MT_FORCEINLINE M mandnot(M a, M b) { return _mm_andnot_pd(b, a); }
+  static MT_FORCEINLINE V select(M m, V a, V b) { return _mm_blendv_pd(b, a, m); }
+  static MT_FORCEINLINE int mask_bits(M m) { return _mm_movemask_pd(m); }
+  static MT_FORCEINLINE V clear_low32(V a) { return _mm_and_pd(a, _mm_castsi128_pd(_mm_set1_epi64x((long long)0xFFFFFFFF00000000ull))); }
+  static MT_FORCEINLINE V pow2i(V k) { return _mm_castsi128_pd(_mm_slli_epi64(_mm_castpd_si128(_mm_add_pd(k, _mm_set1_pd(6755399441056767.0))), 52)); }
+  static MT_FORCEINLINE V exponent(V a)
+  {
+    __m128i e = _mm_or_si128(_mm_srli_epi64(_mm_castpd_si128(a), 52), _mm_set1_epi64x(0x4330000000000000ll));
+    return _mm_sub_pd(_mm_castsi128_pd(e), _mm_set1_pd(4503599627370496.0));
+  }
+  static MT_FORCEINLINE V mantissa(V a)
+  {
+    __m128i m = _mm_and_si128(_mm_castpd_si128(a), _mm_set1_epi64x(0x000FFFFFFFFFFFFFll));
+    return _mm_castsi128_pd(_mm_or_si128(m, _mm_set1_epi64x(0x3FF0000000000000ll)));
+  }
+};
+
+struct F4 {
+  typedef float T;
+  typedef __m128 V;
+  typedef __m128 M;
+  static const int N = 4;
+  static const int FULL = 15;
+
+  static MT_FORCEINLINE V load(const float *p) { return _mm_load_ps(p); }
+  static MT_FORCEINLINE void store(float *p, V x) { _mm_store_ps(p, x); }
+  static MT_FORCEINLINE V set(float x) { return _mm_set1_ps(x); }
+  static MT_FORCEINLINE V add(V a, V b) { return _mm_add_ps(a, b); }
+  static MT_FORCEINLINE V sub(V a, V b) { return _mm_sub_ps(a, b); }
+  static MT_FORCEINLINE V mul(V a, V b) { return _mm_mul_ps(a, b); }
+  static MT_FORCEINLINE V div(V a, V b) { return _mm_div_ps(a, b); }
+  static MT_FORCEINLINE V sqrt(V a) { return _mm_sqrt_ps(a); }
+  static MT_FORCEINLINE V round(V a) { return _mm_round_ps(a, _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V floor(V a) { return _mm_round_ps(a, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+  static MT_FORCEINLINE V abs(V a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+  static MT_FORCEINLINE V signbits(V a) { return _mm_and_ps(_mm_set1_ps(-0.0f), a); }
+  static MT_FORCEINLINE V bxor(V a, V b) { return _mm_xor_ps(a, b); }
+  static MT_FORCEINLINE M lt(V a, V b) { return _mm_cmplt_ps(a, b); }
+  static MT_FORCEINLINE M le(V a, V b) { return _mm_cmple_ps(a, b); }
+  static MT_FORCEINLINE M gt(V a, V b) { return _mm_cmpgt_ps(a, b); }
+  static MT_FORCEINLINE M ge(V a, V b) { return _mm_cmpge_ps(a, b); }
+  static MT_FORCEINLINE M eq(V a, V b) { return _mm_cmpeq_ps(a, b); }
+  static MT_FORCEINLINE M mand(M a, M b) { return _mm_and_ps(a, b); }
+  static MT_FORCEINLINE M mor(M a, M b) { return _mm_or_ps(a, b); }
+  static MT_FORCEINLINE M mandnot(M a, M b) { return _mm_andnot_ps(b, a); }
+  static MT_FORCEINLINE V select(M m, V a, V b) { return _mm_blendv_ps(b, a, m); }
+  static MT_FORCEINLINE int mask_bits(M m) { return _mm_movemask_ps(m); }
+  static MT_FORCEINLINE V pow2i(V k) { return _mm_castsi128_ps(_mm_slli_epi32(_mm_castps_si128(_mm_add_ps(k, _mm_set1_ps(12583039.0f))), 23)); }
+  static MT_FORCEINLINE V exponent(V a)
+  {
+    __m128i e = _mm_and_si128(_mm_srli_epi32(_mm_castps_si128(a), 23), _mm_set1_epi32(0xFF));
+    return _mm_sub_ps(_mm_castsi128_ps(_mm_or_si128(e, _mm_set1_epi32(0x4B000000))), _mm_set1_ps(8388608.0f));
+  }
+  static MT_FORCEINLINE V mantissa(V a)
+  {
+    __m128i m = _mm_and_si128(_mm_castps_si128(a), _mm_set1_epi32(0x007FFFFF));
+    return _mm_castsi128_ps(_mm_or_si128(m, _mm_set1_epi32(0x3F800000)));
+  }
+};
+
+} // namespace
+
+void VMath::run_float_sse41(int function, float *d, const float *a, const float *b, int count)
+{
+  VMathImpl::run_float<F4, D2>(function, d, a, b, count);
+}
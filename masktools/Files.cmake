@@ -44,6 +44,7 @@ FILE(GLOB masktools_Sources RELATIVE "${CMAKE_CURRENT_SOURCE_DIR}"
   "filters/lut/lutxyz/*.h"
   "filters/lut/lutxyza/*.cpp"
   "filters/lut/lutxyza/*.h"
+  "filters/lut/*.cpp"
   "filters/lut/*.h"
   "filters/mask/edge/*.cpp"
   "filters/mask/egde/*.h"
@@ -29,6 +29,9 @@ protected:
     Operator operators[4];
 
     bool inPlace_;
+    // v2.2.31: in-place filters: process() also gets the unmodified frame of the first clip, in frames[clip count]
+    // (the output planes processed earlier are already overwritten), set by the lut filters with x.Y operands
+    bool keep_source_frame;
     int nXOffset, nYOffset, nXOffsetUV, nYOffsetUV;
     int nCoreWidth, nCoreHeight, nCoreWidthUV, nCoreHeightUV;
 
@@ -208,10 +211,12 @@ public:
         parameters(parameters),
         flags(_flags),
         inPlace_(processingType == FilterProcessingType::INPLACE),
+        keep_source_frame(false),
         nXOffset(parameters["offx"].toInt()),
         nYOffset(parameters["offy"].toInt()),
         nCoreWidth(parameters["w"].toInt()),
-        nCoreHeight((parameters["stacked"].is_defined() && parameters["stacked"].toBool() && parameters["h"].toInt()>=0) ? (2 * parameters["h"].toInt()) : parameters["h"].toInt())
+        nCoreHeight((parameters["stacked"].is_defined() && parameters["stacked"].toBool() && parameters["h"].toInt()>=0) ? (2 * parameters["h"].toInt()) : parameters["h"].toInt()),
+        has_avs_expr_support(parameters["avs_expr_support"].is_defined() && parameters["avs_expr_support"].toBool())
     {
         for (auto &param: parameters) {
             if (param.getType() == TYPE_CLIP) {
@@ -534,7 +539,7 @@ public:
 
       int clipcount = int(input_configuration().size());
 
-      std::vector<PVideoFrame> tmp_videoframes(clipcount);
+      std::vector<PVideoFrame> tmp_videoframes(clipcount + 1);
 
       for (int i = 0; i < clipcount; i++) {
         int childindex = input_configuration()[i].index();
@@ -546,6 +551,10 @@ public:
           env->copyFrameProps(tmp_videoframes[0], dst);
       }
 
+      // fetched after the output frame was made writable: the cached source or a new copy, never the output
+      if (keep_source_frame && inPlace_ && clipcount < 4)
+        frames[clipcount] = childs[0]->get_const_frame(n, tmp_videoframes[clipcount], env).offset(nXOffset, nYOffset, nCoreWidth, nCoreHeight);
+
       for (int i = 0; i < plane_counts[C]; i++) {
         constraints[i] = Constraint(flags, output.plane(i));
       }
@@ -69,18 +69,17 @@ public:
         memset(matrix_f, 0, sizeof(matrix_f));
         for (int i = 0; i < 9; i++)
         {
-          if (!coeffs.size())
+          if ((int)coeffs.size() <= i)
           {
             error = "invalid kernel";
             return;
           }
 
-          matrix_f[9] += abs(matrix_f[i] = Float(coeffs.front().getValue(0, 0, 0)));
-          coeffs.pop_front();
+          matrix_f[9] += abs(matrix_f[i] = Float(coeffs[i].getValue(0, 0, 0)));
         }
 
-        if (coeffs.size())
-          matrix_f[9] = Float(coeffs.front().getValue(0, 0, 0));
+        if (coeffs.size() > 9)
+          matrix_f[9] = Float(coeffs[9].getValue(0, 0, 0));
 
         if (!matrix_f[9])
           matrix_f[9] = 1.0f;
@@ -89,18 +88,17 @@ public:
         memset(matrix, 0, sizeof(matrix));
         for (int i = 0; i < 9; i++)
         {
-          if (!coeffs.size())
+          if ((int)coeffs.size() <= i)
           {
             error = "invalid kernel";
             return;
           }
 
-          matrix[9] += abs(matrix[i] = Short(coeffs.front().getValue(0, 0, 0)));
-          coeffs.pop_front();
+          matrix[9] += abs(matrix[i] = Short(coeffs[i].getValue(0, 0, 0)));
         }
 
-        if (coeffs.size())
-          matrix[9] = Short(coeffs.front().getValue(0, 0, 0));
+        if (coeffs.size() > 9)
+          matrix[9] = Short(coeffs[9].getValue(0, 0, 0));
 
         if (!matrix[9])
           matrix[9] = 1;
@@ -122,20 +122,16 @@ public:
       for ( int i = 0; i < nHorizontal; i++ )
       {
          if ( isFloat )
-            f_horizontal[i] = float(hcoeffs.front().getValue(0,0,0));
+            f_horizontal[i] = float(hcoeffs[i].getValue(0,0,0));
          else
-            i_horizontal[i] = convert<int, Double>(hcoeffs.front().getValue(0,0,0));
-
-         hcoeffs.pop_front();
+            i_horizontal[i] = convert<int, Double>(hcoeffs[i].getValue(0,0,0));
       }
       for ( int i = 0; i < nVertical; i++ )
       {
          if ( isFloat )
-            f_vertical[i] = float(vcoeffs.front().getValue(0,0,0));
+            f_vertical[i] = float(vcoeffs[i].getValue(0,0,0));
          else
-            i_vertical[i] = convert<int, Double>(vcoeffs.front().getValue(0,0,0));
-
-         vcoeffs.pop_front();
+            i_vertical[i] = convert<int, Double>(vcoeffs[i].getValue(0,0,0));
       }
 
       for (int i = 0; i < 4; i++)
@@ -0,0 +1,174 @@
+#include "approx.h"
+#include "parallel.h"
+#include <cmath>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Approx {
+
+String layout(int nInputs, bool chroma, double tolerance)
+{
+  return String(nInputs == 1 ? "approx x" : "approx xy") + (chroma ? " chroma " : " ") + std::to_string(tolerance);
+}
+
+void interpolate_row_c(float *dst, const float *xs, const float *ys, int width, const Table &table, std::vector<int> &outside)
+{
+  const float *t = table.values.data();
+  const int size = table.size;
+  const ptrdiff_t stride = size + 1;
+  for (int i = 0; i < width; i++) {
+    const float tx = (xs[i] - table.lo) * table.scale;
+    // false for NaN, too
+    if (!(tx >= 0.0f && tx <= (float)size)) {
+      outside.push_back(i);
+      continue;
+    }
+    const int ix = min((int)tx, size - 1);
+    const float fx = tx - ix;
+    if (table.nInputs == 1) {
+      dst[i] = t[ix] + fx * (t[ix + 1] - t[ix]);
+      continue;
+    }
+    const float ty = (ys[i] - table.lo) * table.scale;
+    if (!(ty >= 0.0f && ty <= (float)size)) {
+      outside.push_back(i);
+      continue;
+    }
+    const int iy = min((int)ty, size - 1);
+    const float fy = ty - iy;
+    const float *row0 = t + ix * stride + iy;
+    const float *row1 = row0 + stride;
+    const float top = row0[0] + fy * (row0[1] - row0[0]);
+    const float bottom = row1[0] + fy * (row1[1] - row1[0]);
+    dst[i] = top + fx * (bottom - top);
+  }
+}
+
+// interpolated vs evaluated at the points of a row, largest difference, infinity when not finite
+static double row_error(const std::vector<float> &exact, const std::vector<float> &xs, const std::vector<float> &ys, const Table &table)
+{
+  const int width = (int)exact.size();
+  std::vector<float> interpolated(width);
+  std::vector<int> outside;
+  interpolate_row_c(interpolated.data(), xs.data(), ys.data(), width, table, outside);
+  double max_error = outside.empty() ? 0.0 : INFINITY;
+  for (int i = 0; i < width; i++) {
+    const double error = std::abs((double)exact[i] - (double)interpolated[i]);
+    if (!(error <= max_error)) // NaN too
+      max_error = std::isnan(error) ? INFINITY : error;
+  }
+  return max_error;
+}
+
+Table *calculateLut(const std::vector<Parser::Symbol> &expr, int nInputs, bool chroma, double tolerance, String scale_inputs, int clamp_float, int cpu_flags)
+{
+  Table *table = new Table;
+  table->nInputs = nInputs;
+  table->size = nInputs == 1 ? SIZE_1D : SIZE_2D;
+  table->lo = chroma ? -0.5f : 0.0f;
+  table->hi = chroma ? 0.5f : 1.0f;
+  table->scale = (float)table->size / (table->hi - table->lo);
+  const int samples = table->size + 1;
+  table->values.resize(nInputs == 1 ? samples : (size_t)samples * samples);
+
+  // grid point k of an input, at half steps for the checks
+  auto grid = [&](double k) { return (float)(table->lo + (table->hi - table->lo) * k / table->size); };
+
+  if (nInputs == 1) {
+    Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, 1, samples, [&](Parser::Context &ctx, size_t) {
+      std::vector<float> xs(samples);
+      for (int k = 0; k < samples; k++)
+        xs[k] = grid(k);
+      const Float *srcs[] = { xs.data() };
+      ctx.compute_row_float(table->values.data(), srcs, 1, samples, chroma);
+    });
+
+    double max_error = 0.0;
+    Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, 1, samples, [&](Parser::Context &ctx, size_t) {
+      std::vector<float> xs(table->size), exact(table->size);
+      for (int k = 0; k < table->size; k++)
+        xs[k] = grid(k + 0.5);
+      const Float *srcs[] = { xs.data() };
+      ctx.compute_row_float(exact.data(), srcs, 1, table->size, chroma);
+      max_error = row_error(exact, xs, xs, *table);
+    });
+    // grid points have to be finite, too
+    for (float v : table->values)
+      if (!std::isfinite(v))
+        max_error = INFINITY;
+    if (!(max_error <= tolerance)) {
+      delete table;
+      return nullptr;
+    }
+    return table;
+  }
+
+  Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, samples, samples, [&](Parser::Context &ctx, size_t ix) {
+    std::vector<float> xs(samples, grid((double)ix)), ys(samples);
+    for (int k = 0; k < samples; k++)
+      ys[k] = grid(k);
+    const Float *srcs[] = { xs.data(), ys.data() };
+    ctx.compute_row_float(table->values.data() + ix * samples, srcs, 2, samples, chroma);
+  });
+
+  // checked rows: 2 * ix is a row of grid points (middle of the y intervals),
+  // 2 * ix + 1 a row between grid points (middle of the x intervals and the cell centers)
+  std::vector<double> errors(2 * table->size + 1);
+  Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, errors.size(), samples, [&](Parser::Context &ctx, size_t row) {
+    const bool between = (row & 1) != 0;
+    const int width = between ? 2 * table->size + 1 : table->size;
+    std::vector<float> xs(width, grid(row * 0.5)), ys(width), exact(width);
+    for (int k = 0; k < width; k++)
+      ys[k] = between ? grid(k * 0.5) : grid(k + 0.5);
+    const Float *srcs[] = { xs.data(), ys.data() };
+    ctx.compute_row_float(exact.data(), srcs, 2, width, chroma);
+    errors[row] = row_error(exact, xs, ys, *table);
+  });
+  double max_error = 0.0;
+  for (double e : errors)
+    max_error = std::isnan(e) ? INFINITY : std::max(max_error, e);
+  for (float v : table->values)
+    if (!std::isfinite(v))
+      max_error = INFINITY;
+  if (!(max_error <= tolerance)) {
+    delete table;
+    return nullptr;
+  }
+  return table;
+}
+
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc2, ptrdiff_t nSrc2Pitch, int nWidth, int nHeight, const Table &table, bool chroma, Parser::Context &ctx, int cpu_flags)
+{
+  std::vector<int> outside;
+  std::vector<float> outside_x, outside_y, results;
+  for (int y = 0; y < nHeight; y++) {
+    float *dst = reinterpret_cast<float *>(pDst);
+    const float *src2 = reinterpret_cast<const float *>(pSrc2);
+    outside.clear();
+    // dst is x: unchanged for the outside inputs
+    if (cpu_flags & CPU_AVX2)
+      interpolate_row_avx2(dst, dst, src2, nWidth, table, outside);
+    else
+      interpolate_row_c(dst, dst, src2, nWidth, table, outside);
+
+    if (!outside.empty()) {
+      const int count = (int)outside.size();
+      outside_x.resize(count);
+      outside_y.resize(count);
+      results.resize(count);
+      for (int k = 0; k < count; k++) {
+        outside_x[k] = dst[outside[k]];
+        if (table.nInputs == 2)
+          outside_y[k] = src2[outside[k]];
+      }
+      const Float *srcs[] = { outside_x.data(), outside_y.data() };
+      ctx.compute_row_float(results.data(), srcs, table.nInputs, count, chroma);
+      for (int k = 0; k < count; k++)
+        dst[outside[k]] = results[k];
+    }
+    pDst += nDstPitch;
+    pSrc2 += nSrc2Pitch;
+  }
+}
+
+} } } } }
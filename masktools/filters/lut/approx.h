@@ -0,0 +1,47 @@
+#ifndef __Mt_Lut_Approx_H__
+#define __Mt_Lut_Approx_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <vector>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Approx {
+
+// Interpolated tables for 32 bit float mt_lut and mt_lutxy, v2.2.31
+// Float clips have no lut, every pixel is evaluated. With float_tolerance > 0 a smooth expression (curves, gamma,
+// blends) is sampled on a regular grid over the nominal input range (luma and RGB 0..1, chroma -0.5..0.5) and
+// applied with linear (mt_lut) or bilinear (mt_lutxy) interpolation.
+// The table is only used when the interpolation error measured between all grid points (at the middle of each
+// interval, each cell and each cell edge) is at most float_tolerance, otherwise the filter stays realtime.
+// Inputs outside the nominal range (and NaN) are evaluated exactly.
+
+// grid intervals per input
+const int SIZE_1D = 16384;
+const int SIZE_2D = 512;
+
+struct Table {
+  int nInputs; // 1: x, 2: x and y
+  int size; // intervals per input, size + 1 samples
+  float lo; // nominal range of the inputs
+  float hi;
+  float scale; // size / (hi - lo)
+  std::vector<float> values; // 2D: values[ix * (size + 1) + iy]
+};
+
+// nullptr when the interpolation error is over tolerance or the expression is not finite on the grid
+Table *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int nInputs, bool chroma, double tolerance, String scale_inputs, int clamp_float, int cpu_flags);
+
+// Lut::Cache layout name of the table
+String layout(int nInputs, bool chroma, double tolerance);
+
+// pSrc2: y plane for 2D tables. pDst is the x plane, too.
+// ctx: the compiled expression, evaluates the inputs outside of the table
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc2, ptrdiff_t nSrc2Pitch, int nWidth, int nHeight, const Table &table, bool chroma, Parser::Context &ctx, int cpu_flags);
+
+// one row: dst[i] = interpolated value or unchanged for the inputs outside the table, their index is added to outside
+void interpolate_row_c(float *dst, const float *xs, const float *ys, int width, const Table &table, std::vector<int> &outside);
+void interpolate_row_avx2(float *dst, const float *xs, const float *ys, int width, const Table &table, std::vector<int> &outside);
+
+} } } } }
+
+#endif
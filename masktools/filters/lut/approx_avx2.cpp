@@ -0,0 +1,74 @@
+#include "approx.h"
+#include <immintrin.h>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Approx {
+
+// same interpolation as interpolate_row_c, 8 pixels at a time with gathered table values
+void interpolate_row_avx2(float *dst, const float *xs, const float *ys, int width, const Table &table, std::vector<int> &outside)
+{
+  const float *t = table.values.data();
+  const int size = table.size;
+  const __m256 lo = _mm256_set1_ps(table.lo);
+  const __m256 scale = _mm256_set1_ps(table.scale);
+  const __m256 zero = _mm256_setzero_ps();
+  const __m256 fsize = _mm256_set1_ps((float)size);
+  const __m256i last = _mm256_set1_epi32(size - 1);
+  const __m256i stride = _mm256_set1_epi32(size + 1);
+  const __m256i one = _mm256_set1_epi32(1);
+
+  const int mod8_width = width / 8 * 8;
+  for (int i = 0; i < mod8_width; i += 8) {
+    const __m256 tx = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(xs + i), lo), scale);
+    // ordered compares: NaN is outside
+    __m256 inside = _mm256_and_ps(_mm256_cmp_ps(tx, zero, _CMP_GE_OQ), _mm256_cmp_ps(tx, fsize, _CMP_LE_OQ));
+    // outside lanes read entry 0
+    const __m256i ix = _mm256_min_epi32(_mm256_cvttps_epi32(_mm256_and_ps(tx, inside)), last);
+    const __m256 fx = _mm256_sub_ps(_mm256_and_ps(tx, inside), _mm256_cvtepi32_ps(ix));
+
+    __m256 result;
+    if (table.nInputs == 1) {
+      const __m256 v0 = _mm256_i32gather_ps(t, ix, 4);
+      const __m256 v1 = _mm256_i32gather_ps(t, _mm256_add_epi32(ix, one), 4);
+      result = _mm256_add_ps(v0, _mm256_mul_ps(fx, _mm256_sub_ps(v1, v0)));
+    }
+    else {
+      const __m256 ty = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(ys + i), lo), scale);
+      inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(ty, zero, _CMP_GE_OQ), _mm256_cmp_ps(ty, fsize, _CMP_LE_OQ)));
+      const __m256 tyc = _mm256_and_ps(ty, inside);
+      const __m256i iy = _mm256_min_epi32(_mm256_cvttps_epi32(tyc), last);
+      const __m256 fy = _mm256_sub_ps(tyc, _mm256_cvtepi32_ps(iy));
+      const __m256i index0 = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_and_si256(ix, _mm256_castps_si256(inside)), stride), iy);
+      const __m256i index1 = _mm256_add_epi32(index0, stride);
+      const __m256 a = _mm256_i32gather_ps(t, index0, 4);
+      const __m256 b = _mm256_i32gather_ps(t, _mm256_add_epi32(index0, one), 4);
+      const __m256 c = _mm256_i32gather_ps(t, index1, 4);
+      const __m256 d = _mm256_i32gather_ps(t, _mm256_add_epi32(index1, one), 4);
+      const __m256 top = _mm256_add_ps(a, _mm256_mul_ps(fy, _mm256_sub_ps(b, a)));
+      const __m256 bottom = _mm256_add_ps(c, _mm256_mul_ps(fy, _mm256_sub_ps(d, c)));
+      const __m256 fxc = _mm256_and_ps(fx, inside);
+      result = _mm256_add_ps(top, _mm256_mul_ps(fxc, _mm256_sub_ps(bottom, top)));
+    }
+
+    const int inside_mask = _mm256_movemask_ps(inside);
+    if (inside_mask == 0xFF)
+      _mm256_storeu_ps(dst + i, result);
+    else {
+      // outside lanes keep their input
+      _mm256_maskstore_ps(dst + i, _mm256_castps_si256(inside), result);
+      for (int k = 0; k < 8; k++)
+        if (!(inside_mask & (1 << k)))
+          outside.push_back(i + k);
+    }
+  }
+
+  if (mod8_width < width) {
+    std::vector<int> rest;
+    interpolate_row_c(dst + mod8_width, xs + mod8_width, table.nInputs == 2 ? ys + mod8_width : ys, width - mod8_width, table, rest);
+    for (int k : rest)
+      outside.push_back(mod8_width + k);
+  }
+}
+
+} } } } }
@@ -0,0 +1,59 @@
+#include "async.h"
+#include "cache.h"
+#include <system_error>
+#include <vector>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Async {
+
+Table::Table(const Build &build) : table(nullptr), failed(false)
+{
+  // the worker may be the first to acquire a table, two of them would race on creating the cache
+  Cache::initialize();
+  try {
+    worker = std::thread([this, build]() {
+      // an exception escaping the thread would terminate the host
+      try {
+        table.store(build(), std::memory_order_release);
+      }
+      catch (...) {
+        error = std::current_exception();
+        failed.store(true, std::memory_order_release);
+        print(LOG_WARNING, "lut table build failed, staying realtime\n");
+      }
+    });
+  }
+  catch (const std::system_error &) {
+    table.store(build(), std::memory_order_release);
+  }
+}
+
+Table::~Table()
+{
+  if (worker.joinable())
+    worker.join();
+}
+
+void *Table::wait()
+{
+  if (worker.joinable())
+    worker.join();
+  return table.load(std::memory_order_acquire);
+}
+
+int compute_error(Parser::Context &ctx, int nInputs, int bits_per_pixel)
+{
+  const int values[4] = { 0, 0, 0, 0 };
+  if (bits_per_pixel == 8) {
+    std::vector<Byte> row(256);
+    ctx.compute_lut_row_byte(row.data(), values, nInputs, nInputs - 1);
+  }
+  else {
+    std::vector<Word> row((size_t)1 << bits_per_pixel);
+    ctx.compute_lut_row_word(row.data(), values, nInputs, nInputs - 1, bits_per_pixel);
+  }
+  return ctx.get_compute_error();
+}
+
+} } } } }
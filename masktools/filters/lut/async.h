@@ -0,0 +1,54 @@
+#ifndef __Mt_Lut_Async_H__
+#define __Mt_Lut_Async_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <thread>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Async {
+
+// Tables built in the background, parameter async=true of mt_lutxy, mt_lutxyz and mt_lutsx, v2.2.31
+// Large tables (8 bit mt_lutxyz and mt_lutsx: 16 MBytes, 12 bit mt_lutxy: 32 MBytes) take a while to build, the
+// constructor used to block until every table was ready. With async=true it only starts a worker thread per
+// table (the build itself is the usual Cache::acquire, still shared and still built on all cores). process()
+// evaluates the expression in realtime until the table is published, then switches to the table.
+// Results are the same either way, only the first frames are slower.
+// Expression errors are reported by the constructor as before, they are detected on one row of the table.
+// A build that throws (bad_alloc of a large table) on the worker thread leaves the table empty, the filter stays
+// realtime. The exception is kept for failure().
+
+typedef std::function<void *()> Build;
+
+class Table {
+  std::atomic<void *> table;
+  std::atomic<bool> failed;
+  std::exception_ptr error; // written by the worker before failed is set
+  std::thread worker;
+
+public:
+  // build: returns the finished table, runs on its own thread (in the calling one when no thread can be started)
+  Table(const Build &build);
+  // waits for a running build, the table is not released
+  ~Table();
+
+  Table(const Table &) = delete;
+  Table &operator=(const Table &) = delete;
+
+  // nullptr until the table is complete, and after a failed build
+  const void *get() const { return table.load(std::memory_order_acquire); }
+  // waits for the build, nullptr when it failed
+  void *wait();
+  // the exception of a failed build, nullptr while building and after a successful one
+  std::exception_ptr failure() const { return failed.load(std::memory_order_acquire) ? error : nullptr; }
+};
+
+// compute error of the table rows (stack errors do not depend on the values), evaluated on the first row.
+// Integer table of nInputs inputs over bits_per_pixel, ctx: the compiled expression
+int compute_error(Parser::Context &ctx, int nInputs, int bits_per_pixel);
+
+} } } } }
+
+#endif
@@ -0,0 +1,157 @@
+#include "cache.h"
+#include "diskcache.h"
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Cache {
+
+struct Entry {
+  std::mutex build_lock; // held while the table is built
+  bool built = false;
+  void *table = nullptr;
+  Destroy *destroy = nullptr;
+  DiskCache::Mapping *mapping = nullptr; // loaded from the disk cache instead
+  int compute_error = 0;
+  int refcount = 0; // guarded by cache_lock
+};
+
+// function statics: filters may be created while other static objects are initialized
+static std::mutex &cache_lock()
+{
+  static std::mutex lock;
+  return lock;
+}
+
+static std::map<String, std::shared_ptr<Entry>> &entries()
+{
+  static std::map<String, std::shared_ptr<Entry>> map;
+  return map;
+}
+
+static std::map<const void *, String> &keys()
+{
+  static std::map<const void *, String> map;
+  return map;
+}
+
+String key(const char *layout, const std::vector<Parser::Symbol> &expr, int bits_per_pixel, const String &scale_inputs, int clamp_float)
+{
+  String result = String(layout) + "|" + std::to_string(bits_per_pixel) + "|" + scale_inputs + "|" + std::to_string(clamp_float) + "|";
+  for (auto &s : expr) {
+    if (s.type == Parser::Symbol::NUMBER) {
+      // exact value, "2" and "2.0" are the same
+      Uint64 bits;
+      memcpy(&bits, &s.dValue, sizeof(bits));
+      result += "#" + std::to_string(bits);
+    }
+    else
+      result += s.value; // parsed symbols are copies of the registered ones, aliases included
+    result += " ";
+  }
+  return result;
+}
+
+static void unref(const String &key, const std::shared_ptr<Entry> &entry)
+{
+  std::lock_guard<std::mutex> lock(cache_lock());
+  if (--entry->refcount == 0) {
+    auto found = entries().find(key);
+    if (found != entries().end() && found->second == entry)
+      entries().erase(found);
+  }
+}
+
+static void free_table(Entry &entry)
+{
+  if (entry.mapping != nullptr)
+    DiskCache::unmap(entry.mapping);
+  else if (entry.table != nullptr)
+    entry.destroy(entry.table);
+  entry.table = nullptr;
+  entry.mapping = nullptr;
+}
+
+void *acquire(const String &key, size_t size, const Build &build, Destroy *destroy, int &compute_error)
+{
+  std::shared_ptr<Entry> entry;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock());
+    auto &slot = entries()[key];
+    if (!slot)
+      slot = std::make_shared<Entry>();
+    slot->refcount++;
+    entry = slot;
+  }
+  {
+    // other tables can be built meanwhile
+    std::lock_guard<std::mutex> lock(entry->build_lock);
+    if (!entry->built) {
+      try {
+        if (size > 0)
+          entry->table = DiskCache::load(key, size, entry->compute_error, entry->mapping);
+        if (entry->table == nullptr) {
+          entry->table = build(entry->compute_error);
+          entry->destroy = destroy;
+          if (entry->table != nullptr && size > 0)
+            DiskCache::store(key, entry->table, size, entry->compute_error);
+        }
+        if (entry->table != nullptr) {
+          std::lock_guard<std::mutex> lock2(cache_lock());
+          keys()[entry->table] = key;
+        }
+        entry->built = true;
+      }
+      catch (...) {
+        // bad_alloc of the build or the disk cache: the reference of this call is given back and the entry stays
+        // unbuilt, the next acquire of the key builds the table again
+        if (entry->table != nullptr) {
+          std::lock_guard<std::mutex> lock2(cache_lock());
+          keys().erase(entry->table);
+        }
+        free_table(*entry);
+        unref(key, entry);
+        throw;
+      }
+    }
+  }
+  compute_error = entry->compute_error;
+  void *table = entry->table;
+  if (table == nullptr)
+    unref(key, entry);
+  return table;
+}
+
+void initialize()
+{
+  std::lock_guard<std::mutex> lock(cache_lock());
+  entries();
+  keys();
+  DiskCache::get_directory();
+}
+
+void release(const void *table)
+{
+  if (table == nullptr)
+    return;
+  std::shared_ptr<Entry> unused;
+  {
+    std::lock_guard<std::mutex> lock(cache_lock());
+    auto found = keys().find(table);
+    if (found == keys().end())
+      return;
+    auto entry = entries().find(found->second);
+    if (--entry->second->refcount > 0)
+      return;
+    unused = entry->second;
+    entries().erase(entry);
+    keys().erase(found);
+  }
+  // not under the lock, large tables take a while
+  free_table(*unused);
+}
+
+} } } } }
@@ -0,0 +1,47 @@
+#ifndef __Mt_Lut_Cache_H__
+#define __Mt_Lut_Cache_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <functional>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Cache {
+
+// Tables shared by all filter instances of the process, v2.2.31
+// Scripts often repeat the same mt_lutxy call, and Avisynth+ MT creates further instances of each filter.
+// A table is built by the first instance that asks for it, the others get the same read-only table.
+// It is freed when the last instance using it is destroyed.
+// Tables are identified by their content:
+// - layout: the inputs indexing the table, most significant first, e.g. "xy" is lut[(x << bits) + y],
+//   "ya" a Reduced table over y and a, "zxy" the mt_lutsx order. Other content types get their own names
+//   ("separable", "float xy"), a layout only means the same table when it is built the same way.
+// - the parsed expression: functions by their canonical name (aliases are the same), numbers by value,
+//   "x 2.0 *" and "x 2 *" share a table
+// - bit depth, scale_inputs and clamp_float
+// Integer tables are computed with the luma constants (compute_lut_row), luma and chroma planes share them.
+
+typedef void (Destroy)(void *table);
+typedef std::function<void *(int &compute_error)> Build;
+
+String key(const char *layout, const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, const String &scale_inputs, int clamp_float);
+
+// Returns the table of key, calls build when it is not in the cache yet. Concurrent requests for the same key
+// wait for one build. compute_error: the one reported by build. A nullptr result is not cached.
+// Every non-null result must be released once. An exception of build is passed on, nothing is cached or kept then.
+// size: bytes of a flat table, it is loaded from and saved to the disk cache (DiskCache) when one is set.
+// 0: not saved (tables with pointers, like SeparableTables)
+void *acquire(const String &key, size_t size, const Build &build, Destroy *destroy, int &compute_error);
+void release(const void *table);
+// Creates the state of the cache and of DiskCache on the calling thread. Called before other threads may be the
+// first to acquire a table (Async::Table): builds with /Zc:threadSafeInit- do not guard function statics.
+void initialize();
+
+template<typename T>
+void destroy_array(void *table) { delete[] static_cast<T *>(table); }
+
+template<typename T>
+void destroy_object(void *table) { delete static_cast<T *>(table); }
+
+} } } } }
+
+#endif
@@ -0,0 +1,131 @@
+#include "crossplane.h"
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace CrossPlane {
+
+int last_plane(const std::vector<Parser::Neighbour> &neighbours)
+{
+  int plane = -1;
+  for (const Parser::Neighbour &nb : neighbours)
+    plane = max(plane, nb.plane);
+  return plane;
+}
+
+bool parse_siting(const String &cplace, Siting &siting)
+{
+  if (cplace == "mpeg1")
+    siting = SITING_MPEG1;
+  else if (cplace == "mpeg2")
+    siting = SITING_MPEG2;
+  else if (cplace == "topleft" || cplace == "top_left")
+    siting = SITING_TOPLEFT;
+  else
+    return false;
+  return true;
+}
+
+Sources::Sources(const Frame<const Byte> *frames, int nInputs, int plane_count, Siting siting) : siting(siting)
+{
+  for (int input = 0; input < 4; input++) {
+    const Frame<const Byte> *frame = input < nInputs ? &frames[input == 0 ? nInputs - 1 : input - 1] : nullptr;
+    for (int plane = 0; plane < 4; plane++) {
+      const bool exists = frame != nullptr && plane < plane_count;
+      data[input][plane] = exists ? frame->plane(plane).data() : nullptr;
+      pitch[input][plane] = exists ? frame->plane(plane).pitch() : 0;
+    }
+  }
+  for (int plane = 0; plane < 4; plane++) {
+    width[plane] = plane < plane_count ? frames[0].plane(plane).width() : 0;
+    height[plane] = plane < plane_count ? frames[0].plane(plane).height() : 0;
+  }
+}
+
+// pixel sums of the downsampling kernels to pixels, integer: rounded to nearest
+template<typename T> struct Pixel {
+  typedef int Sum;
+  static T scale(Sum sum, int shift) { return (T)((sum + (1 << shift >> 1)) >> shift); }
+  static T average(Sum sum, int count) { return (T)((sum + count / 2) / count); }
+};
+
+template<> struct Pixel<Float> {
+  typedef float Sum;
+  static Float scale(Sum sum, int shift) { return sum * (1.0f / (1 << shift)); }
+  static Float average(Sum sum, int count) { return sum / count; }
+};
+
+template<typename T>
+static void resample_row_t(T *dst, const Sources &sources, int input, int plane, int y, int width, int height)
+{
+  typedef typename Pixel<T>::Sum Sum;
+  const Byte *base = sources.data[input][plane];
+  const ptrdiff_t pitch = sources.pitch[input][plane];
+  const int src_width = sources.width[plane];
+  const int src_height = sources.height[plane];
+  auto row = [&](int y_src) { return reinterpret_cast<const T *>(base + min(max(y_src, 0), src_height - 1) * pitch); };
+
+  // same size or smaller: nearest pixel
+  if (src_width < width || src_height < height || (src_width == width && src_height == height)) {
+    const T *src = row((int)((int64_t)y * src_height / height));
+    for (int x = 0; x < width; x++)
+      dst[x] = src[(int64_t)x * src_width / width];
+    return;
+  }
+
+  const int fx = src_width / width;
+  const int fy = src_height / height;
+  const T *s0 = row(y * fy);
+  const T *s1 = row(y * fy + 1);
+  const T *st = row(y * fy - 1);
+  auto column = [&](const T *src, int x_src) { return (Sum)src[min(max(x_src, 0), src_width - 1)]; };
+
+  if (fx == 2 && fy == 2 && sources.siting == SITING_MPEG1) {
+    for (int x = 0; x < width; x++)
+      dst[x] = Pixel<T>::scale(column(s0, 2 * x) + column(s1, 2 * x) + column(s0, 2 * x + 1) + column(s1, 2 * x + 1), 2);
+  }
+  else if (fx == 2 && fy == 2 && sources.siting == SITING_MPEG2) {
+    for (int x = 0; x < width; x++) {
+      const Sum left = column(s0, 2 * x - 1) + column(s1, 2 * x - 1);
+      const Sum mid = column(s0, 2 * x) + column(s1, 2 * x);
+      const Sum right = column(s0, 2 * x + 1) + column(s1, 2 * x + 1);
+      dst[x] = Pixel<T>::scale(left + 2 * mid + right, 3);
+    }
+  }
+  else if (fx == 2 && fy == 2) {
+    // topleft, the row above the first one is the first one
+    for (int x = 0; x < width; x++) {
+      const Sum left = column(st, 2 * x - 1) + 2 * column(s0, 2 * x - 1) + column(s1, 2 * x - 1);
+      const Sum mid = column(st, 2 * x) + 2 * column(s0, 2 * x) + column(s1, 2 * x);
+      const Sum right = column(st, 2 * x + 1) + 2 * column(s0, 2 * x + 1) + column(s1, 2 * x + 1);
+      dst[x] = Pixel<T>::scale(left + 2 * mid + right, 4);
+    }
+  }
+  else if (fx == 2 && fy == 1 && sources.siting == SITING_MPEG2) {
+    for (int x = 0; x < width; x++)
+      dst[x] = Pixel<T>::scale(column(s0, 2 * x - 1) + 2 * column(s0, 2 * x) + column(s0, 2 * x + 1), 2);
+  }
+  else {
+    // 422 mpeg1 and topleft, 411, other ratios: average of the covered pixels
+    for (int x = 0; x < width; x++) {
+      Sum sum = 0;
+      for (int j = 0; j < fy; j++) {
+        const T *src = row(y * fy + j);
+        for (int i = 0; i < fx; i++)
+          sum += column(src, x * fx + i);
+      }
+      dst[x] = Pixel<T>::average(sum, fx * fy);
+    }
+  }
+}
+
+void resample_row(Byte *dst, const Sources &sources, int input, int plane, int y, int width, int height, int bits_per_pixel)
+{
+  if (bits_per_pixel == 8)
+    resample_row_t<Byte>(dst, sources, input, plane, y, width, height);
+  else if (bits_per_pixel <= 16)
+    resample_row_t<Word>(reinterpret_cast<Word *>(dst), sources, input, plane, y, width, height);
+  else
+    resample_row_t<Float>(reinterpret_cast<Float *>(dst), sources, input, plane, y, width, height);
+}
+
+} } } } }
@@ -0,0 +1,51 @@
+#ifndef __Mt_Lut_CrossPlane_H__
+#define __Mt_Lut_CrossPlane_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace CrossPlane {
+
+// Other plane operands in realtime mt_lut, mt_lutxy, mt_lutxyz and mt_lutxyza, v2.2.31
+// "x.Y", "y.U", "x.V", "x.A" read the pixel of the given plane of the input at the position of the current one.
+// A chroma mask computed from luma (uExpr="x.Y 128 > 255 0 ?") or a luma mask from chroma no longer needs
+// ExtractY/resizing/mt_merge(luma=true) chains over full frames.
+// Planes of the same size are read as they are. A larger plane (luma read from a subsampled chroma plane) is
+// downsampled with the weights of mt_merge luma=true, parameter cplace:
+//   420 mpeg1: 2x2 average, mpeg2: 1-2-1 horizontally over two rows, topleft: 1-2-1 both ways
+//   422 mpeg1: two pixel average, mpeg2: 1-2-1; 411: four pixel average
+// pixels outside of the plane are clamped to the nearest edge pixel.
+// A smaller plane (chroma read from luma) is upsampled by repeating its pixels.
+// The rows are resampled once per processed row, by Neighbours::process, like the relative pixel operands.
+
+enum Siting {
+  SITING_MPEG1,
+  SITING_MPEG2,
+  SITING_TOPLEFT
+};
+
+// highest plane read by the other plane operands of an expression, -1: none
+int last_plane(const std::vector<Parser::Neighbour> &neighbours);
+
+// cplace parameter: "mpeg1", "mpeg2", "topleft" or "top_left", false for anything else
+bool parse_siting(const String &cplace, Siting &siting);
+
+// planes of the inputs of one frame
+struct Sources {
+  const Byte *data[4][4]; // [input][plane]
+  ptrdiff_t pitch[4][4];
+  int width[4]; // of the planes, in pixels
+  int height[4];
+  Siting siting;
+
+  // frames as passed to Filter::process of an in-place lut filter with unmodified source frame
+  // (Filter::keep_source_frame): y, z, a are frames[0..nInputs-2], x is frames[nInputs-1]
+  Sources(const Frame<const Byte> *frames, int nInputs, int plane_count, Siting siting);
+};
+
+// row y of plane of input, resampled to a plane of width x height, dst: width pixels of type T (bits_per_pixel)
+void resample_row(Byte *dst, const Sources &sources, int input, int plane, int y, int width, int height, int bits_per_pixel);
+
+} } } } }
+
+#endif
@@ -0,0 +1,219 @@
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX // no min & max macros
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "diskcache.h"
+#include <cstdio>
+#include <mutex>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace DiskCache {
+
+static const char MAGIC[8] = { 'M', 'T', 'L', 'U', 'T', 'B', 'I', 'N' };
+static const size_t DATA_ALIGNMENT = 65536; // Windows mapping granularity, a multiple of the page size elsewhere
+
+struct Header {
+  char magic[8];
+  unsigned int format_version;
+  int compute_error;
+  Uint64 size;
+  Uint64 data_offset;
+  unsigned int key_length;
+  unsigned int reserved;
+};
+
+struct Mapping {
+  void *base;
+  size_t length;
+};
+
+static std::mutex &directory_lock()
+{
+  static std::mutex lock;
+  return lock;
+}
+
+static String &cache_directory()
+{
+  static String directory;
+  return directory;
+}
+
+void set_directory(const String &directory)
+{
+  std::lock_guard<std::mutex> lock(directory_lock());
+  cache_directory() = directory;
+}
+
+String get_directory()
+{
+  std::lock_guard<std::mutex> lock(directory_lock());
+  return cache_directory();
+}
+
+static String file_name(const String &directory, const String &key)
+{
+  // FNV-1a
+  Uint64 hash = 14695981039346656037ull;
+  for (unsigned char c : key) {
+    hash ^= c;
+    hash *= 1099511628211ull;
+  }
+  char name[32];
+  snprintf(name, sizeof(name), "%016llx.mtlut", (unsigned long long)hash);
+  const char last = directory.back();
+  return directory + (last == '/' || last == '\\' ? "" : "/") + name;
+}
+
+static size_t data_offset(const String &key)
+{
+  return (sizeof(Header) + key.size() + DATA_ALIGNMENT - 1) / DATA_ALIGNMENT * DATA_ALIGNMENT;
+}
+
+static bool valid_header(const Header &header, const String &key, size_t size)
+{
+  return memcmp(header.magic, MAGIC, sizeof(MAGIC)) == 0 && header.format_version == (unsigned int)FORMAT_VERSION
+    && header.size == size && header.key_length == key.size() && header.data_offset == data_offset(key);
+}
+
+#ifdef _WIN32
+
+static Mapping *map_file(const String &name, size_t length)
+{
+  HANDLE file = CreateFileA(name.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+  if (file == INVALID_HANDLE_VALUE)
+    return nullptr;
+  LARGE_INTEGER file_size;
+  void *base = nullptr;
+  if (GetFileSizeEx(file, &file_size) && (Uint64)file_size.QuadPart == (Uint64)length) {
+    HANDLE map = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (map != nullptr) {
+      base = MapViewOfFile(map, FILE_MAP_READ, 0, 0, length);
+      CloseHandle(map); // the view keeps the mapping alive
+    }
+  }
+  CloseHandle(file);
+  return base != nullptr ? new Mapping { base, length } : nullptr;
+}
+
+void unmap(Mapping *mapping)
+{
+  UnmapViewOfFile(mapping->base);
+  delete mapping;
+}
+
+static bool replace_file(const String &from, const String &to)
+{
+  return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+}
+
+static int process_id()
+{
+  return (int)GetCurrentProcessId();
+}
+
+#else
+
+static Mapping *map_file(const String &name, size_t length)
+{
+  int file = open(name.c_str(), O_RDONLY);
+  if (file < 0)
+    return nullptr;
+  struct stat st;
+  void *base = MAP_FAILED;
+  if (fstat(file, &st) == 0 && (Uint64)st.st_size == (Uint64)length)
+    base = mmap(nullptr, length, PROT_READ, MAP_SHARED, file, 0);
+  close(file); // the mapping stays valid
+  return base != MAP_FAILED ? new Mapping { base, length } : nullptr;
+}
+
+void unmap(Mapping *mapping)
+{
+  munmap(mapping->base, mapping->length);
+  delete mapping;
+}
+
+static bool replace_file(const String &from, const String &to)
+{
+  return rename(from.c_str(), to.c_str()) == 0;
+}
+
+static int process_id()
+{
+  return (int)getpid();
+}
+
+#endif
+
+void *load(const String &key, size_t size, int &compute_error, Mapping *&mapping)
+{
+  mapping = nullptr;
+  const String directory = get_directory();
+  if (directory.empty())
+    return nullptr;
+  const String name = file_name(directory, key);
+
+  // check the header before mapping the whole file
+  Header header;
+  FILE *f = fopen(name.c_str(), "rb");
+  if (f == nullptr)
+    return nullptr;
+  bool valid = fread(&header, sizeof(header), 1, f) == 1 && valid_header(header, key, size);
+  if (valid) {
+    String stored(key.size(), '\0');
+    valid = fread(&stored[0], 1, key.size(), f) == key.size() && stored == key;
+  }
+  fclose(f);
+  if (!valid)
+    return nullptr;
+
+  const Uint64 length = header.data_offset + header.size;
+  if (length > (Uint64)std::numeric_limits<size_t>::max())
+    return nullptr;
+  mapping = map_file(name, (size_t)length);
+  if (mapping == nullptr)
+    return nullptr;
+  compute_error = header.compute_error;
+  return static_cast<Byte *>(mapping->base) + header.data_offset;
+}
+
+void store(const String &key, const void *table, size_t size, int compute_error)
+{
+  const String directory = get_directory();
+  if (directory.empty())
+    return;
+  const String name = file_name(directory, key);
+  const String temp_name = name + "." + std::to_string(process_id()) + ".tmp";
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, MAGIC, sizeof(MAGIC));
+  header.format_version = FORMAT_VERSION;
+  header.compute_error = compute_error;
+  header.size = size;
+  header.data_offset = data_offset(key);
+  header.key_length = (unsigned int)key.size();
+
+  FILE *f = fopen(temp_name.c_str(), "wb");
+  if (f == nullptr)
+    return;
+  const std::vector<char> padding(header.data_offset - sizeof(header) - key.size(), 0);
+  bool ok = fwrite(&header, sizeof(header), 1, f) == 1
+    && fwrite(key.data(), 1, key.size(), f) == key.size()
+    && fwrite(padding.data(), 1, padding.size(), f) == padding.size()
+    && fwrite(table, 1, size, f) == size;
+  ok = fclose(f) == 0 && ok;
+  // another process may have written the same table meanwhile, the content is the same
+  if (!ok || !replace_file(temp_name, name))
+    remove(temp_name.c_str());
+}
+
+} } } } }
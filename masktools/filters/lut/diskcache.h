@@ -0,0 +1,35 @@
+#ifndef __Mt_Lut_DiskCache_H__
+#define __Mt_Lut_DiskCache_H__
+
+#include "../../../common/utils/utils.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace DiskCache {
+
+// Lut tables saved to disk, v2.2.31
+// When a directory is set (mt_lutcache("path") in the script), finished tables are written there and later
+// script loads map them read-only instead of building them again. Processes on the same host share the pages.
+// File: <directory>/<64 bit hash of the Lut::Cache key>.mtlut
+//   header: "MTLUTBIN", format version, compute error, table size, data offset, key length, key
+//   table data from the data offset (64 KByte aligned, the Windows mapping granularity)
+// The full key is stored and compared, a file of another table with the same hash is simply rebuilt and
+// overwritten. Files are written to a temporary name first and renamed, readers never see partial tables.
+// Bump FORMAT_VERSION when the content of any table changes for the same key.
+
+// 2: libm results in double precision again, precision="float" tables with the vector math kernels
+const int FORMAT_VERSION = 2;
+
+struct Mapping;
+
+// empty: no disk cache (default)
+void set_directory(const String &directory);
+String get_directory();
+
+// Maps the table of key when a valid file of this size exists, nullptr otherwise. The mapping is read only.
+void *load(const String &key, size_t size, int &compute_error, Mapping *&mapping);
+// Saves a table, errors (no space, read-only directory) are ignored
+void store(const String &key, const void *table, size_t size, int compute_error);
+void unmap(Mapping *mapping);
+
+} } } } }
+
+#endif
@@ -122,11 +122,8 @@ public:
 
       dTotalCoefficients = 0;
 
-      while ( !coefficients.empty() )
-      {
-         dTotalCoefficients += (pdCoefficients[i++] = coefficients.front().getValue(0, 0, 0));
-         coefficients.pop_front();
-      }
+      for (auto &coefficient : coefficients)
+         dTotalCoefficients += (pdCoefficients[i++] = coefficient.getValue(0, 0, 0));
    }
    ~Nonizer()
    {
@@ -366,11 +363,8 @@ public:
 
     dTotalCoefficients = 0;
 
-    while (!coefficients.empty())
-    {
-      dTotalCoefficients += (pdCoefficients[i++] = coefficients.front().getValue(0, 0, 0));
-      coefficients.pop_front();
-    }
+    for (auto &coefficient : coefficients)
+      dTotalCoefficients += (pdCoefficients[i++] = coefficient.getValue(0, 0, 0));
   }
   ~Nonizer16()
   {
@@ -612,11 +606,8 @@ public:
 
     dTotalCoefficients = 0;
 
-    while (!coefficients.empty())
-    {
-      dTotalCoefficients += (pdCoefficients[i++] = coefficients.front().getValue(0, 0, 0));
-      coefficients.pop_front();
-    }
+    for (auto &coefficient : coefficients)
+      dTotalCoefficients += (pdCoefficients[i++] = coefficient.getValue(0, 0, 0));
   }
   ~Nonizer32()
   {
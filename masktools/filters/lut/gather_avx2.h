@@ -0,0 +1,57 @@
+#ifndef __Mt_Lut_Gather_AVX2_H__
+#define __Mt_Lut_Gather_AVX2_H__
+
+#include "../../../common/utils/utils.h"
+#include <immintrin.h>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Gather {
+
+// v2.2.31: table lookups of 8 indices (dwords) with vpgatherdd, for the _avx2 table kernels.
+// The dword containing the entry is gathered from its 4 byte aligned address, so no byte is read past the
+// end of the table, then the entry is shifted down.
+
+// 8 pixels of an 8 or 16 bit plane, as dwords
+static MT_FORCEINLINE __m256i load_bytes(const Byte *src) {
+  return _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(src)));
+}
+
+static MT_FORCEINLINE __m256i load_words(const Word *src) {
+  return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i *>(src)));
+}
+
+// pixels above max are looked up as max, like the min(pixel, max_pixel_value) of the C versions
+template<int bits_per_pixel>
+static MT_FORCEINLINE __m256i load_words_clamped(const Word *src) {
+  const __m256i pixels = load_words(src);
+  if constexpr (bits_per_pixel == 16)
+    return pixels;
+  else
+    return _mm256_min_epi32(pixels, _mm256_set1_epi32((1 << bits_per_pixel) - 1));
+}
+
+// index: unsigned, up to 32 bits for Word tables
+static MT_FORCEINLINE __m256i lookup_bytes(const Byte *lut, __m256i index) {
+  const __m256i dwords = _mm256_i32gather_epi32(reinterpret_cast<const int *>(lut), _mm256_srli_epi32(index, 2), 4);
+  const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(3)), 3);
+  return _mm256_and_si256(_mm256_srlv_epi32(dwords, shift), _mm256_set1_epi32(0xFF));
+}
+
+static MT_FORCEINLINE __m256i lookup_words(const Word *lut, __m256i index) {
+  const __m256i dwords = _mm256_i32gather_epi32(reinterpret_cast<const int *>(lut), _mm256_srli_epi32(index, 1), 4);
+  const __m256i shift = _mm256_slli_epi32(_mm256_and_si256(index, _mm256_set1_epi32(1)), 4);
+  return _mm256_and_si256(_mm256_srlv_epi32(dwords, shift), _mm256_set1_epi32(0xFFFF));
+}
+
+// 4x8 looked up bytes to 32 pixels, 2x8 looked up words to 16 pixels, in order
+static MT_FORCEINLINE void store_bytes(Byte *dst, __m256i v0, __m256i v1, __m256i v2, __m256i v3) {
+  const __m256i packed = _mm256_packus_epi16(_mm256_packus_epi32(v0, v1), _mm256_packus_epi32(v2, v3));
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permutevar8x32_epi32(packed, _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7)));
+}
+
+static MT_FORCEINLINE void store_words(Word *dst, __m256i v0, __m256i v1) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst), _mm256_permute4x64_epi64(_mm256_packus_epi32(v0, v1), 0xD8));
+}
+
+} } } } }
+
+#endif
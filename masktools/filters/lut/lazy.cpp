@@ -0,0 +1,121 @@
+#include "lazy.h"
+#include <limits>
+#include <vector>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Lazy {
+
+// 16 bit results need a sentinel outside of the Word range
+template<typename Entry>
+static Entry sentinel() { return std::numeric_limits<Entry>::max(); }
+
+Table::Table(int bits_per_pixel) : bits_per_pixel(bits_per_pixel), allocated_tiles(0)
+{
+  nTiles = (size_t)1 << (2 * (bits_per_pixel - TILE_BITS));
+  const size_t tile_bytes = ((size_t)1 << (2 * TILE_BITS)) * (bits_per_pixel == 16 ? sizeof(uint32_t) : sizeof(Word));
+  max_tiles = MAX_BYTES / tile_bytes;
+  tiles = new std::atomic<void *>[nTiles];
+  for (size_t i = 0; i < nTiles; i++)
+    tiles[i].store(nullptr, std::memory_order_relaxed);
+}
+
+Table::~Table()
+{
+  for (size_t i = 0; i < nTiles; i++) {
+    void *t = tiles[i].load(std::memory_order_relaxed);
+    if (bits_per_pixel == 16)
+      delete[] static_cast<std::atomic<uint32_t> *>(t);
+    else
+      delete[] static_cast<std::atomic<Word> *>(t);
+  }
+  delete[] tiles;
+}
+
+template<typename Entry>
+std::atomic<Entry> *Table::tile(size_t index)
+{
+  void *t = tiles[index].load(std::memory_order_acquire);
+  if (t != nullptr)
+    return static_cast<std::atomic<Entry> *>(t);
+
+  // the tile is counted before it is allocated, threads racing for the last ones cannot pass MAX_BYTES
+  if (allocated_tiles.fetch_add(1, std::memory_order_relaxed) >= max_tiles) {
+    allocated_tiles.fetch_sub(1, std::memory_order_relaxed);
+    return nullptr;
+  }
+
+  const size_t entries = (size_t)1 << (2 * TILE_BITS);
+  std::atomic<Entry> *fresh = new std::atomic<Entry>[entries];
+  for (size_t i = 0; i < entries; i++)
+    fresh[i].store(sentinel<Entry>(), std::memory_order_relaxed);
+  // another thread may have published the same tile meanwhile, use that one
+  if (tiles[index].compare_exchange_strong(t, fresh, std::memory_order_acq_rel, std::memory_order_acquire))
+    return fresh;
+  allocated_tiles.fetch_sub(1, std::memory_order_relaxed);
+  delete[] fresh;
+  return static_cast<std::atomic<Entry> *>(t);
+}
+
+template<typename Entry>
+void Table::lookup_row_t(Word *dst, const Word *xs, const Word *ys, int width, Parser::Context &ctx)
+{
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int tile_mask = (1 << TILE_BITS) - 1;
+  const int tile_shift = bits_per_pixel - TILE_BITS;
+
+  // pairs not in the table yet, rare after the first frames
+  std::vector<int> missing;
+  std::vector<Word> missing_x, missing_y;
+
+  for (int i = 0; i < width; i++) {
+    const int x = min((int)xs[i], max_pixel_value);
+    const int y = min((int)ys[i], max_pixel_value);
+    const size_t index = ((size_t)(x >> TILE_BITS) << tile_shift) + (y >> TILE_BITS);
+    const std::atomic<Entry> *t = static_cast<const std::atomic<Entry> *>(tiles[index].load(std::memory_order_acquire));
+    if (t != nullptr) {
+      const Entry value = t[((x & tile_mask) << TILE_BITS) + (y & tile_mask)].load(std::memory_order_relaxed);
+      if (value != sentinel<Entry>()) {
+        dst[i] = (Word)value;
+        continue;
+      }
+    }
+    // dst[i] is written only after the missing values are evaluated, xs and ys may be dst
+    missing.push_back(i);
+    missing_x.push_back((Word)x);
+    missing_y.push_back((Word)y);
+  }
+
+  if (missing.empty())
+    return;
+
+  const int count = (int)missing.size();
+  std::vector<Word> results(count);
+  const Word *srcs[] = { missing_x.data(), missing_y.data() };
+  ctx.compute_row_word(results.data(), srcs, 2, count, bits_per_pixel);
+
+  for (int k = 0; k < count; k++) {
+    const int x = missing_x[k];
+    const int y = missing_y[k];
+    std::atomic<Entry> *t = tile<Entry>(((size_t)(x >> TILE_BITS) << tile_shift) + (y >> TILE_BITS));
+    if (t != nullptr)
+      t[((x & tile_mask) << TILE_BITS) + (y & tile_mask)].store(results[k], std::memory_order_relaxed);
+    dst[missing[k]] = results[k];
+  }
+}
+
+void Table::lookup_row(Word *dst, const Word *xs, const Word *ys, int width, Parser::Context &ctx)
+{
+  if (bits_per_pixel == 16)
+    lookup_row_t<uint32_t>(dst, xs, ys, width, ctx);
+  else
+    lookup_row_t<Word>(dst, xs, ys, width, ctx);
+}
+
+size_t Table::allocated_bytes() const
+{
+  const size_t entry_size = bits_per_pixel == 16 ? sizeof(uint32_t) : sizeof(Word);
+  return allocated_tiles.load(std::memory_order_relaxed) * ((size_t)1 << (2 * TILE_BITS)) * entry_size + nTiles * sizeof(void *);
+}
+
+} } } } }
@@ -0,0 +1,55 @@
+#ifndef __Mt_Lut_Lazy_H__
+#define __Mt_Lut_Lazy_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <atomic>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Lazy {
+
+// Lazily filled xy tables for mt_lutxy and mt_luts at 14 and 16 bits (lazy=true), v2.2.31
+// A full table is 512 MBytes (14 bits) or 8 GBytes (16 bits), these bit depths default to realtime evaluation.
+// Real frames use a small, strongly correlated part of the (x, y) pairs though. This table starts empty and
+// remembers the result of every pair once it was evaluated:
+// - the index space is split into 128x128 tiles, a tile is allocated when the first pair in it is used.
+//   Memory follows the pairs the clips really contain, up to MAX_BYTES per table. When that is reached no more
+//   tiles are allocated, pairs in the other tiles are evaluated each time like in realtime mode.
+// - entries start as a sentinel (14 bits: 0xFFFF in 16 bit entries, 16 bits: 0xFFFFFFFF in 32 bit entries)
+// - the missing pairs of a row are evaluated together with Context::compute_row_word and stored atomically.
+//   Threads share the table without locks, a pair evaluated by two threads at once gets the same value twice.
+// Results are the same as with realtime evaluation. Tables are shared by the filter instances (Lut::Cache).
+
+class Table {
+  static const int TILE_BITS = 7;
+  // tiles of one table, at most the size of a full 14 bit table (uncorrelated inputs like grain would fill it all)
+  static const size_t MAX_BYTES = (size_t)512 << 20;
+
+  int bits_per_pixel;
+  size_t nTiles;
+  std::atomic<void *> *tiles;
+  std::atomic<size_t> allocated_tiles;
+  size_t max_tiles;
+
+  template<typename Entry>
+  void lookup_row_t(Word *dst, const Word *xs, const Word *ys, int width, Parser::Context &ctx);
+
+  // nullptr: not allocated, MAX_BYTES reached
+  template<typename Entry>
+  std::atomic<Entry> *tile(size_t index);
+
+public:
+  // 10..16 bits
+  Table(int bits_per_pixel);
+  ~Table();
+
+  // dst[i] = the expression for (xs[i], ys[i]), inputs over the bit depth are clamped like in compute_row_word.
+  // ctx: the compiled expression of the table, evaluates the missing pairs. dst may be the same as xs or ys.
+  void lookup_row(Word *dst, const Word *xs, const Word *ys, int width, Parser::Context &ctx);
+
+  // tiles are never freed before the table
+  size_t allocated_bytes() const;
+};
+
+} } } } }
+
+#endif
@@ -17,9 +17,8 @@ void Filtering::MaskTools::Filters::Lut::Single::realtime8_c(Byte *dstp, ptrdiff
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      dstp[x] = ctx.compute_byte_x(dstp[x]);
-    }
+    const Byte *srcs[] = { dstp };
+    ctx.compute_row_byte(dstp, srcs, 1, width);
     dstp += dst_pitch;
   }
 }
@@ -29,9 +28,8 @@ void Filtering::MaskTools::Filters::Lut::Single::realtime32_c(Byte *dstp, ptrdif
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      reinterpret_cast<Float *>(dstp)[x] = ctx.compute_float_x(reinterpret_cast<Float *>(dstp)[x], chroma);
-    }
+    const Float *srcs[] = { reinterpret_cast<Float *>(dstp) };
+    ctx.compute_row_float(reinterpret_cast<Float *>(dstp), srcs, 1, width, chroma);
     dstp += dst_pitch;
   }
 }
@@ -3,6 +3,12 @@
 
 #include "../../../common/base/filter.h"
 #include "../../../../common/parser/parser.h"
+#include "../cache.h"
+#include "../approx.h"
+#include "../neighbours.h"
+#include "../crossplane.h"
+#include "../strategy.h"
+#include "../stats.h"
 
 /*\\\ INCLUDE FILES \\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\\*/
 #include "avs/config.h" // WIN/POSIX/ETC defines
@@ -21,12 +27,17 @@ typedef void(ProcessorCtx)(Byte *pDst, ptrdiff_t nDstPitch, int nWidth, int nHei
 typedef void(ProcessorCtx32)(Byte *pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, bool chroma, Parser::Context &ctx);
 
 Processor lut_c;
+Processor lut_avx2; // v2.2.31
 
 extern Processor16* lut10_c;
 extern Processor16* lut12_c;
 extern Processor16* lut14_c;
 extern Processor16* lut16_c;
 extern Processor16* lut16_stacked_c;
+extern Processor16* lut10_avx2; // v2.2.31
+extern Processor16* lut12_avx2;
+extern Processor16* lut14_avx2;
+extern Processor16* lut16_avx2;
 
 ProcessorCtx realtime8_c;
 extern ProcessorCtx *realtime10_c;
@@ -45,34 +56,17 @@ class Lutx : public MaskTools::Filter
 
   Lut luts[4 + 1];
 
-  static Byte* calculateLut(const std::deque<Filtering::Parser::Symbol>& expr, int bits_per_pixel, String scale_inputs, int clamp_float, int &compute_error) {
+  static Byte* calculateLut(const std::vector<Filtering::Parser::Symbol>& expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int &compute_error) {
     Parser::Context ctx(expr, scale_inputs, clamp_float);
+    ctx.SetCpuFlags(cpu_flags);
     int pixelsize = bits_per_pixel == 8 ? 1 : 2; // byte / uint16_t
     size_t buffer_size = ((size_t)1 << bits_per_pixel) * pixelsize;
     Byte* lut = (Byte *)_aligned_malloc(buffer_size, 128);
 
-    switch (bits_per_pixel) {
-    case 8:
-      for (int x = 0; x < 256; x++)
-        lut[x] = ctx.compute_byte_x(x);
-      break;
-    case 10:
-      for (int x = 0; x < 1024; x++)
-        reinterpret_cast<Word*>(lut)[x] = ctx.compute_word_x<10>(x);
-      break;
-    case 12:
-      for (int x = 0; x < 4096; x++)
-        reinterpret_cast<Word*>(lut)[x] = ctx.compute_word_x<12>(x);
-      break;
-    case 14:
-      for (int x = 0; x < 16384; x++)
-        reinterpret_cast<Word*>(lut)[x] = ctx.compute_word_x<14>(x);
-      break;
-    case 16:
-      for (int x = 0; x < 65536; x++)
-        reinterpret_cast<Word*>(lut)[x] = ctx.compute_word_x<16>(x);
-      break;
-    }
+    if (bits_per_pixel == 8)
+      ctx.compute_lut_row_byte(lut, nullptr, 1, 0);
+    else
+      ctx.compute_lut_row_word(reinterpret_cast<Word*>(lut), nullptr, 1, 0, bits_per_pixel);
 
     // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
     compute_error = ctx.get_compute_error();
@@ -80,11 +74,33 @@ class Lutx : public MaskTools::Filter
     return lut;
   }
 
+  // v2.2.31: tables are shared with the other filter instances (Lut::Cache)
+  static void freeLut(void *lut) { _aligned_free(lut); }
+
+  size_t lut_size() const { return ((size_t)1 << bits_per_pixel) * (bits_per_pixel == 8 ? 1 : 2); }
+
+  Byte *acquireLut(const std::vector<Filtering::Parser::Symbol>& expr, int& compute_error) {
+    return static_cast<Byte *>(Cache::acquire(Cache::key("x", expr, bits_per_pixel, scale_inputs, clamp_float_i), lut_size(), [&](int &build_error) -> void * {
+      return calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float_i, flags, /*ref*/ build_error);
+    }, freeLut, compute_error));
+  }
+
+  // v2.2.31: shared like the integer tables
+  Approx::Table *acquireApprox(const std::vector<Filtering::Parser::Symbol>& expr, bool chroma) {
+    int unused;
+    return static_cast<Approx::Table *>(Cache::acquire(Cache::key(Approx::layout(1, chroma, float_tolerance).c_str(), expr, bits_per_pixel, scale_inputs, clamp_float_i), 0, [&](int &) -> void * {
+      return Approx::calculateLut(expr, 1, chroma, float_tolerance, scale_inputs, clamp_float_i, flags);
+    }, Cache::destroy_object<Approx::Table>, unused));
+  }
+
    // for realtime
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
+   Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
+   Stats::Filter *stats; // v2.2.31: mt_exprstats, nullptr: not profiled
+   Approx::Table *approx_luts[4]; // v2.2.31: interpolated float tables (float_tolerance), nullptr: realtime
+   double float_tolerance;
 
-   Processor *processor;
-   Processor16 *processor16;
+   ProcessorList<Processor> processors; // v2.2.31: 8 bit tables, by CPU
+   ProcessorList<Processor16> processors16; // v2.2.31: 10-16 bit tables, by CPU
    ProcessorCtx *processorCtx; /// for 8-16 bits
    //ProcessorCtx *processorCtx16;
    ProcessorCtx32 *processorCtx32;
@@ -94,34 +110,55 @@ class Lutx : public MaskTools::Filter
    String scale_inputs;
    int clamp_float_i;
    int use_expr;
+   CrossPlane::Siting siting; // v2.2.31: other plane operands (x.Y), parameter cplace
+
+   // v2.2.31: evaluation of a processed plane, for mt_exprstats
+   String plane_path(int i) const {
+     if (realtime_contexts[i] == nullptr)
+       return "table";
+     return approx_luts[i] ? "approx" : "realtime";
+   }
 
 protected:
     virtual void process(int n, const Plane<Byte> &dst, int nPlane, const ::Filtering::Frame<const Byte> frames[4], const Constraint constraints[4]) override
     {
         UNUSED(n);
-        UNUSED(constraints);
+        Stats::Timer timer(stats, nPlane, dst.width() * dst.height()); // v2.2.31: mt_exprstats
         UNUSED(frames);
         if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
-          if(bits_per_pixel <= 16)
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
+          const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
+          if (!ctx.get_neighbours().empty()) {
+            const Byte *srcs[] = { dst.data() };
+            const ptrdiff_t pitches[] = { dst.pitch() };
+            // v2.2.31: other plane operands (x.Y) read all planes of the inputs
+            const CrossPlane::Sources sources(frames, 1, keep_source_frame ? plane_counts[C] : 0, siting);
+            Neighbours::process(dst.data(), dst.pitch(), srcs, pitches, 1, dst.width(), dst.height(), bits_per_pixel, chroma, keep_source_frame ? &sources : nullptr, ctx);
+          }
+          else if(bits_per_pixel <= 16)
             processorCtx(dst.data(), dst.pitch(), dst.width(), dst.height(), ctx);
           else {
-            const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
-            processorCtx32(dst.data(), dst.pitch(), dst.width(), dst.height(), chroma, ctx); // extra parameter
+            if (approx_luts[nPlane])
+              Approx::process(dst.data(), dst.pitch(), nullptr, 0, dst.width(), dst.height(), *approx_luts[nPlane], chroma, ctx, flags);
+            else
+              processorCtx32(dst.data(), dst.pitch(), dst.width(), dst.height(), chroma, ctx); // extra parameter
           }
         }
         else if (bits_per_pixel == 8)
-          processor(dst.data(), dst.pitch(), dst.width(), dst.height(), luts[nPlane].ptr);
+          processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(), dst.width(), dst.height(), luts[nPlane].ptr);
         else if (bits_per_pixel <= 16)
-          processor16(dst.data(), dst.pitch(), dst.width(), dst.height(), (Word*)luts[nPlane].ptr, dst.origheight());
+          processors16.best_processor(constraints[nPlane])(dst.data(), dst.pitch(), dst.width(), dst.height(), (Word*)luts[nPlane].ptr, dst.origheight());
     }
 
 public:
   Lutx(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter(parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
   {
+      stats = nullptr;
       for (int i = 0; i < 4; i++) {
-        parsed_expressions[i] = nullptr;
+        realtime_contexts[i] = nullptr;
+        approx_luts[i] = nullptr;
       }
 
       for (int i = 0; i < 4 + 1; ++i) {
@@ -131,7 +168,7 @@ public:
 
       static const char *expr_strs[] = { "yExpr", "uExpr", "vExpr", "aExpr" };
 
-      Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X);
+      Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addNeighbours();
 
       isStacked = parameters["stacked"].toBool();
       bits_per_pixel = bit_depths[C];
@@ -149,6 +186,20 @@ public:
       if (!checkValidScaleInputs(scale_inputs, error))
         return; // error message filled
 
+      // v2.2.31: float32 evaluation of the expressions
+      const String precision = parameters["precision"].toString();
+      if (precision != "double" && precision != "float") {
+        error = "precision must be \"double\" or \"float\"";
+        return;
+      }
+      const bool single_precision = precision == "float";
+
+      // v2.2.31: siting of the subsampled planes for the other plane operands (x.Y), as in mt_merge
+      if (!CrossPlane::parse_siting(parameters["cplace"].toString(), siting)) {
+        error = "cplace: only mpeg1, mpeg2 and top_left allowed";
+        return;
+      }
+
       bool clamp_float = parameters["clamp_float"].toBool();
       bool clamp_float_UV = parameters["clamp_float_UV"].toBool();
       clamp_float_i = clamp_float ? (clamp_float_UV ? 2 : 1) : 0;
@@ -157,6 +208,12 @@ public:
         realtime = true;
       }
 
+      float_tolerance = parameters["float_tolerance"].toFloat();
+      if (float_tolerance < 0) {
+        error = "float_tolerance cannot be negative";
+        return;
+      }
+
       if (realtime && isStacked) {
         error = "realtime calculation not supported for stacked clip";
         return;
@@ -166,10 +223,36 @@ public:
       // This part is duplicated in lut, lutxy, lutxyz, lutxyza
       use_expr = parameters["use_expr"].toInt();
       bool use_external_expr = false;
-      if (use_expr < 0 || use_expr > 3) {
+      String use_expr_decision; // v2.2.31: use_expr=4, the chosen mode and the estimated costs, for mt_exprstats
+      if (use_expr < 0 || use_expr > 4) {
         error = "invalid value for parameter 'use_expr'";
         return;
       }
+      // v2.2.31: mode 4: the mode with the lowest estimated cost over the clip (Lut::Strategy).
+      // realtime given explicitly is kept, the choice is between it and Expr then
+      if (use_expr == 4) {
+        Strategy::Workload workload;
+        workload.nInputs = 1;
+        workload.bits_per_pixel = bits_per_pixel;
+        workload.frames = childs[0]->frame_count();
+        const int pixels_uv = plane_counts[C] > 1 ? nCoreWidthUV * nCoreHeightUV : 0;
+        const int pixels[4] = { nCoreWidth * nCoreHeight, pixels_uv, pixels_uv, nCoreWidth * nCoreHeight };
+        // invalid expressions are reported below
+        if (Strategy::add_planes(workload, parser, parameters, operators, plane_counts[C], pixels, scale_inputs, clamp_float_i)) {
+          const bool realtime_defined = parameters["realtime"].is_defined();
+          workload.allowed[Strategy::TABLE] = realtime_defined ? !realtime : bits_per_pixel <= 16;
+          workload.allowed[Strategy::REALTIME] = !realtime_defined || realtime;
+          workload.allowed[Strategy::EXPR] = has_avs_expr_support && nXOffset == 0 && nYOffset == 0 && nWidth == nCoreWidth && nHeight == nCoreHeight;
+          const Strategy::Decision decision = Strategy::choose(workload);
+          use_expr_decision = decision.describe();
+          print(LOG_DEBUG, "mt_lut use_expr=4: %s\n", use_expr_decision.c_str());
+          if (decision.choice == Strategy::EXPR)
+            use_external_expr = true;
+          else if (!realtime_defined) {
+            realtime = decision.choice != Strategy::TABLE;
+          }
+        }
+      }
       if (use_expr == 1 && bits_per_pixel > 8) // mode 1: use Expr when over 8 bits or lutxyza
         use_external_expr = true;
       if (use_expr == 2 && realtime) // mode 2: use Expr when masktools would use its own slow calculation
@@ -254,6 +337,10 @@ public:
             return;
           }
 
+          // v2.2.31: control symbol, seen by every Context of the expression and part of the table keys
+          if (single_precision)
+            parser.getExpression().insert(parser.getExpression().begin(), Parser::Symbol::PrecisionF32);
+
           Parser::Context ctx(parser.getExpression(), scale_inputs, clamp_float_i);
 
           if (!ctx.check())
@@ -262,8 +349,26 @@ public:
             return;
           }
 
+          // v2.2.31: relative pixel operands (x[-1,0]) and other plane operands (x.Y) have no table
+          const bool neighbours = !ctx.get_neighbours().empty();
+          if (neighbours && !realtime) {
+            error = "relative pixel operands like x[-1,0] and other plane operands like x.Y need realtime=true";
+            return;
+          }
+          const int last_plane = CrossPlane::last_plane(ctx.get_neighbours());
+          if (last_plane >= plane_counts[C]) {
+            error = "other plane operand of a plane the clip does not have";
+            return;
+          }
+          if (last_plane >= 0)
+            keep_source_frame = true;
+
           if (realtime) {
-            parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+
+            // v2.2.31: interpolated table when its error is within float_tolerance
+            if (bits_per_pixel == 32 && float_tolerance > 0 && !neighbours)
+              approx_luts[i] = acquireApprox(parser.getExpression(), (i == 1 || i == 2) && !planes_isRGB[C]);
 
             switch (bits_per_pixel) {
             case 8: processorCtx = realtime8_c; break;
@@ -283,12 +388,12 @@ public:
           // save memory, reuse luts, like in xyz
           if (customExpressionDefined) {
             luts[i].used = true;
-            luts[i].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float_i, /*ref*/ compute_error);
+            luts[i].ptr = acquireLut(parser.getExpression(), /*ref*/ compute_error);
           }
           else {
             if (luts[4].ptr == nullptr) {
               luts[4].used = true;
-              luts[4].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float_i, /*ref*/ compute_error);
+              luts[4].ptr = acquireLut(parser.getExpression(), /*ref*/ compute_error);
             }
             luts[i].ptr = luts[4].ptr;
           }
@@ -297,40 +402,53 @@ public:
             error = "invalid expression in the lut code = " + std::to_string(compute_error);
             return;
           }
+        }
+      }
 
-          switch (bits_per_pixel) {
-          case 8:
-            processor = lut_c;
-            break;
-          case 10:
-            processor16 = lut10_c;
-            break;
-          case 12:
-            processor16 = lut12_c;
-            break;
-          case 14:
-            processor16 = lut14_c;
-            break;
-          case 16:
-            if (isStacked)
-              processor16 = lut16_stacked_c;
-            else
-              processor16 = lut16_c;
-            break;
-          }
+      // v2.2.31: the 8 bit table in 16 byte pshufb pieces with AVX2, any width (the remainder of a row is done by lut_c).
+      // 128 bit pshufb is not faster than the table lookup of lut_c.
+      if (bits_per_pixel == 8) {
+        processors.push_back(Filtering::Processor<Processor>(lut_c, Constraint(CPU_NONE, 1, 1, 1, 1), 0));
+        processors.push_back(Filtering::Processor<Processor>(lut_avx2, Constraint(CPU_AVX2, MODULO_NONE, MODULO_NONE, ALIGNMENT_NONE, 32), 1));
+      }
+      else if (bits_per_pixel <= 16) {
+        // v2.2.31: 10-16 bits, the table entries gathered with AVX2, 16 pixels at a time (the remainder of a row in C)
+        Processor16 *c = nullptr, *avx2 = nullptr;
+        switch (bits_per_pixel) {
+        case 10: c = lut10_c; avx2 = lut10_avx2; break;
+        case 12: c = lut12_c; avx2 = lut12_avx2; break;
+        case 14: c = lut14_c; avx2 = lut14_avx2; break;
+        case 16: c = isStacked ? lut16_stacked_c : lut16_c; avx2 = isStacked ? nullptr : lut16_avx2; break;
         }
+        processors16.push_back(Filtering::Processor<Processor16>(c, Constraint(CPU_NONE, 1, 1, 1, 1), 0));
+        if (avx2)
+          processors16.push_back(Filtering::Processor<Processor16>(avx2, Constraint(CPU_AVX2, MODULO_NONE, MODULO_NONE, ALIGNMENT_NONE, 16), 1));
+      }
+
+      // v2.2.31: mt_exprstats
+      const String decision_note = use_expr_decision.empty() ? String() : "; use_expr=4: " + use_expr_decision;
+      stats = Stats::create("mt_lut");
+      for (int i = 0; i < 4 && stats; i++) {
+        if (operators[i] != PROCESS)
+          continue;
+        if (use_external_expr)
+          Stats::set_plane(stats, i, expr_list[i], "expr" + decision_note, nullptr);
+        else
+          Stats::set_plane(stats, i, parameters[expr_strs[i]].is_defined() ? parameters[expr_strs[i]].toString() : parameters["expr"].toString(), plane_path(i) + decision_note, realtime_contexts[i]);
       }
    }
 
    ~Lutx()
    {
+     Stats::destroy(stats); // before the ContextPools
      for (int i = 0; i < 4 + 1; ++i) {
        if (luts[i].used) {
-         _aligned_free(luts[i].ptr);
+         Cache::release(luts[i].ptr);
        }
      }
      for (int i = 0; i < 4; i++) {
-       delete parsed_expressions[i];
+       delete realtime_contexts[i];
+       Cache::release(approx_luts[i]);
      }
    }
 
@@ -355,6 +473,9 @@ public:
       signature.add(Parameter(false, "clamp_float", false));
       signature.add(Parameter(0, "use_expr", false));
       signature.add(Parameter(false, "clamp_float_UV", false));
+      signature.add(Parameter(0.0f, "float_tolerance", false));
+      signature.add(Parameter(String("double"), "precision", false));
+      signature.add(Parameter(String("mpeg2"), "cplace", false));
       return signature;
    }
 };
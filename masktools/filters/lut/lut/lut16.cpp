@@ -41,18 +41,11 @@ static void lut16_t_c(Byte * pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight,
 template<int bits_per_pixel>
 static void realtime16_t_c(Byte* dstp, ptrdiff_t dst_pitch, int width, int height, Parser::Context& ctx)
 {
-  constexpr int max_pixel_value = (1 << bits_per_pixel) - 1;
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      int pixel = reinterpret_cast<uint16_t*>(dstp)[x];
-      if constexpr(bits_per_pixel != 16) 
-        pixel = min(pixel, max_pixel_value);
-
-      const auto result = ctx.compute_word_x<bits_per_pixel>(pixel);
-
-      reinterpret_cast<uint16_t*>(dstp)[x] = result;
-    }
+    // input is clamped below 16 bit
+    const Word *srcs[] = { reinterpret_cast<Word*>(dstp) };
+    ctx.compute_row_word(reinterpret_cast<Word*>(dstp), srcs, 1, width, bits_per_pixel);
     dstp += dst_pitch;
   }
 }
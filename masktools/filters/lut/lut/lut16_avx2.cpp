@@ -0,0 +1,40 @@
+#include "lut.h"
+#include "../gather_avx2.h"
+
+using namespace Filtering;
+namespace Gather = Filtering::MaskTools::Filters::Lut::Gather;
+
+// v2.2.31: 16 pixels at a time, table entries gathered (Lut::Gather)
+template<int bits_per_pixel>
+static void lut16_t_avx2(Byte * pDst, ptrdiff_t nDstPitch, int nWidth, int nHeight, const Word *lut, int)
+{
+  constexpr int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int wmod16 = nWidth & ~15;
+  for (int y = 0; y < nHeight; y++)
+  {
+    auto pDst16 = reinterpret_cast<Word*>(pDst);
+    for (int x = 0; x < wmod16; x += 16) {
+      const __m256i lo = Gather::lookup_words(lut, Gather::load_words_clamped<bits_per_pixel>(pDst16 + x));
+      const __m256i hi = Gather::lookup_words(lut, Gather::load_words_clamped<bits_per_pixel>(pDst16 + x + 8));
+      Gather::store_words(pDst16 + x, lo, hi);
+    }
+    for (int x = wmod16; x < nWidth; x++)
+      pDst16[x] = lut[min((int)pDst16[x], max_pixel_value)];
+    pDst += nDstPitch;
+  }
+}
+
+namespace Filtering {
+  namespace MaskTools {
+    namespace Filters {
+      namespace Lut {
+        namespace Single {
+          Processor16* lut10_avx2 = &lut16_t_avx2<10>;
+          Processor16* lut12_avx2 = &lut16_t_avx2<12>;
+          Processor16* lut14_avx2 = &lut16_t_avx2<14>;
+          Processor16* lut16_avx2 = &lut16_t_avx2<16>;
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,39 @@
+#include "lut.h"
+#include <immintrin.h>
+
+using namespace Filtering;
+
+// v2.2.31: 32 pixels at a time. The 16 pshufb lookups of the low nibble in the 16 byte pieces of the table
+// are merged by a blend tree over the bits of the high nibble: bit 4 selects between pieces 2j and 2j+1, etc.
+// blendv reads bit 7 of each byte, the bit is shifted there (the bits shifted in from the next byte are ignored).
+void Filtering::MaskTools::Filters::Lut::Single::lut_avx2(Byte * dstp, ptrdiff_t dst_pitch, int width, int height, const Byte * lut)
+{
+  __m256i pieces[16];
+  for (int k = 0; k < 16; k++)
+    pieces[k] = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i *>(lut + 16 * k)));
+  const __m256i low_nibble = _mm256_set1_epi8(0x0F);
+  const int wmod32 = width & ~31;
+
+  for (int y = 0; y < height; y++)
+  {
+    for (int x = 0; x < wmod32; x += 32) {
+      const __m256i src = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(dstp + x));
+      const __m256i index = _mm256_and_si256(src, low_nibble);
+      __m256i level[8];
+      const __m256i bit4 = _mm256_slli_epi16(src, 3);
+      for (int j = 0; j < 8; j++)
+        level[j] = _mm256_blendv_epi8(_mm256_shuffle_epi8(pieces[2 * j], index), _mm256_shuffle_epi8(pieces[2 * j + 1], index), bit4);
+      const __m256i bit5 = _mm256_slli_epi16(src, 2);
+      for (int j = 0; j < 4; j++)
+        level[j] = _mm256_blendv_epi8(level[2 * j], level[2 * j + 1], bit5);
+      const __m256i bit6 = _mm256_slli_epi16(src, 1);
+      for (int j = 0; j < 2; j++)
+        level[j] = _mm256_blendv_epi8(level[2 * j], level[2 * j + 1], bit6);
+      const __m256i result = _mm256_blendv_epi8(level[0], level[1], src);
+      _mm256_storeu_si256(reinterpret_cast<__m256i *>(dstp + x), result);
+    }
+    for (int x = wmod32; x < width; x++)
+      dstp[x] = lut[dstp[x]];
+    dstp += dst_pitch;
+  }
+}
@@ -28,8 +28,8 @@ static void frame_c(Byte *dstp, ptrdiff_t dst_pitch, const Byte *srcp, ptrdiff_t
       // realtime, compute_byte(X,srcp[i]) for each pixels: 6.3fps
       // realtime, miniLut: 173 fps
       Byte miniLut[256];
-      for(int i=0; i<256;i++)
-        miniLut[i] = ctx->compute_byte_xy(X, i);
+      const int values[] = { X };
+      ctx->compute_lut_row_byte(miniLut, values, 2, 1);
       for (int j = 0; j < height; j++) {
         for (int i = 0; i < width; i++) {
           dstp[i] = miniLut[srcp[i]];
@@ -82,8 +82,8 @@ static void frame16_c(Word *dstp, ptrdiff_t dst_pitch, const Word *srcp, ptrdiff
     // realtime, miniLut: 173 fps
     Word miniLut[65536]; // full 16, anti overflow
     const int real_buf_size = (1 << bits_per_pixel);
-    for (int i = 0; i < real_buf_size; i++)
-      miniLut[i] = ctx->compute_word_xy<bits_per_pixel>(X, i);
+    const int values[] = { X };
+    ctx->compute_lut_row_word(miniLut, values, 2, 1, bits_per_pixel);
     for (int i = real_buf_size; i < 65536; i++)
       miniLut[i] = max_pixel_value;
 
@@ -132,10 +132,10 @@ static void frame32_c(Float *dstp, ptrdiff_t dst_pitch, const Float *srcp, ptrdi
   const Float X = processor.finalize();
 
   // always full realtime
+  std::vector<Float> constX(width, X);
   for (int j = 0; j < height; j++) {
-    for (int i = 0; i < width; i++) {
-      dstp[i] = ctx->compute_float_xy(X, srcp[i], chroma);
-    }
+    const Float *srcs[] = { constX.data(), srcp };
+    ctx->compute_row_float(dstp, srcs, 2, width, chroma);
     srcp += src_pitch;
     dstp += dst_pitch;
   }
@@ -5,6 +5,8 @@
 #include "../../../../common/parser/parser.h"
 
 #include "../functions.h"
+#include "../cache.h"
+#include "../parallel.h"
 
 namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Frame {
 
@@ -35,49 +37,34 @@ class Lutf : public MaskTools::Filter
 
   Lut luts[4+1]; // max plane count + 1
 
-  static Byte *calculateLut(const std::deque<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int& compute_error) {
-    Parser::Context ctx(expr, scale_inputs, clamp_float);
+  static Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error) {
     int pixelsize = bits_per_pixel == 8 ? 1 : 2; // byte / uint16_t
     size_t buffer_size = ((size_t)1 << bits_per_pixel) * ((size_t)1 << bits_per_pixel) *pixelsize;
     Byte *lut = new Byte[buffer_size];
 
-    switch (bits_per_pixel) {
-    case 8:
-      for (int x = 0; x < 256; x++)
-        for (int y = 0; y < 256; y++)
-          lut[(x << 8) + y] = ctx.compute_byte_xy(x, y);
-      break;
-    case 10:
-      for (int x = 0; x < 1024; x++)
-        for (int y = 0; y < 1024; y++)
-          reinterpret_cast<Word *>(lut)[(x << 10) + y] = ctx.compute_word_xy<10>(x, y);
-      break;
-    case 12:
-      for (int x = 0; x < 4096; x++)
-        for (int y = 0; y < 4096; y++)
-          reinterpret_cast<Word *>(lut)[(x << 12) + y] = ctx.compute_word_xy<12>(x, y);
-      break;
-    case 14:
-      for (int x = 0; x < 16384; x++)
-        for (int y = 0; y < 16384; y++)
-          reinterpret_cast<Word *>(lut)[(x << 14) + y] = ctx.compute_word_xy<14>(x, y);
-      break;
-    case 16:
-      // 64bit only
-      for (int x = 0; x < 65536; x++)
-        for (int y = 0; y < 65536; y++)
-          reinterpret_cast<Word *>(lut)[((size_t)x << 16) + y] = ctx.compute_word_xy<16>(x, y);
-      break;
-    }
-
+    const int size = 1 << bits_per_pixel;
+    // v2.2.31: rows are calculated by several threads
     // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
-    compute_error = ctx.get_compute_error();
+    compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, size, size, [&](Parser::Context &ctx, size_t row) {
+      const int x = (int)row;
+      if (bits_per_pixel == 8)
+        ctx.compute_lut_row_byte(lut + (x << 8), &x, 2, 1);
+      else // 16 bit: 64bit only
+        ctx.compute_lut_row_word(reinterpret_cast<Word *>(lut) + ((size_t)x << bits_per_pixel), &x, 2, 1, bits_per_pixel);
+    });
 
     return lut;
   }
 
+  // v2.2.31: tables are shared with the other filter instances (Lut::Cache), same layout as in mt_lutxy
+  Byte *acquireLut(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float, int& compute_error) {
+    return static_cast<Byte *>(Cache::acquire(Cache::key("xy", expr, bits_per_pixel, scale_inputs, clamp_float), ((size_t)1 << (2 * bits_per_pixel)) * (bits_per_pixel == 8 ? 1 : 2), [&](int &build_error) -> void * {
+      return calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float, flags, /*ref*/ build_error);
+    }, Cache::destroy_array<Byte>, compute_error));
+  }
+
   // for realtime
-  std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
+  Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
 
   ProcessorList<Processor> processors;
   ProcessorList<Processor16> processors16;
@@ -94,8 +81,9 @@ protected:
         UNUSED(n);
         
         if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
           if (bits_per_pixel == 8)
             processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
               frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
@@ -129,7 +117,7 @@ public:
    Lutf(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter( parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
    {
      for (int i = 0; i < 4; i++) {
-       parsed_expressions[i] = nullptr;
+       realtime_contexts[i] = nullptr;
      }
 
      for (int i = 0; i < 4+1; ++i) {
@@ -206,7 +194,7 @@ public:
           }
 
           if (realtime) {
-            parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
 
             continue;
           }
@@ -218,12 +206,12 @@ public:
           // save memory, reuse luts, like in xyz
           if (customExpressionDefined) {
             luts[i].used = true;
-            luts[i].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float, /*ref*/ compute_error);
+            luts[i].ptr = acquireLut(parser.getExpression(), clamp_float, /*ref*/ compute_error);
           }
           else {
             if (luts[4].ptr == nullptr) { // 0..3: planes, 4:last common
               luts[4].used = true;
-              luts[4].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float, /*ref*/ compute_error);
+              luts[4].ptr = acquireLut(parser.getExpression(), clamp_float, /*ref*/ compute_error);
             }
             luts[i].ptr = luts[4].ptr;
           }
@@ -276,11 +264,11 @@ public:
    {
      for (int i = 0; i < 4+1; ++i) {
        if (luts[i].used) {
-         delete[] luts[i].ptr;
+         Cache::release(luts[i].ptr);
        }
      }
      for (int i = 0; i < 4; i++) {
-       delete parsed_expressions[i];
+       delete realtime_contexts[i];
      }
    }
 
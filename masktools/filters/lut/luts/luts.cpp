@@ -2,15 +2,71 @@
 #include "../functions.h"
 
 using namespace Filtering;
+namespace Lazy = Filtering::MaskTools::Filters::Lut::Lazy;
+
+// realtime: neighbour row of coordinate (dx, dy) for row j, borders are clamped
+template<typename T>
+static void neighbour_row(T *pRow, const T *pSrc, ptrdiff_t nSrcPitch, int dx, int dy, int j, int nWidth, int nHeight)
+{
+   int y = dy + j;
+   if ( y < 0 ) y = 0;
+   if ( y >= nHeight ) y = nHeight - 1;
+   const T *pLine = pSrc + (y - j) * nSrcPitch;
+   for ( int i = 0; i < nWidth; i++ )
+   {
+      int x = dx + i;
+      if ( x < 0 ) x = 0;
+      if ( x >= nWidth ) x = nWidth - 1;
+      pRow[i] = pLine[x];
+   }
+}
+
+// v2.2.31: row buffers of the realtime evaluation, kept with the leased Context: reused by the next frames
+// and freed with the filter
+enum RowBuffer { NEIGHBOURS, RESULTS, WEIGHTS, X_ROW, Y_ROW, WEIGHT_ROW };
+
+template<typename T, RowBuffer id>
+static T *scratch_row(Parser::Context *ctx, size_t size)
+{
+   return static_cast<T *>(ctx->scratch(id, size * sizeof(T)));
+}
 
 //similar template to lutf
 template<bool realtime, class T>
-static void custom_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
+static void custom_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, Lazy::Table *lazy, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
 {
+   UNUSED(lazy);
    UNUSED(pLut_w);
    UNUSED(ctx_w);
 
    T new_value( mode );
+
+   if (realtime) {
+      // the expression is evaluated row by row for each coordinate, then aggregated
+      const int nPoints = nCoordinates / 2;
+      Byte *neighbours = scratch_row<Byte, NEIGHBOURS>(ctx, nWidth);
+      Byte *results = scratch_row<Byte, RESULTS>(ctx, nPoints * nWidth);
+      for ( int j = 0; j < nHeight; j++ )
+      {
+         for ( int k = 0; k < nPoints; k++ )
+         {
+            neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+            const Byte *srcs[] = { pDst, neighbours };
+            ctx->compute_row_byte(&results[k * nWidth], srcs, 2, nWidth);
+         }
+         for ( int i = 0; i < nWidth; i++ )
+         {
+            new_value.reset();
+            for ( int k = 0; k < nPoints; k++ )
+               new_value.add(results[k * nWidth + i]);
+            pDst[i] = new_value.finalize();
+         }
+         pSrc += nSrcPitch;
+         pDst += nDstPitch;
+      }
+      return;
+   }
+
    for ( int j = 0; j < nHeight; j++ )
    {
       for ( int i = 0; i < nWidth; i++ )
@@ -29,12 +85,7 @@ static void custom_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_
             int PixelX = pDst[i];
             int PixelY = pSrc[x + (y - j) * nSrcPitch];
 
-            if (realtime) {
-              new_value.add(ctx->compute_byte_xy(PixelX, PixelY));
-            }
-            else {
-              new_value.add(pLut[(PixelX << 8) + PixelY]);
-            }
+            new_value.add(pLut[(PixelX << 8) + PixelY]);
          }
          pDst[i] = new_value.finalize();
       }
@@ -44,9 +95,50 @@ static void custom_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_
 }
 
 template<bool realtime, class T>
-static void custom_weight_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
+static void custom_weight_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, Lazy::Table *lazy, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
 {
+  UNUSED(lazy);
   T new_value(mode);
+
+  if (realtime) {
+    // the expressions are evaluated row by row for each coordinate, then aggregated
+    const int nPoints = nCoordinates / 2;
+    Byte *neighbours = scratch_row<Byte, NEIGHBOURS>(ctx, nWidth);
+    double *x_row = scratch_row<double, X_ROW>(ctx, nWidth);
+    double *y_row = scratch_row<double, Y_ROW>(ctx, nWidth);
+    double *weight_row = scratch_row<double, WEIGHT_ROW>(ctx, nWidth);
+    Byte *results = scratch_row<Byte, RESULTS>(ctx, nPoints * nWidth);
+    float *weights = scratch_row<float, WEIGHTS>(ctx, nPoints * nWidth);
+    for (int j = 0; j < nHeight; j++)
+    {
+      for (int i = 0; i < nWidth; i++)
+        x_row[i] = pDst[i];
+      for (int k = 0; k < nPoints; k++)
+      {
+        neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+        const Byte *srcs[] = { pDst, neighbours };
+        ctx->compute_row_byte(&results[k * nWidth], srcs, 2, nWidth);
+        // yes, weights are float, keep precision and not convert back to int
+        for (int i = 0; i < nWidth; i++)
+          y_row[i] = neighbours[i];
+        const double *srcs_w[] = { x_row, y_row };
+        ctx_w->compute_row(weight_row, srcs_w, 2, nWidth, 8, false);
+        for (int i = 0; i < nWidth; i++)
+          weights[k * nWidth + i] = (float)weight_row[i];
+      }
+      for (int i = 0; i < nWidth; i++)
+      {
+        new_value.reset_w();
+        for (int k = 0; k < nPoints; k++)
+          new_value.add_w(results[k * nWidth + i], weights[k * nWidth + i]);
+        pDst[i] = new_value.finalize_w();
+      }
+      pSrc += nSrcPitch;
+      pDst += nDstPitch;
+    }
+    return;
+  }
+
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -66,15 +158,8 @@ static void custom_weight_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, p
         int PixelY = pSrc[x + (y - j) * nSrcPitch];
 
         // different from non-weight version
-        float weight;
-        if (realtime) {
-          weight = ctx_w->compute_float_xy_intinput<8>(PixelX, PixelY); // yes, weights are float, keep precision and not convert back to int
-          new_value.add_w(ctx->compute_byte_xy(PixelX, PixelY), weight);
-        }
-        else {
-          weight = pLut_w[(PixelX << 8) + PixelY]; // byte xy but float content!
-          new_value.add_w(pLut[(PixelX << 8) + PixelY], weight);
-        }
+        float weight = pLut_w[(PixelX << 8) + PixelY]; // byte xy but float content!
+        new_value.add_w(pLut[(PixelX << 8) + PixelY], weight);
       }
       pDst[i] = new_value.finalize_w(); // different from non-weight version
     }
@@ -84,7 +169,7 @@ static void custom_weight_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, p
 }
 
 template<bool realtime, int bits_per_pixel, class T>
-static void custom16_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
+static void custom16_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, Lazy::Table *lazy, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
 {
   UNUSED(pLut_w);
   UNUSED(ctx_w);
@@ -97,6 +182,36 @@ static void custom16_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrd
   nDstPitch /= sizeof(uint16_t);
   const int max_pixel_value = (1 << bits_per_pixel) - 1;
 
+  if (realtime) {
+    // the expression is evaluated row by row for each coordinate, then aggregated
+    // input is clamped below 16 bit
+    const int nPoints = nCoordinates / 2;
+    Word *neighbours = scratch_row<Word, NEIGHBOURS>(ctx, nWidth);
+    Word *results = scratch_row<Word, RESULTS>(ctx, nPoints * nWidth);
+    for (int j = 0; j < nHeight; j++)
+    {
+      for (int k = 0; k < nPoints; k++)
+      {
+        neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+        const Word *srcs[] = { pDst, neighbours };
+        if (lazy)
+          lazy->lookup_row(&results[k * nWidth], pDst, neighbours, nWidth, *ctx); // v2.2.31
+        else
+          ctx->compute_row_word(&results[k * nWidth], srcs, 2, nWidth, bits_per_pixel);
+      }
+      for (int i = 0; i < nWidth; i++)
+      {
+        new_value.reset();
+        for (int k = 0; k < nPoints; k++)
+          new_value.add(results[k * nWidth + i]);
+        pDst[i] = new_value.finalize(); // cannot overflow
+      }
+      pSrc += nSrcPitch;
+      pDst += nDstPitch;
+    }
+    return;
+  }
+
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -120,12 +235,7 @@ static void custom16_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrd
           PixelY = min(PixelY, max_pixel_value);
         }
 
-        if (realtime) {
-          new_value.add(ctx->compute_word_xy<bits_per_pixel>(PixelX, PixelY));
-        }
-        else {
-          new_value.add(reinterpret_cast<const uint16_t *>(pLut)[(PixelX << bits_per_pixel) + PixelY]);
-        }
+        new_value.add(reinterpret_cast<const uint16_t *>(pLut)[(PixelX << bits_per_pixel) + PixelY]);
       }
       pDst[i] = new_value.finalize(); // cannot overflow
     }
@@ -136,7 +246,7 @@ static void custom16_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrd
 
 //similar template to lutf
 template<bool realtime, int bits_per_pixel, class T>
-static void custom16_weight_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
+static void custom16_weight_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrdiff_t nSrcPitch, const Byte *pLut, const Float *pLut_w, Parser::Context *ctx, Parser::Context *ctx_w, Lazy::Table *lazy, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode)
 {
   T new_value(mode);
 
@@ -146,6 +256,52 @@ static void custom16_weight_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc
   nDstPitch /= sizeof(uint16_t);
   const int max_pixel_value = (1 << bits_per_pixel) - 1;
 
+  if (realtime) {
+    // the expressions are evaluated row by row for each coordinate, then aggregated
+    // input is clamped below 16 bit
+    const int nPoints = nCoordinates / 2;
+    Word *neighbours = scratch_row<Word, NEIGHBOURS>(ctx, nWidth);
+    double *x_row = scratch_row<double, X_ROW>(ctx, nWidth);
+    double *y_row = scratch_row<double, Y_ROW>(ctx, nWidth);
+    double *weight_row = scratch_row<double, WEIGHT_ROW>(ctx, nWidth);
+    Word *results = scratch_row<Word, RESULTS>(ctx, nPoints * nWidth);
+    float *weights = scratch_row<float, WEIGHTS>(ctx, nPoints * nWidth);
+    for (int j = 0; j < nHeight; j++)
+    {
+      for (int i = 0; i < nWidth; i++)
+        x_row[i] = bits_per_pixel < 16 ? min((int)pDst[i], max_pixel_value) : pDst[i];
+      for (int k = 0; k < nPoints; k++)
+      {
+        neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+        const Word *srcs[] = { pDst, neighbours };
+        if (lazy)
+          lazy->lookup_row(&results[k * nWidth], pDst, neighbours, nWidth, *ctx); // v2.2.31
+        else
+          ctx->compute_row_word(&results[k * nWidth], srcs, 2, nWidth, bits_per_pixel);
+        // keep precision and not convert back to int
+        for (int i = 0; i < nWidth; i++)
+          y_row[i] = bits_per_pixel < 16 ? min((int)neighbours[i], max_pixel_value) : neighbours[i];
+        const double *srcs_w[] = { x_row, y_row };
+        ctx_w->compute_row(weight_row, srcs_w, 2, nWidth, bits_per_pixel, false);
+        for (int i = 0; i < nWidth; i++)
+          weights[k * nWidth + i] = (float)weight_row[i];
+      }
+      for (int i = 0; i < nWidth; i++)
+      {
+        new_value.reset_w();
+        for (int k = 0; k < nPoints; k++)
+          new_value.add_w(results[k * nWidth + i], weights[k * nWidth + i]);
+        if (bits_per_pixel == 16)
+          pDst[i] = new_value.finalize_w();
+        else
+          pDst[i] = min(new_value.finalize_w(), (Word)max_pixel_value);
+      }
+      pSrc += nSrcPitch;
+      pDst += nDstPitch;
+    }
+    return;
+  }
+
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -170,20 +326,8 @@ static void custom16_weight_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc
         }
 
         // different from non-weight version
-        float weight;
-        if (realtime) {
-          weight = ctx_w->compute_float_xy_intinput<bits_per_pixel>(PixelX, PixelY); // keep precision and not convert back to int
-        }
-        else {
-          weight = pLut_w[(PixelX << bits_per_pixel) + PixelY]; // byte xy but float content!
-        }
-
-        if (realtime) {
-          new_value.add_w(ctx->compute_word_xy<bits_per_pixel>(PixelX, PixelY), weight);
-        }
-        else {
-          new_value.add_w(reinterpret_cast<const uint16_t *>(pLut)[(PixelX << bits_per_pixel) + PixelY], weight);
-        }
+        float weight = pLut_w[(PixelX << bits_per_pixel) + PixelY]; // byte xy but float content!
+        new_value.add_w(reinterpret_cast<const uint16_t *>(pLut)[(PixelX << bits_per_pixel) + PixelY], weight);
       }
       if(bits_per_pixel == 16)
         pDst[i] = new_value.finalize_w();  // different from non-weight version
@@ -212,27 +356,24 @@ static void custom32_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc8, ptrd
   nSrcPitch /= sizeof(float);
   nDstPitch /= sizeof(float);
 
+  // float is always realtime
+  // the expression is evaluated row by row for each coordinate, then aggregated
+  const int nPoints = nCoordinates / 2;
+  float *neighbours = scratch_row<float, NEIGHBOURS>(ctx, nWidth);
+  float *results = scratch_row<float, RESULTS>(ctx, nPoints * nWidth);
   for (int j = 0; j < nHeight; j++)
   {
+    for (int k = 0; k < nPoints; k++)
+    {
+      neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+      const Float *srcs[] = { pDst, neighbours };
+      ctx->compute_row_float(&results[k * nWidth], srcs, 2, nWidth, chroma);
+    }
     for (int i = 0; i < nWidth; i++)
     {
       new_value.reset();
-      for (int k = 0; k < nCoordinates; k += 2)
-      {
-        int x = pCoordinates[k] + i;
-        int y = pCoordinates[k + 1] + j;
-
-        if (x < 0) x = 0;
-        if (x >= nWidth) x = nWidth - 1;
-        if (y < 0) y = 0;
-        if (y >= nHeight) y = nHeight - 1;
-
-        float PixelX = pDst[i];
-        float PixelY = pSrc[x + (y - j) * nSrcPitch];
-
-        // float is always realtime
-        new_value.add(ctx->compute_float_xy(PixelX, PixelY, chroma));
-      }
+      for (int k = 0; k < nPoints; k++)
+        new_value.add(results[k * nWidth + i]);
       pDst[i] = new_value.finalize();
     }
     pSrc += nSrcPitch;
@@ -254,30 +395,26 @@ static void custom32_weight_c(Byte *pDst8, ptrdiff_t nDstPitch, const Byte *pSrc
   nSrcPitch /= sizeof(float);
   nDstPitch /= sizeof(float);
 
+  // float is always realtime
+  // the expressions are evaluated row by row for each coordinate, then aggregated
+  const int nPoints = nCoordinates / 2;
+  float *neighbours = scratch_row<float, NEIGHBOURS>(ctx, nWidth);
+  float *results = scratch_row<float, RESULTS>(ctx, nPoints * nWidth);
+  float *weights = scratch_row<float, WEIGHTS>(ctx, nPoints * nWidth);
   for (int j = 0; j < nHeight; j++)
   {
+    for (int k = 0; k < nPoints; k++)
+    {
+      neighbour_row(neighbours, pSrc, nSrcPitch, pCoordinates[2 * k], pCoordinates[2 * k + 1], j, nWidth, nHeight);
+      const Float *srcs[] = { pDst, neighbours };
+      ctx_w->compute_row_float(&weights[k * nWidth], srcs, 2, nWidth, chroma);
+      ctx->compute_row_float(&results[k * nWidth], srcs, 2, nWidth, chroma);
+    }
     for (int i = 0; i < nWidth; i++)
     {
       new_value.reset_w(); // different from non-weight version
-      for (int k = 0; k < nCoordinates; k += 2)
-      {
-        int x = pCoordinates[k] + i;
-        int y = pCoordinates[k + 1] + j;
-
-        if (x < 0) x = 0;
-        if (x >= nWidth) x = nWidth - 1;
-        if (y < 0) y = 0;
-        if (y >= nHeight) y = nHeight - 1;
-
-        float PixelX = pDst[i];
-        float PixelY = pSrc[x + (y - j) * nSrcPitch];
-
-        // different from non-weight version
-        float weight = ctx_w->compute_float_xy(PixelX, PixelY, chroma);
-
-        // float is always realtime
-        new_value.add_w(ctx->compute_float_xy(PixelX, PixelY, chroma), weight);
-      }
+      for (int k = 0; k < nPoints; k++)
+        new_value.add_w(results[k * nWidth + i], weights[k * nWidth + i]);
       pDst[i] = new_value.finalize_w(); // different from non-weight version
     }
     pSrc += nSrcPitch;
@@ -5,10 +5,13 @@
 #include "../../../../common/parser/parser.h"
 
 #include "../functions.h"
+#include "../cache.h"
+#include "../parallel.h"
+#include "../lazy.h"
 
 namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Spatial {
 
-typedef void(Processor)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte lut[65536], const Float lut_w[65536], Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode);
+typedef void(Processor)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte lut[65536], const Float lut_w[65536], Parser::Context *ctx, Parser::Context *ctx_w, Lazy::Table *lazy, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode);
 typedef void(Processor32)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte lut[65536], const Float lut_w[65536], Parser::Context *ctx, Parser::Context *ctx_w, const int *pCoordinates, int nCoordinates, int nWidth, int nHeight, const String &mode, bool chroma);
 
 // lut 8-16
@@ -49,8 +52,8 @@ class Luts : public MaskTools::Filter
    ProcessorList<Processor32> processors32_weight;
 
    // for realtime
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions_w[4];
+   Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
+   Parser::ContextPool *realtime_contexts_w[4]; // weight expressions
 
    int bits_per_pixel;
    bool realtime;
@@ -63,6 +66,7 @@ class Luts : public MaskTools::Filter
    struct Lut {
      bool used;
      Byte *ptr;
+     Lazy::Table *lazy; // v2.2.31: filled on use (Lazy) instead of realtime, 14-16 bits
    };
 
    Lut luts[4+1];
@@ -74,60 +78,76 @@ class Luts : public MaskTools::Filter
 
    Lut_w luts_weight[4+1]; // max planes + 1
 
-   static Byte *calculateLut(const std::deque<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float) {
-     Parser::Context ctx(expr, scale_inputs, clamp_float);
+   static Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error) {
      int pixelsize = bits_per_pixel == 8 ? 1 : 2; // byte / uint16_t
      size_t buffer_size = ((size_t)1 << bits_per_pixel) * ((size_t)1 << bits_per_pixel) *pixelsize;
      Byte *lut = new Byte[buffer_size];
 
      const int size = 1 << bits_per_pixel;
+     // v2.2.31: rows are calculated by several threads
+     // reported for the other users of the shared table, mt_luts does not check it
+     compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, size, size, [&](Parser::Context &ctx, size_t row) {
+       const int x = (int)row;
+       if (bits_per_pixel == 8)
+         ctx.compute_lut_row_byte(lut + (x << 8), &x, 2, 1);
+       else // 16 bit: 64bit only
+         ctx.compute_lut_row_word(reinterpret_cast<Word *>(lut) + ((size_t)x << bits_per_pixel), &x, 2, 1, bits_per_pixel);
+     });
 
-     switch (bits_per_pixel) {
-     case 8:
-       for (int x = 0; x < 256; x++)
-         for (int y = 0; y < 256; y++)
-           lut[(x << 8) + y] = ctx.compute_byte_xy(x, y);
-       break;
-     case 10:
-       for (int x = 0; x < size; x++)
-         for (int y = 0; y < size; y++)
-           reinterpret_cast<Word *>(lut)[(x << 10) + y] = ctx.compute_word_xy<10>(x, y);
-       break;
-     case 12:
-       for (int x = 0; x < size; x++)
-         for (int y = 0; y < size; y++)
-           reinterpret_cast<Word *>(lut)[(x << 12) + y] = ctx.compute_word_xy<12>(x, y);
-       break;
-     case 14:
-       for (int x = 0; x < size; x++)
-         for (int y = 0; y < size; y++)
-           reinterpret_cast<Word *>(lut)[(x << 14) + y] = ctx.compute_word_xy<14>(x, y);
-       break;
-     case 16:
-       // 64bit only
-       for (int x = 0; x < 65536; x++)
-         for (int y = 0; y < 65536; y++)
-           reinterpret_cast<Word *>(lut)[((size_t)x << 16) + y] = ctx.compute_word_xy<16>(x, y);
-       break;
-     }
      return lut;
    }
 
    // weight luts: float content
    template<int bits_per_pixel>
-   static Float *calculateLut_w(const std::deque<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float) {
-     Parser::Context ctx(expr, scale_inputs, clamp_float);
+   static Float *calculateLut_w(const std::vector<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float, int cpu_flags) {
      const int size = 1 << bits_per_pixel;
 
      size_t buffer_size = ((size_t)size) * ((size_t)size);
      Float *lut = new Float[buffer_size];
 
-     for (int x = 0; x < size; x++)
+     // see compute_float_xy_intinput
+     // v2.2.31: rows are calculated by several threads
+     Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, size, size, [&](Parser::Context &ctx, size_t x) {
+       std::vector<double> row(size);
+       const int values[] = { (int)x };
+       ctx.compute_lut_row(row.data(), values, 2, 1, bits_per_pixel);
        for (int y = 0; y < size; y++)
-         lut[(x << bits_per_pixel) + y] = ctx.compute_float_xy_intinput<bits_per_pixel>(x, y);
+         lut[(x << bits_per_pixel) + y] = (float)row[y];
+     });
      return lut;
    }
 
+   // v2.2.31: tables are shared with the other filter instances (Lut::Cache), same layout as in mt_lutxy
+   Byte *acquireLut(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float) {
+     int compute_error;
+     return static_cast<Byte *>(Cache::acquire(Cache::key("xy", expr, bits_per_pixel, scale_inputs, clamp_float), ((size_t)1 << (2 * bits_per_pixel)) * (bits_per_pixel == 8 ? 1 : 2), [&](int &build_error) -> void * {
+       return calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float, flags, /*ref*/ build_error);
+     }, Cache::destroy_array<Byte>, compute_error));
+   }
+
+   Lazy::Table *acquireLazy(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float) {
+     int unused;
+     return static_cast<Lazy::Table *>(Cache::acquire(Cache::key("lazy xy", expr, bits_per_pixel, scale_inputs, clamp_float), 0, [&](int &) -> void * {
+       return new Lazy::Table(bits_per_pixel);
+     }, Cache::destroy_object<Lazy::Table>, unused));
+   }
+
+   Float *acquireLut_w(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float) {
+     int compute_error;
+     return static_cast<Float *>(Cache::acquire(Cache::key("float xy", expr, bits_per_pixel, scale_inputs, clamp_float), ((size_t)1 << (2 * bits_per_pixel)) * sizeof(Float), [&](int &) -> void * {
+       switch (bits_per_pixel) {
+       case 8: return calculateLut_w<8>(expr, scale_inputs, clamp_float, flags);
+       case 10: return calculateLut_w<10>(expr, scale_inputs, clamp_float, flags);
+       case 12: return calculateLut_w<12>(expr, scale_inputs, clamp_float, flags);
+       case 14: return calculateLut_w<14>(expr, scale_inputs, clamp_float, flags);
+#if defined(_M_X64) || defined(__amd64__)
+       case 16: return calculateLut_w<16>(expr, scale_inputs, clamp_float, flags);
+#endif
+       }
+       return nullptr;
+     }, Cache::destroy_array<Float>, compute_error));
+   }
+
 
    void FillCoordinates(const String &coordinates)
    {
@@ -136,11 +156,8 @@ class Luts : public MaskTools::Filter
       pCoordinates = new int[nCoordinates];
       int i = 0;
 
-      while ( !coeffs.empty() )
-      {
-         pCoordinates[i++] = int( coeffs.front().getValue(0, 0, 0) );
-         coeffs.pop_front();
-      }
+      for (auto &coeff : coeffs)
+         pCoordinates[i++] = int( coeff.getValue(0, 0, 0) );
    }
 
 protected:
@@ -148,14 +165,15 @@ protected:
     {
         UNUSED(n);
         if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
-          if (!parsed_expressions_w[nPlane]) {
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
+          if (!realtime_contexts_w[nPlane]) {
             // no weights
             if (bits_per_pixel <= 16) {
               processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
                 frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
-                nullptr, nullptr, &ctx, nullptr, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
+                nullptr, nullptr, &ctx, nullptr, luts[nPlane].lazy, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
             }
             else {
               const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
@@ -165,11 +183,12 @@ protected:
             }
           }
           else {
-            Parser::Context ctx_w(*parsed_expressions_w[nPlane]);
+            Parser::ContextPool::Lease lease_w(*realtime_contexts_w[nPlane]);
+            Parser::Context &ctx_w = lease_w.context();
             if (bits_per_pixel <= 16) {
               processors_weight.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
                 frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
-                nullptr, nullptr, &ctx, &ctx_w, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
+                nullptr, nullptr, &ctx, &ctx_w, luts[nPlane].lazy, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
             }
             else {
               const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
@@ -184,12 +203,12 @@ protected:
             // no weights
             processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
               frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
-              luts[nPlane].ptr, nullptr, nullptr, nullptr, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
+              luts[nPlane].ptr, nullptr, nullptr, nullptr, nullptr, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
           }
           else {
             processors_weight.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
               frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
-              luts[nPlane].ptr, luts_weight[nPlane].ptr, nullptr, nullptr, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
+              luts[nPlane].ptr, luts_weight[nPlane].ptr, nullptr, nullptr, nullptr, pCoordinates, nCoordinates, dst.width(), dst.height(), mode);
           }
         }
     }
@@ -198,13 +217,14 @@ public:
    Luts(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter(parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
    {
      for (int i = 0; i < 4; i++) {
-       parsed_expressions[i] = nullptr;
-       parsed_expressions_w[i] = nullptr;
+       realtime_contexts[i] = nullptr;
+       realtime_contexts_w[i] = nullptr;
      }
 
      for (int i = 0; i < 4+1; ++i) {
        luts[i].used = false;
        luts[i].ptr = nullptr;
+       luts[i].lazy = nullptr;
        luts_weight[i].used = false;
        luts_weight[i].ptr = nullptr;
      }
@@ -216,6 +236,8 @@ public:
 
      bits_per_pixel = bit_depths[C];
      realtime = parameters["realtime"].toBool();
+     const bool realtime_requested = realtime;
+     const bool lazy = parameters["lazy"].toBool(); // v2.2.31: lazily filled table instead of realtime, 14-16 bits
      scale_inputs = parameters["scale_inputs"].toString();
      if (!checkValidScaleInputs(scale_inputs, error))
        return; // error message filled
@@ -284,7 +306,16 @@ public:
 
        // store expression on compute lut
        if (realtime) {
-         parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+         realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+         // v2.2.31: lazy=true: the default realtime mode of 14 and 16 bits remembers the evaluated pairs
+         if (lazy && (bits_per_pixel == 14 || bits_per_pixel == 16) && !realtime_requested) {
+           Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+           if (lut.lazy == nullptr) {
+             lut.used = true;
+             lut.lazy = acquireLazy(parser.getExpression(), clamp_float_i);
+           }
+           luts[i].lazy = lut.lazy;
+         }
          // fallthough to optimal weigth mode
        }
        else {
@@ -292,12 +323,12 @@ public:
          // save memory, reuse luts, like in xyz
          if (customExpressionDefined) {
            luts[i].used = true;
-           luts[i].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float);
+           luts[i].ptr = acquireLut(parser.getExpression(), clamp_float);
          }
          else {
            if (luts[4].ptr == nullptr) { // 0..3 planes, 4:extra
              luts[4].used = true;
-             luts[4].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float);
+             luts[4].ptr = acquireLut(parser.getExpression(), clamp_float);
            }
            luts[i].ptr = luts[4].ptr;
          }
@@ -335,7 +366,7 @@ public:
 
        // store expression on compute lut
        if (realtime) {
-         parsed_expressions_w[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+         realtime_contexts_w[i] = new Parser::ContextPool(parser.getExpression(), flags);
          continue;
        }
        else {
@@ -343,28 +374,12 @@ public:
          // save memory, reuse luts, like in xyz
          if (customExpressionDefined_w) {
            luts_weight[i].used = true;
-           switch (bits_per_pixel) {
-           case 8: luts_weight[i].ptr = calculateLut_w<8>(parser.getExpression(), scale_inputs, clamp_float); break;
-           case 10: luts_weight[i].ptr = calculateLut_w<10>(parser.getExpression(), scale_inputs, clamp_float); break;
-           case 12: luts_weight[i].ptr = calculateLut_w<12>(parser.getExpression(), scale_inputs, clamp_float); break;
-           case 14: luts_weight[i].ptr = calculateLut_w<14>(parser.getExpression(), scale_inputs, clamp_float); break;
-#if defined(_M_X64) || defined(__amd64__)
-           case 16: luts_weight[i].ptr = calculateLut_w<16>(parser.getExpression(), scale_inputs, clamp_float); break;
-#endif
-           }
+           luts_weight[i].ptr = acquireLut_w(parser.getExpression(), clamp_float);
          }
          else {
            if (luts_weight[4].ptr == nullptr) {
              luts_weight[4].used = true;
-             switch (bits_per_pixel) {
-             case 8: luts_weight[4].ptr = calculateLut_w<8>(parser.getExpression(), scale_inputs, clamp_float); break;
-             case 10: luts_weight[4].ptr = calculateLut_w<10>(parser.getExpression(), scale_inputs, clamp_float); break;
-             case 12: luts_weight[4].ptr = calculateLut_w<12>(parser.getExpression(), scale_inputs, clamp_float); break;
-             case 14: luts_weight[4].ptr = calculateLut_w<14>(parser.getExpression(), scale_inputs, clamp_float); break;
-#if defined(_M_X64) || defined(__amd64__)
-             case 16: luts_weight[4].ptr = calculateLut_w<16>(parser.getExpression(), scale_inputs, clamp_float); break;
-#endif
-             }
+             luts_weight[4].ptr = acquireLut_w(parser.getExpression(), clamp_float);
            }
            luts_weight[i].ptr = luts_weight[4].ptr;
          }
@@ -424,15 +439,16 @@ public:
      
      for (int i = 0; i < 4+1; ++i) {
        if (luts[i].used) {
-         delete[] luts[i].ptr;
+         Cache::release(luts[i].ptr);
+         Cache::release(luts[i].lazy);
        }
        if (luts_weight[i].used) {
-         delete[] luts_weight[i].ptr;
+         Cache::release(luts_weight[i].ptr);
        }
      }
      for (int i = 0; i < 4; i++) {
-       delete parsed_expressions[i];
-       delete parsed_expressions_w[i];
+       delete realtime_contexts[i];
+       delete realtime_contexts_w[i];
      }
    }
 
@@ -463,6 +479,7 @@ public:
       signature.add(Parameter(String("none"), "scale_inputs", false));
       signature.add(Parameter(false, "clamp_float", false));
       signature.add(Parameter(false, "clamp_float_UV", false));
+      signature.add(Parameter(false, "lazy", false));
       return signature;
    }
 };
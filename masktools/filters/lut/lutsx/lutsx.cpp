@@ -40,6 +40,8 @@ static void custom_realtime_8_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSr
 {
   T new_value1(mode1);
   U new_value2(mode2);
+  // aggregates of the row, then the expression on the whole row
+  std::vector<Byte> values1(nWidth), values2(nWidth);
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -59,8 +61,11 @@ static void custom_realtime_8_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSr
         new_value1.add(pSrc1[x + (y - j) * nSrc1Pitch]);
         new_value2.add(pSrc2[x + (y - j) * nSrc2Pitch]);
       }
-      pDst[i] = ctx->compute_byte_xyz(pDst[i], new_value1.finalize(), new_value2.finalize());
+      values1[i] = new_value1.finalize();
+      values2[i] = new_value2.finalize();
     }
+    const Byte *srcs[] = { pDst, values1.data(), values2.data() };
+    ctx->compute_row_byte(pDst, srcs, 3, nWidth);
     pSrc1 += nSrc1Pitch;
     pSrc2 += nSrc2Pitch;
     pDst += nDstPitch;
@@ -79,6 +84,8 @@ static void custom_realtime_uint16_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte
   nSrc1Pitch /= sizeof(uint16_t);
   nSrc2Pitch /= sizeof(uint16_t);
   nDstPitch /= sizeof(uint16_t);
+  // aggregates of the row, then the expression on the whole row
+  std::vector<Word> values1(nWidth), values2(nWidth);
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -98,8 +105,11 @@ static void custom_realtime_uint16_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte
         new_value1.add(pSrc1_16[x + (y - j) * nSrc1Pitch]);
         new_value2.add(pSrc2_16[x + (y - j) * nSrc2Pitch]);
       }
-      pDst_16[i] = ctx->compute_word_xyz<bits_per_pixel>(pDst_16[i], new_value1.finalize(), new_value2.finalize());
+      values1[i] = new_value1.finalize();
+      values2[i] = new_value2.finalize();
     }
+    const Word *srcs[] = { pDst_16, values1.data(), values2.data() };
+    ctx->compute_row_word(pDst_16, srcs, 3, nWidth, bits_per_pixel);
     pSrc1_16 += nSrc1Pitch;
     pSrc2_16 += nSrc2Pitch;
     pDst_16 += nDstPitch;
@@ -118,6 +128,8 @@ static void custom_realtime_32_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pS
   nSrc1Pitch /= sizeof(float);
   nSrc2Pitch /= sizeof(float);  
   nDstPitch /= sizeof(float);
+  // aggregates of the row, then the expression on the whole row
+  std::vector<float> values1(nWidth), values2(nWidth);
   for (int j = 0; j < nHeight; j++)
   {
     for (int i = 0; i < nWidth; i++)
@@ -137,8 +149,11 @@ static void custom_realtime_32_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pS
         new_value1.add(pSrc1_32[x + (y - j) * nSrc1Pitch]);
         new_value2.add(pSrc2_32[x + (y - j) * nSrc2Pitch]);
       }
-      pDst_32[i] = (float)ctx->compute_float_xyz(pDst_32[i], new_value1.finalize(), new_value2.finalize(), chroma);
+      values1[i] = new_value1.finalize();
+      values2[i] = new_value2.finalize();
     }
+    const Float *srcs[] = { pDst_32, values1.data(), values2.data() };
+    ctx->compute_row_float(pDst_32, srcs, 3, nWidth, chroma);
     pSrc1_32 += nSrc1Pitch;
     pSrc2_32 += nSrc2Pitch;
     pDst_32 += nDstPitch;
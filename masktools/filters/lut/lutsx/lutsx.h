@@ -5,6 +5,9 @@
 #include "../../../../common/parser/parser.h"
 
 #include "../functions.h"
+#include "../cache.h"
+#include "../async.h"
+#include "../parallel.h"
 
 namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace SpatialExtended {
 
@@ -23,6 +26,7 @@ extern ProcessorCtx32 *processors_realtime_32_array[NUM_MODES][NUM_MODES];
 class Lutsx : public MaskTools::Filter
 {
    std::pair<bool, Byte*> luts[4+1];
+   Async::Table *async_luts[4+1]; // v2.2.31: built in the background (async=true), luts[i].second is set when it is released
 
    int *pCoordinates;
    int nCoordinates;
@@ -32,8 +36,15 @@ class Lutsx : public MaskTools::Filter
    ProcessorList<ProcessorCtx> processorsCtx;
    ProcessorList<ProcessorCtx32> processorsCtx32;
 
+   // v2.2.31: tables are shared with the other filter instances (Lut::Cache)
+   Byte *acquireLut(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float, int& compute_error) {
+     return static_cast<Byte *>(Cache::acquire(Cache::key("zxy", expr, 8, scale_inputs, clamp_float), 256 * 256 * 256, [&](int &build_error) -> void * {
+       return calculateLut(expr, scale_inputs, clamp_float, flags, /*ref*/ build_error);
+     }, Cache::destroy_array<Byte>, compute_error));
+   }
+
    // for realtime
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
+   Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
 
    int bits_per_pixel;
    bool realtime;
@@ -49,27 +60,19 @@ class Lutsx : public MaskTools::Filter
       pCoordinates = new int[nCoordinates];
       int i = 0;
 
-      while ( !coeffs.empty() )
-      {
-         pCoordinates[i++] = int( coeffs.front().getValue(0, 0, 0) );
-         coeffs.pop_front();
-      }
+      for (auto &coeff : coeffs)
+         pCoordinates[i++] = int( coeff.getValue(0, 0, 0) );
    }
 
-   static Byte *calculateLut(const std::deque<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float, int& compute_error) {
-       Parser::Context ctx(expr, scale_inputs, clamp_float);
+   static Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error) {
        Byte *lut = new Byte[256 * 256 * 256];
 
-       for ( int x = 0; x < 256; x++ ) {
-           for ( int y = 0; y < 256; y++ ) {
-               for ( int z = 0; z < 256; z++ ) {
-                   lut[(z<<16)+(x<<8)+y] = ctx.compute_byte_xyz(x, y, z);  // ZXY order!
-               }
-           }
-       }
-
+       // v2.2.31: rows are calculated by several threads
        // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
-       compute_error = ctx.get_compute_error();
+       compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, 256 * 256, 256, [&](Parser::Context &ctx, size_t row) {
+           const int values[] = { (int)(row & 255), 0, (int)(row >> 8) }; // x, -, z
+           ctx.compute_lut_row_byte(lut + (row << 8), values, 3, 1);  // ZXY order!
+       });
 
        return lut;
    }
@@ -78,9 +81,12 @@ protected:
     virtual void process(int n, const Plane<Byte> &dst, int nPlane, const Filtering::Frame<const Byte> frames[4], const Constraint constraints[4]) override
     {
         UNUSED(n);
-        if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
+        // v2.2.31: async=true: realtime evaluation until the table is built
+        const Byte *lut = async_luts[nPlane] ? static_cast<const Byte *>(async_luts[nPlane]->get()) : luts[nPlane].second;
+        if (realtime || !lut) {
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
 
           if (bits_per_pixel <= 16) {
             processorsCtx.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
@@ -100,7 +106,7 @@ protected:
           processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
             frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
             frames[1].plane(nPlane).data(), frames[1].plane(nPlane).pitch(),
-            luts[nPlane].second, pCoordinates, nCoordinates, dst.width(), dst.height(), mode1, mode2);
+            lut, pCoordinates, nCoordinates, dst.width(), dst.height(), mode1, mode2);
         }
     }
 
@@ -108,7 +114,7 @@ public:
    Lutsx(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter( parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
    {
      for (int i = 0; i < 4; i++) {
-       parsed_expressions[i] = nullptr;
+       realtime_contexts[i] = nullptr;
      }
 
      bits_per_pixel = bit_depths[C];
@@ -123,11 +129,14 @@ public:
      if (bits_per_pixel > 8)
        realtime = true;
 
+     const bool async = parameters["async"].toBool() && !realtime; // v2.2.31
+
       static const char *expr_strs[] = { "yExpr", "uExpr", "vExpr", "aExpr" };
 
       for (int i = 0; i < 4+1; ++i) {
           luts[i].first = false;
           luts[i].second = nullptr;
+          async_luts[i] = nullptr;
       }
 
       Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y).addSymbol(Parser::Symbol::Z);
@@ -168,20 +177,35 @@ public:
           }
 
           if (realtime) {
-            parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
             continue;
           }
 
           int compute_error = Parser::Context::compute_error_t::CE_NONE;
 
-          if (customExpressionDefined) {
+          // v2.2.31: async=true: a worker thread builds the table, realtime evaluation meanwhile
+          if (async) {
+            compute_error = Async::compute_error(ctx, 3, 8);
+            const int k = customExpressionDefined ? i : 4;
+            if (async_luts[k] == nullptr && compute_error == Parser::Context::compute_error_t::CE_NONE) {
+              const std::vector<Parser::Symbol> expr = parser.getExpression();
+              luts[k].first = true;
+              async_luts[k] = new Async::Table([this, expr, clamp_float]() -> void * {
+                int unused; // reported above
+                return acquireLut(expr, clamp_float, unused);
+              });
+            }
+            async_luts[i] = async_luts[k];
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+          }
+          else if (customExpressionDefined) {
               luts[i].first = true;
-              luts[i].second = calculateLut(parser.getExpression(), scale_inputs, clamp_float, /*ref*/ compute_error);
+              luts[i].second = acquireLut(parser.getExpression(), clamp_float, /*ref*/ compute_error);
           }
           else {
               if (luts[4].second == nullptr) {
                   luts[4].first = true;
-                  luts[4].second = calculateLut(parser.getExpression(), scale_inputs, clamp_float, /*ref*/ compute_error);
+                  luts[4].second = acquireLut(parser.getExpression(), clamp_float, /*ref*/ compute_error);
               }
               luts[i].second = luts[4].second;
           }
@@ -198,7 +222,7 @@ public:
       /* choose the mode */
       mode1 = parameters["mode"].toString();
       mode2 = parameters["mode2"].toString();
-      if (realtime) {
+      if (realtime || async) {
         switch (bits_per_pixel) {
         case 8: processorsCtx.push_back(processors_realtime_8_array[ModeToInt(mode1)][ModeToInt(mode2)]); break;
         case 10: processorsCtx.push_back(processors_realtime_10_array[ModeToInt(mode1)][ModeToInt(mode2)]); break;
@@ -208,7 +232,7 @@ public:
         case 32: processorsCtx32.push_back(processors_realtime_32_array[ModeToInt(mode1)][ModeToInt(mode2)]); break;
         }
       }
-      else {
+      if (!realtime) {
         processors.push_back(processors_array[ModeToInt(mode1)][ModeToInt(mode2)]);
       }
    }
@@ -217,11 +241,15 @@ public:
    {
        for (int i = 0; i < 4+1; ++i) {
            if (luts[i].first) {
-               delete[] luts[i].second;
+               if (async_luts[i]) {
+                 luts[i].second = static_cast<Byte *>(async_luts[i]->wait());
+                 delete async_luts[i];
+               }
+               Cache::release(luts[i].second);
            }
        }
        for (int i = 0; i < 4; i++) {
-         delete parsed_expressions[i];
+         delete realtime_contexts[i];
        }
    }
 
@@ -249,6 +277,7 @@ public:
       signature.add(Parameter(String("none"), "scale_inputs", false));
       signature.add(Parameter(false, "clamp_float", false));
       signature.add(Parameter(false, "clamp_float_UV", false));
+      signature.add(Parameter(false, "async", false));
       return signature;
    }
 };
@@ -38,9 +38,8 @@ void Filtering::MaskTools::Filters::Lut::Dual::realtime8_c(Byte *dstp, ptrdiff_t
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      dstp[x] = ctx.compute_byte_xy(dstp[x], srcp[x]);
-    }
+    const Byte *srcs[] = { dstp, srcp };
+    ctx.compute_row_byte(dstp, srcs, 2, width);
     dstp += dst_pitch;
     srcp += nSrcPitch;
   }
@@ -49,19 +48,21 @@ void Filtering::MaskTools::Filters::Lut::Dual::realtime8_c(Byte *dstp, ptrdiff_t
 template<int bits_per_pixel>
 static void realtime16_t_c(Byte *dstp, ptrdiff_t dst_pitch, const Byte *srcp, ptrdiff_t nSrcPitch, int width, int height, Parser::Context &ctx)
 {
-  const Word max_pixel_value = (1 << bits_per_pixel) - 1;
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      Word pixelX = reinterpret_cast<uint16_t *>(dstp)[x];
-      if (bits_per_pixel != 16) pixelX = min(pixelX, max_pixel_value); // clamp input below 16 bit
-      Word pixelY = reinterpret_cast<const uint16_t *>(srcp)[x];
-      if (bits_per_pixel != 16) pixelY = min(pixelY, max_pixel_value); // clamp input below 16 bit
-
-      Word result = ctx.compute_word_xy<bits_per_pixel>(pixelX, pixelY);
+    // input is clamped below 16 bit
+    const Word *srcs[] = { reinterpret_cast<Word *>(dstp), reinterpret_cast<const Word *>(srcp) };
+    ctx.compute_row_word(reinterpret_cast<Word *>(dstp), srcs, 2, width, bits_per_pixel);
+    dstp += dst_pitch;
+    srcp += nSrcPitch;
+  }
+}
 
-      reinterpret_cast<uint16_t *>(dstp)[x] = result;
-    }
+void Filtering::MaskTools::Filters::Lut::Dual::lazy_c(Byte *dstp, ptrdiff_t dst_pitch, const Byte *srcp, ptrdiff_t nSrcPitch, int width, int height, Lazy::Table &table, Parser::Context &ctx)
+{
+  for (int y = 0; y < height; y++)
+  {
+    table.lookup_row(reinterpret_cast<Word *>(dstp), reinterpret_cast<Word *>(dstp), reinterpret_cast<const Word *>(srcp), width, ctx);
     dstp += dst_pitch;
     srcp += nSrcPitch;
   }
@@ -71,9 +72,8 @@ void Filtering::MaskTools::Filters::Lut::Dual::realtime32_c(Byte *dstp, ptrdiff_
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      reinterpret_cast<Float *>(dstp)[x] = ctx.compute_float_xy(reinterpret_cast<Float *>(dstp)[x], reinterpret_cast<const Float *>(srcp)[x], chroma);
-    }
+    const Float *srcs[] = { reinterpret_cast<Float *>(dstp), reinterpret_cast<const Float *>(srcp) };
+    ctx.compute_row_float(reinterpret_cast<Float *>(dstp), srcs, 2, width, chroma);
     dstp += dst_pitch;
     srcp += nSrcPitch;
   }
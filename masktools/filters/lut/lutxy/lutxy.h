@@ -3,6 +3,17 @@
 
 #include "../../../common/base/filter.h"
 #include "../../../../common/parser/parser.h"
+#include "../reduced.h"
+#include "../separable.h"
+#include "../cache.h"
+#include "../parallel.h"
+#include "../lazy.h"
+#include "../async.h"
+#include "../approx.h"
+#include "../neighbours.h"
+#include "../crossplane.h"
+#include "../strategy.h"
+#include "../stats.h"
 #include <mutex>
 
 namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Dual {
@@ -10,13 +21,19 @@ namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut {
 typedef void(Processor)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, const Byte lut[65536]);
 typedef void(Processor16)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, const Word *lut);
 typedef void(ProcessorCtx)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, Parser::Context &ctx);
+typedef void(ProcessorLazy)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, Lazy::Table &table, Parser::Context &ctx);
 typedef void(ProcessorCtx32)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, bool chroma, Parser::Context &ctx);
 
 Processor lut_c;
+Processor lut_avx2; // v2.2.31
 extern Processor16 *lut10_c;
 extern Processor16 *lut12_c;
 extern Processor16 *lut14_c;
 extern Processor16 *lut16_c;
+extern Processor16 *lut10_avx2; // v2.2.31
+extern Processor16 *lut12_avx2;
+extern Processor16 *lut14_avx2;
+extern Processor16 *lut16_avx2;
 
 ProcessorCtx realtime8_c;
 extern ProcessorCtx *realtime10_c;
@@ -24,6 +41,7 @@ extern ProcessorCtx *realtime12_c;
 extern ProcessorCtx *realtime14_c;
 extern ProcessorCtx *realtime16_c;
 ProcessorCtx32 realtime32_c;
+ProcessorLazy lazy_c; // 10-16 bits
 
 
 class Lutxy : public MaskTools::Filter
@@ -32,56 +50,83 @@ class Lutxy : public MaskTools::Filter
    struct Lut {
      bool used;
      Byte *ptr;
+     int inputs; // v2.2.31: table over these inputs only (Reduced), -1: full table
+     Parser::SeparableTables *separable; // v2.2.31: chained 1D tables (Separable) instead
+     Lazy::Table *lazy; // v2.2.31: filled on use (Lazy) instead of realtime, 14-16 bits
+     Async::Table *async; // v2.2.31: built in the background (async=true), ptr is set when it is released
    };
 
    Lut luts[4+1];
    
-   static Byte *calculateLut(const std::deque<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int& compute_error) {
-     Parser::Context ctx(expr, scale_inputs, clamp_float);
+   static Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error) {
      int pixelsize = bits_per_pixel == 8 ? 1 : 2; // byte / uint16_t
      size_t buffer_size = ((size_t)1 << bits_per_pixel) * ((size_t)1 << bits_per_pixel) *pixelsize;
      Byte *lut = new Byte[buffer_size];
 
-     switch (bits_per_pixel) {
-     case 8:
-       for (int x = 0; x < 256; x++)
-         for (int y = 0; y < 256; y++)
-           lut[(x << 8) + y] = ctx.compute_byte_xy(x, y);
-       break;
-     case 10:
-       for (int x = 0; x < 1024; x++)
-         for (int y = 0; y < 1024; y++)
-           reinterpret_cast<Word *>(lut)[(x << 10) + y] = ctx.compute_word_xy<10>(x, y);
-       break;
-     case 12:
-       for (int x = 0; x < 4096; x++)
-         for (int y = 0; y < 4096; y++)
-           reinterpret_cast<Word *>(lut)[(x << 12) + y] = ctx.compute_word_xy<12>(x, y);
-       break;
-     case 14:
-       for (int x = 0; x < 16384; x++)
-         for (int y = 0; y < 16384; y++)
-           reinterpret_cast<Word *>(lut)[(x << 14) + y] = ctx.compute_word_xy<14>(x, y);
-       break;
-     case 16:
-       // 64bit only
-       for (int x = 0; x < 65536; x++)
-         for (int y = 0; y < 65536; y++)
-           reinterpret_cast<Word *>(lut)[((size_t)x << 16) + y] = ctx.compute_word_xy<16>(x, y);
-       break;
-     }
-
+     const int size = 1 << bits_per_pixel;
+     // v2.2.31: rows are calculated by several threads
      // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
-     compute_error = ctx.get_compute_error();
+     compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, size, size, [&](Parser::Context &ctx, size_t row) {
+       const int x = (int)row;
+       if (bits_per_pixel == 8)
+         ctx.compute_lut_row_byte(lut + (x << 8), &x, 2, 1);
+       else // 16 bit: 64bit only
+         ctx.compute_lut_row_word(reinterpret_cast<Word *>(lut) + ((size_t)x << bits_per_pixel), &x, 2, 1, bits_per_pixel);
+     });
 
      return lut;
    }
 
+   // v2.2.31: tables are shared with the other filter instances (Lut::Cache)
+   Byte *acquireLut(const std::vector<Filtering::Parser::Symbol> &expr, bool reduced, int used_inputs, int& compute_error) {
+     const String key = Cache::key(reduced ? Reduced::layout(used_inputs).c_str() : "xy", expr, bits_per_pixel, scale_inputs, clamp_float_i);
+     return static_cast<Byte *>(Cache::acquire(key, Reduced::lut_size(reduced ? used_inputs : 3, bits_per_pixel), [&](int &build_error) -> void * {
+       if (reduced)
+         return Reduced::calculateLut(expr, used_inputs, 2, bits_per_pixel, scale_inputs, clamp_float_i, flags, /*ref*/ build_error);
+       return calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float_i, flags, /*ref*/ build_error); // fixme/fixed: this was clamp_float before 2.2.27
+     }, Cache::destroy_array<Byte>, compute_error));
+   }
+
+   Parser::SeparableTables *acquireSeparable(const std::vector<Filtering::Parser::Symbol> &expr) {
+     int unused;
+     return static_cast<Parser::SeparableTables *>(Cache::acquire(Cache::key("separable", expr, bits_per_pixel, scale_inputs, clamp_float_i), 0, [&](int &) -> void * {
+       return Separable::calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float_i, flags);
+     }, Cache::destroy_object<Parser::SeparableTables>, unused));
+   }
+
+   Lazy::Table *acquireLazy(const std::vector<Filtering::Parser::Symbol> &expr) {
+     int unused;
+     return static_cast<Lazy::Table *>(Cache::acquire(Cache::key("lazy xy", expr, bits_per_pixel, scale_inputs, clamp_float_i), 0, [&](int &) -> void * {
+       return new Lazy::Table(bits_per_pixel);
+     }, Cache::destroy_object<Lazy::Table>, unused));
+   }
+
+   Approx::Table *acquireApprox(const std::vector<Filtering::Parser::Symbol> &expr, bool chroma) {
+     int unused;
+     return static_cast<Approx::Table *>(Cache::acquire(Cache::key(Approx::layout(2, chroma, float_tolerance).c_str(), expr, bits_per_pixel, scale_inputs, clamp_float_i), 0, [&](int &) -> void * {
+       return Approx::calculateLut(expr, 2, chroma, float_tolerance, scale_inputs, clamp_float_i, flags);
+     }, Cache::destroy_object<Approx::Table>, unused));
+   }
+
+   static ProcessorCtx *realtimeProcessor(int bits_per_pixel) {
+     switch (bits_per_pixel) {
+     case 8: return realtime8_c;
+     case 10: return realtime10_c;
+     case 12: return realtime12_c;
+     case 14: return realtime14_c;
+     case 16: return realtime16_c;
+     }
+     return nullptr;
+   }
+
    // for realtime
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
+   Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
+   Stats::Filter *stats; // v2.2.31: mt_exprstats, nullptr: not profiled
+   Approx::Table *approx_luts[4]; // v2.2.31: interpolated float tables (float_tolerance), nullptr: realtime
+   double float_tolerance;
 
-   Processor *processor;
-   Processor16 *processor16;
+   ProcessorList<Processor> processors; // v2.2.31: tables by CPU
+   ProcessorList<Processor16> processors16;
    ProcessorCtx *processorCtx; // for all 8-16
    ProcessorCtx32 *processorCtx32;
    int bits_per_pixel;
@@ -89,49 +134,114 @@ class Lutxy : public MaskTools::Filter
    String scale_inputs;
    int clamp_float_i;
    int use_expr;
+   CrossPlane::Siting siting; // v2.2.31: other plane operands (x.Y), parameter cplace
+
+   // v2.2.31: evaluation of a processed plane, for mt_exprstats
+   String plane_path(int i) const {
+     if (luts[i].separable)
+       return "separable";
+     const String async = luts[i].async ? "async " : "";
+     if (luts[i].inputs >= 0)
+       return async + "table " + Reduced::layout(luts[i].inputs);
+     if (luts[i].async)
+       return "async table";
+     if (realtime_contexts[i] == nullptr)
+       return "table";
+     if (approx_luts[i])
+       return "approx";
+     return luts[i].lazy ? "lazy table" : "realtime";
+   }
 
 protected:
     virtual void process(int n, const Plane<Byte> &dst, int nPlane, const ::Filtering::Frame<const Byte> frames[4], const Constraint constraints[4]) override
     {
         UNUSED(n);
-        UNUSED(constraints);
-        if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
-          if (bits_per_pixel <= 16)
+        Stats::Timer timer(stats, nPlane, dst.width() * dst.height()); // v2.2.31: mt_exprstats
+        // v2.2.31: async=true: realtime evaluation until the table is built
+        const Byte *lut = luts[nPlane].async ? static_cast<const Byte *>(luts[nPlane].async->get()) : luts[nPlane].ptr;
+        if (luts[nPlane].separable || (luts[nPlane].inputs >= 0 && lut)) {
+          const Byte *srcs[] = { dst.data(), frames[0].plane(nPlane).data() };
+          const ptrdiff_t pitches[] = { dst.pitch(), frames[0].plane(nPlane).pitch() };
+          if (luts[nPlane].separable)
+            Separable::process(dst.data(), dst.pitch(), srcs, pitches, dst.width(), dst.height(), *luts[nPlane].separable, bits_per_pixel);
+          else
+            Reduced::process(dst.data(), dst.pitch(), srcs, pitches, dst.width(), dst.height(), lut, luts[nPlane].inputs, bits_per_pixel);
+        }
+        else if (realtime || !lut) {
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
+          const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
+          if (!ctx.get_neighbours().empty()) {
+            const Byte *srcs[] = { dst.data(), frames[0].plane(nPlane).data() };
+            const ptrdiff_t pitches[] = { dst.pitch(), frames[0].plane(nPlane).pitch() };
+            // v2.2.31: other plane operands (x.Y) read all planes of the inputs
+            const CrossPlane::Sources sources(frames, 2, keep_source_frame ? plane_counts[C] : 0, siting);
+            Neighbours::process(dst.data(), dst.pitch(), srcs, pitches, 2, dst.width(), dst.height(), bits_per_pixel, chroma, keep_source_frame ? &sources : nullptr, ctx);
+          }
+          else if (luts[nPlane].lazy)
+            lazy_c(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), *luts[nPlane].lazy, ctx);
+          else if (bits_per_pixel <= 16)
             processorCtx(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), ctx);
           else {
-            const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
-            processorCtx32(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), chroma, ctx); // extra parameter
+            if (approx_luts[nPlane])
+              Approx::process(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), *approx_luts[nPlane], chroma, ctx, flags);
+            else
+              processorCtx32(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), chroma, ctx); // extra parameter
           }
         }
         else if (bits_per_pixel == 8)
-          processor(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), luts[nPlane].ptr);
+          processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), lut);
         else if (bits_per_pixel <= 16)
-          processor16(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), (Word *)luts[nPlane].ptr);
+          processors16.best_processor(constraints[nPlane])(dst.data(), dst.pitch(), frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(), dst.width(), dst.height(), (const Word *)lut);
     }
 
 public:
    Lutxy(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter( parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
    {
+      stats = nullptr;
       for (int i = 0; i < 4; i++) {
-        parsed_expressions[i] = nullptr;
+        realtime_contexts[i] = nullptr;
+        approx_luts[i] = nullptr;
       }
 
       for (int i = 0; i < 4+1; ++i) {
         luts[i].used = false;
         luts[i].ptr = nullptr;
+        luts[i].inputs = -1;
+        luts[i].separable = nullptr;
+        luts[i].lazy = nullptr;
+        luts[i].async = nullptr;
       }
 
       static const char *expr_strs[] = { "yExpr", "uExpr", "vExpr", "aExpr" };
 
-      Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y);
+      Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y).addNeighbours();
 
       bits_per_pixel = bit_depths[C];
       realtime = parameters["realtime"].toBool();
+      bool realtime_requested = realtime;
       scale_inputs = parameters["scale_inputs"].toString();
       if (!checkValidScaleInputs(scale_inputs, error))
         return; // error message filled
+
+      // v2.2.31: float32 evaluation of the expressions
+      const String precision = parameters["precision"].toString();
+      if (precision != "double" && precision != "float") {
+        error = "precision must be \"double\" or \"float\"";
+        return;
+      }
+      const bool single_precision = precision == "float";
+
+      // v2.2.31: siting of the subsampled planes for the other plane operands (x.Y), as in mt_merge
+      if (!CrossPlane::parse_siting(parameters["cplace"].toString(), siting)) {
+        error = "cplace: only mpeg1, mpeg2 and top_left allowed";
+        return;
+      }
+
+      const bool async = parameters["async"].toBool(); // v2.2.31
+      const bool lazy = parameters["lazy"].toBool(); // v2.2.31: lazily filled table instead of realtime, 14-16 bits
+
       bool clamp_float = parameters["clamp_float"].toBool();
       bool clamp_float_UV = parameters["clamp_float_UV"].toBool();
       clamp_float_i = clamp_float ? (clamp_float_UV ? 2 : 1) : 0;
@@ -150,6 +260,12 @@ public:
       if (bits_per_pixel == 32)
         realtime = true;
 
+      float_tolerance = parameters["float_tolerance"].toFloat();
+      if (float_tolerance < 0) {
+        error = "float_tolerance cannot be negative";
+        return;
+      }
+
       if (bits_per_pixel == 16) {
         if ((uint64_t)std::numeric_limits<size_t>::max() <= 0xFFFFFFFFull && bits_per_pixel == 16) {
           realtime = true; // not even possible a real 16 bit lutxy on 32 bit environment
@@ -160,10 +276,39 @@ public:
       // This part is duplicated in lut, lutxy, lutxyz, lutxyza
       use_expr = parameters["use_expr"].toInt();
       bool use_external_expr = false;
-      if (use_expr < 0 || use_expr > 3) {
+      String use_expr_decision; // v2.2.31: use_expr=4, the chosen mode and the estimated costs, for mt_exprstats
+      if (use_expr < 0 || use_expr > 4) {
         error = "invalid value for parameter 'use_expr'";
         return;
       }
+      // v2.2.31: mode 4: the mode with the lowest estimated cost over the clip (Lut::Strategy).
+      // realtime given explicitly is kept, the choice is between it and Expr then
+      if (use_expr == 4) {
+        Strategy::Workload workload;
+        workload.nInputs = 2;
+        workload.bits_per_pixel = bits_per_pixel;
+        workload.frames = childs[0]->frame_count();
+        const int pixels_uv = plane_counts[C] > 1 ? nCoreWidthUV * nCoreHeightUV : 0;
+        const int pixels[4] = { nCoreWidth * nCoreHeight, pixels_uv, pixels_uv, nCoreWidth * nCoreHeight };
+        // invalid expressions are reported below
+        if (Strategy::add_planes(workload, parser, parameters, operators, plane_counts[C], pixels, scale_inputs, clamp_float_i)) {
+          const bool realtime_defined = parameters["realtime"].is_defined();
+          workload.allowed[Strategy::TABLE] = realtime_defined ? !realtime : bits_per_pixel <= 16;
+          workload.allowed[Strategy::LAZY_TABLE] = lazy && !realtime_defined && (bits_per_pixel == 14 || bits_per_pixel == 16);
+          workload.allowed[Strategy::REALTIME] = !realtime_defined || realtime;
+          workload.allowed[Strategy::EXPR] = has_avs_expr_support && nXOffset == 0 && nYOffset == 0 && nWidth == nCoreWidth && nHeight == nCoreHeight;
+          const Strategy::Decision decision = Strategy::choose(workload);
+          use_expr_decision = decision.describe();
+          print(LOG_DEBUG, "mt_lutxy use_expr=4: %s\n", use_expr_decision.c_str());
+          if (decision.choice == Strategy::EXPR)
+            use_external_expr = true;
+          else if (!realtime_defined) {
+            realtime = decision.choice != Strategy::TABLE;
+            // as with realtime=true: no smaller or lazy tables
+            realtime_requested = decision.choice == Strategy::REALTIME;
+          }
+        }
+      }
       if (use_expr == 1 && bits_per_pixel > 8) // mode 1: use Expr when over 8 bits or lutxyza
         use_external_expr = true;
       if (use_expr == 2 && realtime) // mode 2: use Expr when masktools would use its own slow calculation
@@ -248,6 +393,10 @@ public:
             return;
           }
 
+          // v2.2.31: control symbol, seen by every Context of the expression and part of the table keys
+          if (single_precision)
+            parser.getExpression().insert(parser.getExpression().begin(), Parser::Symbol::PrecisionF32);
+
           // for check:
           Parser::Context ctx(parser.getExpression(), scale_inputs, clamp_float_i);
 
@@ -257,17 +406,58 @@ public:
             return;
           }
 
-          if (realtime) {
-            parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
+          // v2.2.31: relative pixel operands (x[-1,0]) and other plane operands (x.Y) have no table
+          const bool neighbours = !ctx.get_neighbours().empty();
+          if (neighbours && !realtime) {
+            error = "relative pixel operands like x[-1,0] and other plane operands like x.Y need realtime=true";
+            return;
+          }
+          const int last_plane = CrossPlane::last_plane(ctx.get_neighbours());
+          if (last_plane >= plane_counts[C]) {
+            error = "other plane operand of a plane the clip does not have";
+            return;
+          }
+          if (last_plane >= 0)
+            keep_source_frame = true;
+
+          // v2.2.31: a smaller table when the expression does not read all of its inputs,
+          // chained 1D tables instead of a large table or realtime evaluation when it is separable
+          const int used_inputs = bits_per_pixel <= 16 ? ctx.get_used_inputs(bits_per_pixel) : -1;
+          const bool reduced = !neighbours && Reduced::use_lut(used_inputs, 2, bits_per_pixel, realtime, realtime_requested);
+          const size_t table_size = Reduced::lut_size(reduced ? used_inputs : 3, bits_per_pixel);
+          if (!neighbours && Separable::use_lut(table_size, bits_per_pixel, realtime && !reduced, realtime_requested)) {
+            Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+            if (lut.separable == nullptr)
+              lut.separable = acquireSeparable(parser.getExpression());
+            if (lut.separable != nullptr) {
+              lut.used = true;
+              luts[i].separable = lut.separable;
+              continue;
+            }
+          }
 
-            switch (bits_per_pixel) {
-            case 8: processorCtx = realtime8_c; break;
-            case 10: processorCtx = realtime10_c; break;
-            case 12: processorCtx = realtime12_c; break;
-            case 14: processorCtx = realtime14_c; break;
-            case 16: processorCtx = realtime16_c; break;
-            case 32: processorCtx32 = realtime32_c; break;
+          if (realtime && !reduced) {
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+
+            // v2.2.31: interpolated table when its error is within float_tolerance
+            if (bits_per_pixel == 32 && float_tolerance > 0 && !neighbours)
+              approx_luts[i] = acquireApprox(parser.getExpression(), (i == 1 || i == 2) && !planes_isRGB[C]);
+
+            // v2.2.31: lazy=true: the default realtime mode of 14 and 16 bits remembers the evaluated pairs
+            if (lazy && (bits_per_pixel == 14 || bits_per_pixel == 16) && !realtime_requested && !neighbours) {
+              Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+              if (lut.lazy == nullptr) {
+                lut.used = true;
+                lut.lazy = acquireLazy(parser.getExpression());
+              }
+              luts[i].lazy = lut.lazy;
+              continue;
             }
+
+            if (bits_per_pixel <= 16)
+              processorCtx = realtimeProcessor(bits_per_pixel);
+            else
+              processorCtx32 = realtime32_c;
             continue;
           }
 
@@ -275,55 +465,94 @@ public:
 
           int compute_error = Parser::Context::compute_error_t::CE_NONE;
 
+          // v2.2.31: async=true: a worker thread builds the table, realtime evaluation meanwhile
+          if (async) {
+            compute_error = Async::compute_error(ctx, 2, bits_per_pixel);
+            Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+            if (lut.async == nullptr && compute_error == Parser::Context::compute_error_t::CE_NONE) {
+              const std::vector<Parser::Symbol> expr = parser.getExpression();
+              lut.used = true;
+              lut.inputs = reduced ? used_inputs : -1;
+              lut.async = new Async::Table([this, expr, reduced, used_inputs]() -> void * {
+                int unused; // reported above
+                return acquireLut(expr, reduced, used_inputs, unused);
+              });
+            }
+            luts[i].async = lut.async;
+            luts[i].inputs = lut.inputs;
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+            processorCtx = realtimeProcessor(bits_per_pixel);
+          }
           // save memory, reuse luts, like in xyz
-          if (customExpressionDefined) {
+          else if (customExpressionDefined) {
             luts[i].used = true;
-            luts[i].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float_i, /*ref*/ compute_error); // fixme/fixed: this was clamp_float before 2.2.27
+            luts[i].ptr = acquireLut(parser.getExpression(), reduced, used_inputs, /*ref*/ compute_error);
+            luts[i].inputs = reduced ? used_inputs : -1;
           }
           else {
             if (luts[4].ptr == nullptr) {
               luts[4].used = true;
-              luts[4].ptr = calculateLut(parser.getExpression(), bits_per_pixel, scale_inputs, clamp_float_i, /*ref*/ compute_error);
+              luts[4].ptr = acquireLut(parser.getExpression(), reduced, used_inputs, /*ref*/ compute_error);
+              luts[4].inputs = reduced ? used_inputs : -1;
             }
             luts[i].ptr = luts[4].ptr;
+            luts[i].inputs = luts[4].inputs;
           }
 
           if (compute_error != Parser::Context::compute_error_t::CE_NONE) {
             error = "invalid expression in the lut code = " + std::to_string(compute_error);
             return;
           }
+        }
+      }
 
-          switch (bits_per_pixel) {
-          case 8:
-            processor = lut_c;
-            break;
-          case 10:
-            processor16 = lut10_c;
-            break;
-          case 12:
-            processor16 = lut12_c;
-            break;
-          case 14:
-            processor16 = lut14_c;
-            break;
-          case 16:
-            // 64bit only
-            processor16 = lut16_c;
-            break;
-          }
+      // v2.2.31: the table entries are gathered with AVX2, 32 (8 bit) or 16 pixels at a time (the remainder of a row in C)
+      if (bits_per_pixel == 8) {
+        processors.push_back(Filtering::Processor<Processor>(lut_c, Constraint(CPU_NONE, 1, 1, 1, 1), 0));
+        processors.push_back(Filtering::Processor<Processor>(lut_avx2, Constraint(CPU_AVX2, MODULO_NONE, MODULO_NONE, ALIGNMENT_NONE, 32), 1));
+      }
+      else if (bits_per_pixel <= 16) {
+        Processor16 *c = nullptr, *avx2 = nullptr;
+        switch (bits_per_pixel) {
+        case 10: c = lut10_c; avx2 = lut10_avx2; break;
+        case 12: c = lut12_c; avx2 = lut12_avx2; break;
+        case 14: c = lut14_c; avx2 = lut14_avx2; break;
+        case 16: c = lut16_c; avx2 = lut16_avx2; break; // 64bit only
         }
+        processors16.push_back(Filtering::Processor<Processor16>(c, Constraint(CPU_NONE, 1, 1, 1, 1), 0));
+        processors16.push_back(Filtering::Processor<Processor16>(avx2, Constraint(CPU_AVX2, MODULO_NONE, MODULO_NONE, ALIGNMENT_NONE, 16), 1));
+      }
+
+      // v2.2.31: mt_exprstats
+      const String decision_note = use_expr_decision.empty() ? String() : "; use_expr=4: " + use_expr_decision;
+      stats = Stats::create("mt_lutxy");
+      for (int i = 0; i < 4 && stats; i++) {
+        if (operators[i] != PROCESS)
+          continue;
+        if (use_external_expr)
+          Stats::set_plane(stats, i, expr_list[i], "expr" + decision_note, nullptr);
+        else
+          Stats::set_plane(stats, i, parameters[expr_strs[i]].is_defined() ? parameters[expr_strs[i]].toString() : parameters["expr"].toString(), plane_path(i) + decision_note, realtime_contexts[i]);
       }
    }
 
    ~Lutxy()
    {
+     Stats::destroy(stats); // before the ContextPools
      for (int i = 0; i < 4+1; ++i) {
        if (luts[i].used) {
-         delete[] luts[i].ptr;
+         if (luts[i].async) {
+           luts[i].ptr = static_cast<Byte *>(luts[i].async->wait());
+           delete luts[i].async;
+         }
+         Cache::release(luts[i].ptr);
+         Cache::release(luts[i].separable);
+         Cache::release(luts[i].lazy);
        }
      }
      for (int i = 0; i < 4; i++) {
-       delete parsed_expressions[i];
+       delete realtime_contexts[i];
+       Cache::release(approx_luts[i]);
      }
    }
 
@@ -348,6 +577,11 @@ public:
       signature.add(Parameter(false, "clamp_float", false));
       signature.add(Parameter(0, "use_expr", false));
       signature.add(Parameter(false, "clamp_float_UV", false));
+      signature.add(Parameter(0.0f, "float_tolerance", false));
+      signature.add(Parameter(String("double"), "precision", false));
+      signature.add(Parameter(false, "async", false));
+      signature.add(Parameter(String("mpeg2"), "cplace", false));
+      signature.add(Parameter(false, "lazy", false));
       return signature;
    }
 };
@@ -0,0 +1,72 @@
+#include "lutxy.h"
+#include "../gather_avx2.h"
+
+using namespace Filtering;
+namespace Gather = Filtering::MaskTools::Filters::Lut::Gather;
+
+// v2.2.31: the 2D table is far larger than the L1/L2 caches, the entries are gathered 8 at a time (Lut::Gather)
+// and the index is built with vector shifts. Software prefetching the entries of the next pixels was measured
+// not faster, even with the 32 MB 12 bit tables.
+void Filtering::MaskTools::Filters::Lut::Dual::lut_avx2(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, int nWidth, int nHeight, const Byte lut[65536])
+{
+   const int wmod32 = nWidth & ~31;
+   for ( int y = 0; y < nHeight; y++ )
+   {
+      for ( int x = 0; x < wmod32; x += 32 ) {
+         __m256i values[4];
+         for ( int k = 0; k < 4; k++ ) {
+            const __m256i index = _mm256_or_si256(_mm256_slli_epi32(Gather::load_bytes(pDst + x + 8 * k), 8), Gather::load_bytes(pSrc + x + 8 * k));
+            values[k] = Gather::lookup_bytes(lut, index);
+         }
+         Gather::store_bytes(pDst + x, values[0], values[1], values[2], values[3]);
+      }
+      for ( int x = wmod32; x < nWidth; x++ )
+         pDst[x] = lut[(pDst[x]<<8) + pSrc[x]];
+      pDst += nDstPitch;
+      pSrc += nSrcPitch;
+   }
+}
+
+template<int bits_per_pixel>
+static void lut16_t_avx2(Byte *dstp, ptrdiff_t nDstPitch, const Byte *srcp, ptrdiff_t nSrcPitch, int nWidth, int nHeight, const Word *lut)
+{
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const int wmod16 = nWidth & ~15;
+  for (int y = 0; y < nHeight; y++)
+  {
+    Word *dst = reinterpret_cast<Word *>(dstp);
+    const Word *src = reinterpret_cast<const Word *>(srcp);
+    for (int x = 0; x < wmod16; x += 16) {
+      __m256i values[2];
+      for (int k = 0; k < 2; k++) {
+        // 16 bit: the index uses all 32 bits, lookup_words shifts it unsigned
+        const __m256i index = _mm256_or_si256(_mm256_slli_epi32(Gather::load_words_clamped<bits_per_pixel>(dst + x + 8 * k), bits_per_pixel),
+                                              Gather::load_words_clamped<bits_per_pixel>(src + x + 8 * k));
+        values[k] = Gather::lookup_words(lut, index);
+      }
+      Gather::store_words(dst + x, values[0], values[1]);
+    }
+    for (int x = wmod16; x < nWidth; x++) {
+      const size_t pixelX = min((int)dst[x], max_pixel_value);
+      const size_t pixelY = min((int)src[x], max_pixel_value);
+      dst[x] = lut[(pixelX << bits_per_pixel) + pixelY];
+    }
+    dstp += nDstPitch;
+    srcp += nSrcPitch;
+  }
+}
+
+namespace Filtering {
+  namespace MaskTools {
+    namespace Filters {
+      namespace Lut {
+        namespace Dual {
+          Processor16 *lut10_avx2 = &lut16_t_avx2<10>;
+          Processor16 *lut12_avx2 = &lut16_t_avx2<12>;
+          Processor16 *lut14_avx2 = &lut16_t_avx2<14>;
+          Processor16 *lut16_avx2 = &lut16_t_avx2<16>;
+        }
+      }
+    }
+  }
+}
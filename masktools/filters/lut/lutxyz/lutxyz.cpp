@@ -1,6 +1,8 @@
 #include "lutxyz.h"
+#include "../memo.h"
 
 using namespace Filtering;
+namespace Memo = Filtering::MaskTools::Filters::Lut::Memo;
 
 void Filtering::MaskTools::Filters::Lut::Trial::lut_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc1, ptrdiff_t nSrc1Pitch, const Byte *pSrc2, ptrdiff_t nSrc2Pitch, int nWidth, int nHeight, const Byte *lut)
 {
@@ -18,9 +20,8 @@ void Filtering::MaskTools::Filters::Lut::Trial::realtime8_c(Byte *dstp, ptrdiff_
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      dstp[x] = ctx.compute_byte_xyz(dstp[x], srcp[x], srcp2[x]);
-    }
+    const Byte *srcs[] = { dstp, srcp, srcp2 };
+    ctx.compute_row_byte(dstp, srcs, 3, width);
     dstp += dst_pitch;
     srcp += nSrcPitch;
     srcp2 += nSrc2Pitch;
@@ -30,21 +31,13 @@ void Filtering::MaskTools::Filters::Lut::Trial::realtime8_c(Byte *dstp, ptrdiff_
 template<int bits_per_pixel>
 static void realtime16_t_c(Byte *dstp, ptrdiff_t dst_pitch, const Byte *srcp, ptrdiff_t nSrcPitch, const Byte *srcp2, ptrdiff_t nSrc2Pitch, int width, int height, Parser::Context &ctx)
 {
-  const Word max_pixel_value = (1 << bits_per_pixel) - 1;
+  // v2.2.31: repeated input values are looked up, for this plane only
+  Memo::Table memo(3, bits_per_pixel);
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      Word pixelX = reinterpret_cast<uint16_t *>(dstp)[x];
-      if (bits_per_pixel != 16) pixelX = min(pixelX, max_pixel_value); // clamp input below 16 bit
-      Word pixelY = reinterpret_cast<const uint16_t *>(srcp)[x];
-      if (bits_per_pixel != 16) pixelY = min(pixelY, max_pixel_value); // clamp input below 16 bit
-      Word pixelZ = reinterpret_cast<const uint16_t *>(srcp2)[x];
-      if (bits_per_pixel != 16) pixelZ = min(pixelZ, max_pixel_value); // clamp input below 16 bit
-
-      Word result = ctx.compute_word_xyz<bits_per_pixel>(pixelX, pixelY, pixelZ);
-
-      reinterpret_cast<uint16_t *>(dstp)[x] = result;
-    }
+    // input is clamped below 16 bit
+    const Word *srcs[] = { reinterpret_cast<Word *>(dstp), reinterpret_cast<const Word *>(srcp), reinterpret_cast<const Word *>(srcp2) };
+    memo.compute_row(reinterpret_cast<Word *>(dstp), srcs, width, ctx);
     dstp += dst_pitch;
     srcp += nSrcPitch;
     srcp2 += nSrc2Pitch;
@@ -55,9 +48,8 @@ void Filtering::MaskTools::Filters::Lut::Trial::realtime32_c(Byte *dstp, ptrdiff
 {
   for (int y = 0; y < height; y++)
   {
-    for (int x = 0; x < width; x++) {
-      reinterpret_cast<Float *>(dstp)[x] = ctx.compute_float_xyz(reinterpret_cast<Float *>(dstp)[x], reinterpret_cast<const Float *>(srcp)[x], reinterpret_cast<const Float *>(srcp2)[x], chroma);
-    }
+    const Float *srcs[] = { reinterpret_cast<Float *>(dstp), reinterpret_cast<const Float *>(srcp), reinterpret_cast<const Float *>(srcp2) };
+    ctx.compute_row_float(reinterpret_cast<Float *>(dstp), srcs, 3, width, chroma);
     dstp += dst_pitch;
     srcp += nSrcPitch;
     srcp2 += nSrc2Pitch;
@@ -3,6 +3,15 @@
 
 #include "../../../common/base/filter.h"
 #include "../../../../common/parser/parser.h"
+#include "../reduced.h"
+#include "../separable.h"
+#include "../cache.h"
+#include "../async.h"
+#include "../parallel.h"
+#include "../neighbours.h"
+#include "../crossplane.h"
+#include "../strategy.h"
+#include "../stats.h"
 
 namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Trial {
 
@@ -11,6 +20,7 @@ typedef void(ProcessorCtx)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, pt
 typedef void(ProcessorCtx32)(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc, ptrdiff_t nSrcPitch, const Byte *pSrc2, ptrdiff_t nSrc2Pitch, int nWidth, int nHeight, bool chroma, Parser::Context &ctx);
 
 Processor lut_c;
+Processor lut_avx2; // v2.2.31
 
 ProcessorCtx realtime8_c;
 extern ProcessorCtx *realtime10_c;
@@ -24,31 +34,60 @@ class Lutxyz : public MaskTools::Filter
     struct Lut {
         bool used;
         Byte *ptr;
+        int inputs; // v2.2.31: table over these inputs only (Reduced), -1: full table
+        Parser::SeparableTables *separable; // v2.2.31: chained 1D tables (Separable) instead
+        Async::Table *async; // v2.2.31: built in the background (async=true), ptr is set when it is released
     };
 
    Lut luts[4+1];
 
-   static Byte *calculateLut(const std::deque<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float, int& compute_error) {
-       Parser::Context ctx(expr, scale_inputs, clamp_float);
+   static Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error) {
        Byte *lut = new Byte[256 * 256 * 256];
 
-       for ( int x = 0; x < 256; x++ ) {
-           for ( int y = 0; y < 256; y++ ) {
-               for ( int z = 0; z < 256; z++ ) {
-                   lut[(x<<16)+(y<<8)+z] = ctx.compute_byte_xyz(x, y, z); 
-               }
-           }
-       }
-
+       // v2.2.31: rows are calculated by several threads
        // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
-       compute_error = ctx.get_compute_error();
+       compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, 256 * 256, 256, [&](Parser::Context &ctx, size_t row) {
+           const int values[] = { (int)(row >> 8), (int)(row & 255) }; // x, y
+           ctx.compute_lut_row_byte(lut + (row << 8), values, 3, 2);
+       });
 
        return lut;
    }
 
+   // v2.2.31: tables are shared with the other filter instances (Lut::Cache)
+   Byte *acquireLut(const std::vector<Filtering::Parser::Symbol> &expr, bool reduced, int used_inputs, int clamp_float, int& compute_error) {
+     const String key = reduced ? Cache::key(Reduced::layout(used_inputs).c_str(), expr, bits_per_pixel, scale_inputs, clamp_float)
+       : Cache::key("xyz", expr, 8, scale_inputs, clamp_float);
+     return static_cast<Byte *>(Cache::acquire(key, Reduced::lut_size(reduced ? used_inputs : 7, reduced ? bits_per_pixel : 8), [&](int &build_error) -> void * {
+       if (reduced)
+         return Reduced::calculateLut(expr, used_inputs, 3, bits_per_pixel, scale_inputs, clamp_float, flags, /*ref*/ build_error);
+       return calculateLut(expr, scale_inputs, clamp_float, flags, /*ref*/ build_error); // 8 bit always
+     }, Cache::destroy_array<Byte>, compute_error));
+   }
+
+   Parser::SeparableTables *acquireSeparable(const std::vector<Filtering::Parser::Symbol> &expr, int clamp_float) {
+     int unused;
+     return static_cast<Parser::SeparableTables *>(Cache::acquire(Cache::key("separable", expr, bits_per_pixel, scale_inputs, clamp_float), 0, [&](int &) -> void * {
+       return Separable::calculateLut(expr, bits_per_pixel, scale_inputs, clamp_float, flags);
+     }, Cache::destroy_object<Parser::SeparableTables>, unused));
+   }
+
+   static ProcessorCtx *realtimeProcessor(int bits_per_pixel) {
+     switch (bits_per_pixel) {
+     case 8: return realtime8_c;
+     case 10: return realtime10_c;
+     case 12: return realtime12_c;
+     case 14: return realtime14_c;
+     case 16: return realtime16_c;
+     }
+     return nullptr;
+   }
+
    // for realtime
-   std::deque<Filtering::Parser::Symbol> *parsed_expressions[4];
+   Parser::ContextPool *realtime_contexts[4]; // v2.2.31: compiled contexts, reused between frames
+   Stats::Filter *stats; // v2.2.31: mt_exprstats, nullptr: not profiled
 
+   ProcessorList<Processor> processors; // v2.2.31: 8 bit tables, by CPU
    ProcessorCtx *processorCtx; // for all 8-16
    ProcessorCtx32 *processorCtx32;
    int bits_per_pixel;
@@ -56,23 +95,54 @@ class Lutxyz : public MaskTools::Filter
    String scale_inputs;
    int clamp_float_i;
    int use_expr;
+   CrossPlane::Siting siting; // v2.2.31: other plane operands (x.Y), parameter cplace
+
+   // v2.2.31: evaluation of a processed plane, for mt_exprstats
+   String plane_path(int i) const {
+     if (luts[i].separable)
+       return "separable";
+     const String async = luts[i].async ? "async " : "";
+     if (luts[i].inputs >= 0)
+       return async + "table " + Reduced::layout(luts[i].inputs);
+     if (luts[i].async)
+       return "async table";
+     return realtime_contexts[i] ? "realtime" : "table";
+   }
 
 protected:
     virtual void process(int n, const Plane<Byte> &dst, int nPlane, const Filtering::Frame<const Byte> frames[4], const Constraint constraints[4]) override
     {
         UNUSED(n);
-        UNUSED(constraints);
-        if (realtime) {
-          // thread safety
-          Parser::Context ctx(*parsed_expressions[nPlane], scale_inputs, clamp_float_i);
-
-          if (bits_per_pixel <= 16)
+        Stats::Timer timer(stats, nPlane, dst.width() * dst.height()); // v2.2.31: mt_exprstats
+        // v2.2.31: async=true: realtime evaluation until the table is built
+        const Byte *lut = luts[nPlane].async ? static_cast<const Byte *>(luts[nPlane].async->get()) : luts[nPlane].ptr;
+        if (luts[nPlane].separable || (luts[nPlane].inputs >= 0 && lut)) {
+          const Byte *srcs[] = { dst.data(), frames[0].plane(nPlane).data(), frames[1].plane(nPlane).data() };
+          const ptrdiff_t pitches[] = { dst.pitch(), frames[0].plane(nPlane).pitch(), frames[1].plane(nPlane).pitch() };
+          if (luts[nPlane].separable)
+            Separable::process(dst.data(), dst.pitch(), srcs, pitches, dst.width(), dst.height(), *luts[nPlane].separable, bits_per_pixel);
+          else
+            Reduced::process(dst.data(), dst.pitch(), srcs, pitches, dst.width(), dst.height(), lut, luts[nPlane].inputs, bits_per_pixel);
+        }
+        else if (realtime || !lut) {
+          // thread safety: the leased Context is not used by other threads meanwhile
+          Parser::ContextPool::Lease lease(*realtime_contexts[nPlane]);
+          Parser::Context &ctx = lease.context();
+          const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
+
+          if (!ctx.get_neighbours().empty()) {
+            const Byte *srcs[] = { dst.data(), frames[0].plane(nPlane).data(), frames[1].plane(nPlane).data() };
+            const ptrdiff_t pitches[] = { dst.pitch(), frames[0].plane(nPlane).pitch(), frames[1].plane(nPlane).pitch() };
+            // v2.2.31: other plane operands (x.Y) read all planes of the inputs
+            const CrossPlane::Sources sources(frames, 3, keep_source_frame ? plane_counts[C] : 0, siting);
+            Neighbours::process(dst.data(), dst.pitch(), srcs, pitches, 3, dst.width(), dst.height(), bits_per_pixel, chroma, keep_source_frame ? &sources : nullptr, ctx);
+          }
+          else if (bits_per_pixel <= 16)
             processorCtx(dst.data(), dst.pitch(),
               frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
               frames[1].plane(nPlane).data(), frames[1].plane(nPlane).pitch(),
               dst.width(), dst.height(), ctx);
           else {
-            const bool chroma = ((nPlane == 1 || nPlane == 2) && !planes_isRGB[C]);
             processorCtx32(dst.data(), dst.pitch(),
               frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
               frames[1].plane(nPlane).data(), frames[1].plane(nPlane).pitch(),
@@ -81,30 +151,52 @@ protected:
 
         }
         else if (bits_per_pixel == 8) {
-          lut_c(dst.data(), dst.pitch(),
+          processors.best_processor(constraints[nPlane])(dst.data(), dst.pitch(),
             frames[0].plane(nPlane).data(), frames[0].plane(nPlane).pitch(),
             frames[1].plane(nPlane).data(), frames[1].plane(nPlane).pitch(),
-            dst.width(), dst.height(), luts[nPlane].ptr);
+            dst.width(), dst.height(), lut);
         }
     }
 
 public:
    Lutxyz(const Parameters &parameters, CpuFlags cpuFlags) : MaskTools::Filter( parameters, FilterProcessingType::INPLACE, (CpuFlags)cpuFlags)
    {
+      stats = nullptr;
       for (int i = 0; i < 4; i++) {
-        parsed_expressions[i] = nullptr;
+        realtime_contexts[i] = nullptr;
       }
 
       for (int i = 0; i < 4+1; ++i) {
           luts[i].used = false;
           luts[i].ptr = nullptr;
+          luts[i].inputs = -1;
+          luts[i].separable = nullptr;
+          luts[i].async = nullptr;
       }
 
       bits_per_pixel = bit_depths[C];
       realtime = parameters["realtime"].toBool();
+      bool realtime_requested = realtime;
       scale_inputs = parameters["scale_inputs"].toString();
       if (!checkValidScaleInputs(scale_inputs, error))
         return; // error message filled
+
+      // v2.2.31: float32 evaluation of the expressions
+      const String precision = parameters["precision"].toString();
+      if (precision != "double" && precision != "float") {
+        error = "precision must be \"double\" or \"float\"";
+        return;
+      }
+      const bool single_precision = precision == "float";
+
+      // v2.2.31: siting of the subsampled planes for the other plane operands (x.Y), as in mt_merge
+      if (!CrossPlane::parse_siting(parameters["cplace"].toString(), siting)) {
+        error = "cplace: only mpeg1, mpeg2 and top_left allowed";
+        return;
+      }
+
+      const bool async = parameters["async"].toBool(); // v2.2.31
+
       bool clamp_float = parameters["clamp_float"].toBool();
       bool clamp_float_UV = parameters["clamp_float_UV"].toBool();
       clamp_float_i = clamp_float ? (clamp_float_UV ? 2 : 1) : 0;
@@ -118,10 +210,39 @@ public:
       // This part is duplicated in lut, lutxy, lutxyz, lutxyza
       use_expr = parameters["use_expr"].toInt();
       bool use_external_expr = false;
-      if (use_expr < 0 || use_expr > 3) {
+      String use_expr_decision; // v2.2.31: use_expr=4, the chosen mode and the estimated costs, for mt_exprstats
+      if (use_expr < 0 || use_expr > 4) {
         error = "invalid value for parameter 'use_expr'";
         return;
       }
+      // v2.2.31: mode 4: the mode with the lowest estimated cost over the clip (Lut::Strategy).
+      // realtime given explicitly is kept, the choice is between it and Expr then
+      if (use_expr == 4) {
+        Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y).addSymbol(Parser::Symbol::Z).addNeighbours();
+        Strategy::Workload workload;
+        workload.nInputs = 3;
+        workload.bits_per_pixel = bits_per_pixel;
+        workload.frames = childs[0]->frame_count();
+        const int pixels_uv = plane_counts[C] > 1 ? nCoreWidthUV * nCoreHeightUV : 0;
+        const int pixels[4] = { nCoreWidth * nCoreHeight, pixels_uv, pixels_uv, nCoreWidth * nCoreHeight };
+        // invalid expressions are reported below
+        if (Strategy::add_planes(workload, parser, parameters, operators, plane_counts[C], pixels, scale_inputs, clamp_float_i)) {
+          const bool realtime_defined = parameters["realtime"].is_defined();
+          workload.allowed[Strategy::TABLE] = realtime_defined ? !realtime : bits_per_pixel == 8 || (bits_per_pixel <= 16 && workload.used_inputs != 7);
+          workload.allowed[Strategy::REALTIME] = !realtime_defined || realtime;
+          workload.allowed[Strategy::EXPR] = has_avs_expr_support && nXOffset == 0 && nYOffset == 0 && nWidth == nCoreWidth && nHeight == nCoreHeight;
+          const Strategy::Decision decision = Strategy::choose(workload);
+          use_expr_decision = decision.describe();
+          print(LOG_DEBUG, "mt_lutxyz use_expr=4: %s\n", use_expr_decision.c_str());
+          if (decision.choice == Strategy::EXPR)
+            use_external_expr = true;
+          else if (!realtime_defined) {
+            realtime = decision.choice != Strategy::TABLE;
+            // as with realtime=true: no smaller or lazy tables
+            realtime_requested = decision.choice == Strategy::REALTIME;
+          }
+        }
+      }
       if (use_expr == 1 && bits_per_pixel > 8) // mode 1: use Expr when over 8 bits or lutxyza
         use_external_expr = true;
       if (use_expr == 2 && realtime) // mode 2: use Expr when masktools would use its own slow calculation
@@ -181,7 +302,7 @@ public:
       }
       else {
 
-        Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y).addSymbol(Parser::Symbol::Z);
+        Parser::Parser parser = Parser::getDefaultParser().addSymbol(Parser::Symbol::X).addSymbol(Parser::Symbol::Y).addSymbol(Parser::Symbol::Z).addNeighbours();
 
         /* compute the luts */
         for (int i = 0; i < 4; i++)
@@ -209,6 +330,10 @@ public:
             return;
           }
 
+          // v2.2.31: control symbol, seen by every Context of the expression and part of the table keys
+          if (single_precision)
+            parser.getExpression().insert(parser.getExpression().begin(), Parser::Symbol::PrecisionF32);
+
           // for check:
           Parser::Context ctx(parser.getExpression(), scale_inputs, clamp_float);
 
@@ -218,32 +343,79 @@ public:
             return;
           }
 
-          if (realtime) {
-            parsed_expressions[i] = new std::deque<Parser::Symbol>(parser.getExpression());
-
-            switch (bits_per_pixel) {
-            case 8: processorCtx = realtime8_c; break;
-            case 10: processorCtx = realtime10_c; break;
-            case 12: processorCtx = realtime12_c; break;
-            case 14: processorCtx = realtime14_c; break;
-            case 16: processorCtx = realtime16_c; break;
-            case 32: processorCtx32 = realtime32_c; break;
+          // v2.2.31: relative pixel operands (x[-1,0]) and other plane operands (x.Y) have no table
+          const bool neighbours = !ctx.get_neighbours().empty();
+          if (neighbours && !realtime) {
+            error = "relative pixel operands like x[-1,0] and other plane operands like x.Y need realtime=true";
+            return;
+          }
+          const int last_plane = CrossPlane::last_plane(ctx.get_neighbours());
+          if (last_plane >= plane_counts[C]) {
+            error = "other plane operand of a plane the clip does not have";
+            return;
+          }
+          if (last_plane >= 0)
+            keep_source_frame = true;
+
+          // v2.2.31: a smaller table when the expression does not read all of its inputs,
+          // chained 1D tables instead of a large table or realtime evaluation when it is separable
+          const int used_inputs = bits_per_pixel <= 16 ? ctx.get_used_inputs(bits_per_pixel) : -1;
+          const bool reduced = !neighbours && Reduced::use_lut(used_inputs, 3, bits_per_pixel, realtime, realtime_requested);
+          const size_t table_size = Reduced::lut_size(reduced ? used_inputs : 7, bits_per_pixel);
+          if (!neighbours && Separable::use_lut(table_size, bits_per_pixel, realtime && !reduced, realtime_requested)) {
+            Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+            if (lut.separable == nullptr)
+              lut.separable = acquireSeparable(parser.getExpression(), clamp_float);
+            if (lut.separable != nullptr) {
+              lut.used = true;
+              luts[i].separable = lut.separable;
+              continue;
             }
+          }
+
+          if (realtime && !reduced) {
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+
+            if (bits_per_pixel <= 16)
+              processorCtx = realtimeProcessor(bits_per_pixel);
+            else
+              processorCtx32 = realtime32_c;
             continue;
           }
 
           int compute_error = Parser::Context::compute_error_t::CE_NONE;
 
-          if (customExpressionDefined) {
+          // v2.2.31: async=true: a worker thread builds the table, realtime evaluation meanwhile
+          if (async) {
+            compute_error = Async::compute_error(ctx, 3, bits_per_pixel);
+            Lut &lut = customExpressionDefined ? luts[i] : luts[4];
+            if (lut.async == nullptr && compute_error == Parser::Context::compute_error_t::CE_NONE) {
+              const std::vector<Parser::Symbol> expr = parser.getExpression();
+              lut.used = true;
+              lut.inputs = reduced ? used_inputs : -1;
+              lut.async = new Async::Table([this, expr, reduced, used_inputs, clamp_float]() -> void * {
+                int unused; // reported above
+                return acquireLut(expr, reduced, used_inputs, clamp_float, unused);
+              });
+            }
+            luts[i].async = lut.async;
+            luts[i].inputs = lut.inputs;
+            realtime_contexts[i] = new Parser::ContextPool(parser.getExpression(), scale_inputs, clamp_float_i, flags);
+            processorCtx = realtimeProcessor(bits_per_pixel);
+          }
+          else if (customExpressionDefined) {
             luts[i].used = true;
-            luts[i].ptr = calculateLut(parser.getExpression(), scale_inputs, clamp_float, /*ref*/ compute_error); // 8 bit always
+            luts[i].ptr = acquireLut(parser.getExpression(), reduced, used_inputs, clamp_float, /*ref*/ compute_error);
+            luts[i].inputs = reduced ? used_inputs : -1;
           }
           else {
             if (luts[4].ptr == nullptr) {
               luts[4].used = true;
-              luts[4].ptr = calculateLut(parser.getExpression(), scale_inputs, clamp_float, /*ref*/ compute_error);
+              luts[4].ptr = acquireLut(parser.getExpression(), reduced, used_inputs, clamp_float, /*ref*/ compute_error);
+              luts[4].inputs = reduced ? used_inputs : -1;
             }
             luts[i].ptr = luts[4].ptr;
+            luts[i].inputs = luts[4].inputs;
           }
 
           if (compute_error != Parser::Context::compute_error_t::CE_NONE) {
@@ -253,17 +425,41 @@ public:
 
         }
       }
+
+      // v2.2.31: the table entries are gathered with AVX2, 32 pixels at a time (the remainder of a row in C)
+      if (bits_per_pixel == 8) {
+        processors.push_back(Filtering::Processor<Processor>(lut_c, Constraint(CPU_NONE, 1, 1, 1, 1), 0));
+        processors.push_back(Filtering::Processor<Processor>(lut_avx2, Constraint(CPU_AVX2, MODULO_NONE, MODULO_NONE, ALIGNMENT_NONE, 32), 1));
+      }
+
+      // v2.2.31: mt_exprstats
+      const String decision_note = use_expr_decision.empty() ? String() : "; use_expr=4: " + use_expr_decision;
+      stats = Stats::create("mt_lutxyz");
+      for (int i = 0; i < 4 && stats; i++) {
+        if (operators[i] != PROCESS)
+          continue;
+        if (use_external_expr)
+          Stats::set_plane(stats, i, expr_list[i], "expr" + decision_note, nullptr);
+        else
+          Stats::set_plane(stats, i, parameters[expr_strs[i]].is_defined() ? parameters[expr_strs[i]].toString() : parameters["expr"].toString(), plane_path(i) + decision_note, realtime_contexts[i]);
+      }
    }
 
    ~Lutxyz()
    {
+       Stats::destroy(stats); // before the ContextPools
        for (int i = 0; i < 4+1; ++i) {
            if (luts[i].used) {
-               delete[] luts[i].ptr;
+               if (luts[i].async) {
+                 luts[i].ptr = static_cast<Byte *>(luts[i].async->wait());
+                 delete luts[i].async;
+               }
+               Cache::release(luts[i].ptr);
+               Cache::release(luts[i].separable);
            }
        }
        for (int i = 0; i < 4; i++) {
-         delete parsed_expressions[i];
+         delete realtime_contexts[i];
        }
    }
 
@@ -289,6 +485,9 @@ public:
       signature.add(Parameter(false, "clamp_float", false));
       signature.add(Parameter(0, "use_expr", false));
       signature.add(Parameter(false, "clamp_float_UV", false));
+      signature.add(Parameter(String("double"), "precision", false));
+      signature.add(Parameter(false, "async", false));
+      signature.add(Parameter(String("mpeg2"), "cplace", false));
       return signature;
    }
 };
@@ -0,0 +1,27 @@
+#include "lutxyz.h"
+#include "../gather_avx2.h"
+
+using namespace Filtering;
+namespace Gather = Filtering::MaskTools::Filters::Lut::Gather;
+
+// v2.2.31: same as lut_c, 32 pixels at a time, the entries of the 16 MB table gathered 8 at a time (Lut::Gather)
+void Filtering::MaskTools::Filters::Lut::Trial::lut_avx2(Byte *pDst, ptrdiff_t nDstPitch, const Byte *pSrc1, ptrdiff_t nSrc1Pitch, const Byte *pSrc2, ptrdiff_t nSrc2Pitch, int nWidth, int nHeight, const Byte *lut)
+{
+   const int wmod32 = nWidth & ~31;
+   for ( int y = 0; y < nHeight; y++ )
+   {
+      for ( int x = 0; x < wmod32; x += 32 ) {
+         __m256i values[4];
+         for ( int k = 0; k < 4; k++ ) {
+            const __m256i xy = _mm256_or_si256(_mm256_slli_epi32(Gather::load_bytes(pDst + x + 8 * k), 16), _mm256_slli_epi32(Gather::load_bytes(pSrc1 + x + 8 * k), 8));
+            values[k] = Gather::lookup_bytes(lut, _mm256_or_si256(xy, Gather::load_bytes(pSrc2 + x + 8 * k)));
+         }
+         Gather::store_bytes(pDst + x, values[0], values[1], values[2], values[3]);
+      }
+      for ( int x = wmod32; x < nWidth; x++ )
+         pDst[x] = lut[(pDst[x]<<16) + (pSrc1[x]<<8) + (pSrc2[x])];
+      pDst += nDstPitch;
+      pSrc1 += nSrc1Pitch;
+      pSrc2 += nSrc2Pitch;
+   }
+}
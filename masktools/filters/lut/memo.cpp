@@ -0,0 +1,94 @@
+#include "memo.h"
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Memo {
+
+Table::Table(int nInputs, int bits_per_pixel) : nInputs(nInputs), bits_per_pixel(bits_per_pixel), rows(0), lookups(0), hits(0), bypass(false)
+{
+  slots.resize((size_t)1 << HASH_BITS, Slot { 0, EMPTY });
+}
+
+void Table::compute_row(Word *dst, const Word * const *srcs, int width, Parser::Context &ctx)
+{
+  if (bypass) {
+    ctx.compute_row_word(dst, srcs, nInputs, width, bits_per_pixel);
+    return;
+  }
+
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const size_t mask = slots.size() - 1;
+
+  for (int n = 0; n < nInputs; n++)
+    missing_inputs[n].clear();
+  missing_slots.clear();
+  waiting.clear();
+
+  for (int i = 0; i < width; i++) {
+    Uint64 key = 0;
+    Word values[4];
+    for (int n = 0; n < nInputs; n++) {
+      // clamped like in compute_row_word
+      values[n] = (Word)min((int)srcs[n][i], max_pixel_value);
+      key |= (Uint64)values[n] << (16 * n);
+    }
+    const size_t home = (size_t)((key * 0x9E3779B97F4A7C15ull) >> (64 - HASH_BITS));
+    size_t free_slot = NO_SLOT;
+    bool found = false;
+    for (int probe = 0; probe < MAX_PROBES; probe++) {
+      const size_t index = (home + probe) & mask;
+      const Slot &slot = slots[index];
+      if (slot.value == EMPTY) {
+        free_slot = index;
+        break;
+      }
+      if (slot.key == key) {
+        if (slot.value & PENDING)
+          waiting.push_back(Pixel { i, (int)(slot.value & ~PENDING) });
+        else
+          dst[i] = (Word)slot.value;
+        found = true;
+        break;
+      }
+    }
+    if (found) {
+      hits++;
+      continue;
+    }
+    // the home slot is replaced when the probe sequence is full, unless another value of this row waits in it
+    if (free_slot == NO_SLOT && !(slots[home & mask].value & PENDING))
+      free_slot = home & mask;
+    const int k = (int)missing_slots.size();
+    if (free_slot != NO_SLOT) {
+      slots[free_slot].key = key;
+      slots[free_slot].value = PENDING | k;
+    }
+    // dst[i] is written after the evaluation, srcs[0] may be dst
+    missing_slots.push_back(free_slot);
+    waiting.push_back(Pixel { i, k });
+    for (int n = 0; n < nInputs; n++)
+      missing_inputs[n].push_back(values[n]);
+  }
+  lookups += width;
+
+  const int count = (int)missing_slots.size();
+  if (count > 0) {
+    results.resize(count);
+    const Word *missing_srcs[4];
+    for (int n = 0; n < nInputs; n++)
+      missing_srcs[n] = missing_inputs[n].data();
+    ctx.compute_row_word(results.data(), missing_srcs, nInputs, count, bits_per_pixel);
+
+    for (int k = 0; k < count; k++)
+      if (missing_slots[k] != NO_SLOT)
+        slots[missing_slots[k]].value = results[k];
+    for (const Pixel &pixel : waiting)
+      dst[pixel.x] = results[pixel.index];
+  }
+
+  // less than a quarter repeated: hashing costs more than it saves
+  if (++rows == TRIAL_ROWS && hits * 4 < lookups)
+    bypass = true;
+}
+
+} } } } }
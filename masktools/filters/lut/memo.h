@@ -0,0 +1,61 @@
+#ifndef __Mt_Lut_Memo_H__
+#define __Mt_Lut_Memo_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <vector>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Memo {
+
+// Remembered results of realtime mt_lutxyz and mt_lutxyza at 10-16 bits, v2.2.31
+// Flat areas, animation and masks repeat the same (x, y, z[, a]) values a lot. A Table lives for one plane of
+// one frame on the thread processing it: a small open addressing hash (64 KBytes, stays in the L2 cache) from
+// the packed input values to the result. Only the values not found are evaluated, once per row with
+// Context::compute_row_word; a value repeated within the row is evaluated once too (pending slots). When the first rows of a plane show few repeats (noise, gradients), the rest of
+// the plane is evaluated directly. Results are the same as with realtime evaluation.
+
+class Table {
+  static const int HASH_BITS = 12;
+  static const int MAX_PROBES = 8;
+  // rows evaluated before deciding whether the hash is worth it
+  static const int TRIAL_ROWS = 16;
+
+  struct Slot {
+    Uint64 key;
+    unsigned int value; // EMPTY: unused, PENDING | k: evaluated at the end of the row as missing value k
+  };
+  static const unsigned int EMPTY = 0xFFFFFFFF;
+  static const unsigned int PENDING = 0x80000000;
+  static const size_t NO_SLOT = (size_t)-1;
+
+  // a pixel of the current row, its result is missing value index
+  struct Pixel {
+    int x;
+    int index;
+  };
+
+  int nInputs;
+  int bits_per_pixel;
+  std::vector<Slot> slots;
+  int rows;
+  size_t lookups;
+  size_t hits;
+  bool bypass;
+
+  // missing values of the current row, every value once, and the pixels waiting for them
+  std::vector<Word> missing_inputs[4];
+  std::vector<size_t> missing_slots;
+  std::vector<Pixel> waiting;
+  std::vector<Word> results;
+
+public:
+  // nInputs: 3 or 4
+  Table(int nInputs, int bits_per_pixel);
+
+  // same as ctx.compute_row_word(dst, srcs, nInputs, width, bits_per_pixel), dst may be srcs[0]
+  void compute_row(Word *dst, const Word * const *srcs, int width, Parser::Context &ctx);
+};
+
+} } } } }
+
+#endif
@@ -0,0 +1,114 @@
+#include "neighbours.h"
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Neighbours {
+
+static void evaluate(Parser::Context &ctx, Byte *dst, const Byte * const *srcs, int nInputs, int width, int, bool)
+{
+  ctx.compute_row_byte(dst, srcs, nInputs, width);
+}
+
+static void evaluate(Parser::Context &ctx, Word *dst, const Word * const *srcs, int nInputs, int width, int bits_per_pixel, bool)
+{
+  ctx.compute_row_word(dst, srcs, nInputs, width, bits_per_pixel);
+}
+
+static void evaluate(Parser::Context &ctx, Float *dst, const Float * const *srcs, int nInputs, int width, int, bool chroma)
+{
+  ctx.compute_row_float(dst, srcs, nInputs, width, chroma);
+}
+
+template<typename T>
+static void process_t(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nInputs, int nWidth, int nHeight, int bits_per_pixel, bool chroma, const CrossPlane::Sources *sources, Parser::Context &ctx)
+{
+  const std::vector<Parser::Neighbour> &neighbours = ctx.get_neighbours();
+  const int count = (int)neighbours.size();
+
+  // gathered rows: one per input and vertical offset, horizontal offsets beyond the width read edge pixels only
+  struct Row {
+    int input;
+    int dy;
+    int plane; // other plane operand, resampled from sources
+  };
+  std::vector<Row> rows;
+  std::vector<int> row_of(count), dx_of(count);
+  int margin = 0;
+  int history = 0; // original x rows above the current one
+  for (int k = 0; k < count; k++) {
+    const Parser::Neighbour &nb = neighbours[k];
+    int r = 0;
+    while (r < (int)rows.size() && !(rows[r].input == nb.input && rows[r].dy == nb.dy && rows[r].plane == nb.plane))
+      r++;
+    if (r == (int)rows.size())
+      rows.push_back({ nb.input, nb.dy, nb.plane });
+    row_of[k] = r;
+    dx_of[k] = min(max(nb.dx, -nWidth), nWidth);
+    margin = max(margin, abs(dx_of[k]));
+    if (nb.input == 0 && nb.plane < 0)
+      history = max(history, min(-nb.dy, nHeight));
+  }
+
+  // without horizontal offsets the source rows are read in place
+  const int padded_width = nWidth + 2 * margin;
+  std::vector<T> buffer(margin > 0 ? rows.size() * padded_width : 0);
+  const int ring = history + 1;
+  std::vector<T> saved(history > 0 ? (size_t)ring * nWidth : 0);
+  // other planes: read from the unmodified sources, never in place
+  std::vector<T> resampled(sources != nullptr ? rows.size() * nWidth : 0);
+
+  const T *srcs[4 + Parser::MAX_NEIGHBOURS];
+  const T *gathered[4 + Parser::MAX_NEIGHBOURS];
+
+  for (int y = 0; y < nHeight; y++) {
+    T *dst = reinterpret_cast<T *>(pDst + y * nDstPitch);
+    // row y of x is overwritten below
+    if (history > 0)
+      memcpy(saved.data() + (size_t)(y % ring) * nWidth, dst, nWidth * sizeof(T));
+
+    for (int r = 0; r < (int)rows.size(); r++) {
+      if (rows[r].plane >= 0) {
+        T *row = resampled.data() + (size_t)r * nWidth;
+        CrossPlane::resample_row(reinterpret_cast<Byte *>(row), *sources, rows[r].input, rows[r].plane, y, nWidth, nHeight, bits_per_pixel);
+        gathered[r] = row;
+        continue;
+      }
+      const int input = rows[r].input;
+      const int y_src = min(max(y + rows[r].dy, 0), nHeight - 1);
+      const T *src = input == 0 && y_src < y
+        ? saved.data() + (size_t)(y_src % ring) * nWidth
+        : reinterpret_cast<const T *>(pSrcs[input] + y_src * nSrcPitches[input]);
+      if (margin == 0) {
+        gathered[r] = src;
+        continue;
+      }
+      T *padded = buffer.data() + (size_t)r * padded_width;
+      std::fill(padded, padded + margin, src[0]);
+      memcpy(padded + margin, src, nWidth * sizeof(T));
+      std::fill(padded + margin + nWidth, padded + padded_width, src[nWidth - 1]);
+      gathered[r] = padded + margin;
+    }
+
+    for (int k = 0; k < nInputs; k++)
+      srcs[k] = reinterpret_cast<const T *>(pSrcs[k] + y * nSrcPitches[k]);
+    for (int k = 0; k < count; k++)
+      srcs[nInputs + k] = gathered[row_of[k]] + dx_of[k];
+
+    evaluate(ctx, dst, srcs, nInputs, nWidth, bits_per_pixel, chroma);
+  }
+}
+
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nInputs, int nWidth, int nHeight, int bits_per_pixel, bool chroma, const CrossPlane::Sources *sources, Parser::Context &ctx)
+{
+  if (bits_per_pixel == 8)
+    process_t<Byte>(pDst, nDstPitch, pSrcs, nSrcPitches, nInputs, nWidth, nHeight, bits_per_pixel, chroma, sources, ctx);
+  else if (bits_per_pixel <= 16)
+    process_t<Word>(pDst, nDstPitch, pSrcs, nSrcPitches, nInputs, nWidth, nHeight, bits_per_pixel, chroma, sources, ctx);
+  else
+    process_t<Float>(pDst, nDstPitch, pSrcs, nSrcPitches, nInputs, nWidth, nHeight, bits_per_pixel, chroma, sources, ctx);
+}
+
+} } } } }
@@ -0,0 +1,26 @@
+#ifndef __Mt_Lut_Neighbours_H__
+#define __Mt_Lut_Neighbours_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include "crossplane.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Neighbours {
+
+// Relative pixel operands in realtime mt_lut, mt_lutxy, mt_lutxyz and mt_lutxyza, v2.2.31
+// "x x[-1,0] x[1,0] + + 3 /" or "x[0,-1] x[0,1] max y min" read the pixels around the current one, positions
+// outside of the plane are clamped to the nearest edge pixel. A formula over a neighbourhood is done in one pass
+// instead of a chain of mt_expand/mt_inpand/mt_lutxy filters over full frames.
+// The neighbour rows are gathered once per row: for each input and vertical offset the source row is copied
+// with its edge pixels repeated on both sides, every horizontal offset of it is a pointer into that copy.
+// The whole row is then evaluated by Context::compute_row_xxx.
+// The destination is input x: the original x rows still needed by negative vertical offsets are kept aside.
+// Other plane operands (x.Y) are gathered the same way, by CrossPlane::resample_row.
+
+// pSrcs, nSrcPitches: x, y, z, a planes, pSrcs[0] is pDst. 8-16 bits and float (chroma: float chroma plane).
+// sources: all planes of the inputs, needed by other plane operands only (nullptr otherwise)
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nInputs, int nWidth, int nHeight, int bits_per_pixel, bool chroma, const CrossPlane::Sources *sources, Parser::Context &ctx);
+
+} } } } }
+
+#endif
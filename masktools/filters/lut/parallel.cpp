@@ -0,0 +1,77 @@
+#include "parallel.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Parallel {
+
+// a thread is started for every this many table entries at most
+static const size_t MIN_ENTRIES_PER_THREAD = 1 << 16;
+// rows taken by a worker at once
+static const size_t MIN_ENTRIES_PER_CHUNK = 1 << 14;
+
+int compute_rows(const std::vector<Parser::Symbol> &expr, const String &scale_inputs, int clamp_float, int cpu_flags,
+  size_t nRows, size_t row_size, const RowFunction &compute_row)
+{
+  const size_t entries = nRows * row_size;
+  size_t nThreads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  nThreads = std::max<size_t>(std::min(nThreads, entries / MIN_ENTRIES_PER_THREAD), 1);
+  const size_t chunk = std::max<size_t>(MIN_ENTRIES_PER_CHUNK / std::max<size_t>(row_size, 1), 1);
+
+  std::atomic<size_t> next_row(0);
+  int last_row_error = Parser::Context::compute_error_t::CE_NONE;
+
+  // the first exception of a worker (bad_alloc), rethrown by the calling thread after the join
+  std::exception_ptr error;
+  std::mutex error_lock;
+
+  auto worker = [&]() {
+    try {
+      Parser::Context ctx(expr, scale_inputs, clamp_float);
+      ctx.SetCpuFlags(cpu_flags);
+      for (;;) {
+        const size_t first = next_row.fetch_add(chunk);
+        if (first >= nRows)
+          break;
+        const size_t last = std::min(first + chunk, nRows);
+        for (size_t row = first; row < last; row++)
+          compute_row(ctx, row);
+        // only one worker calculates the last row
+        if (last == nRows)
+          last_row_error = ctx.get_compute_error();
+      }
+    }
+    catch (...) {
+      std::lock_guard<std::mutex> lock(error_lock);
+      if (!error)
+        error = std::current_exception();
+      next_row.store(nRows); // the others stop after their chunk
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(nThreads); // no bad_alloc while threads are running
+  for (size_t i = 1; i < nThreads; i++) {
+    try {
+      threads.emplace_back(worker);
+    }
+    catch (const std::system_error &) {
+      break; // the others do the work
+    }
+  }
+  worker();
+  for (auto &t : threads)
+    t.join();
+  if (error)
+    std::rethrow_exception(error);
+
+  return last_row_error;
+}
+
+} } } } }
@@ -0,0 +1,25 @@
+#ifndef __Mt_Lut_Parallel_H__
+#define __Mt_Lut_Parallel_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <functional>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Parallel {
+
+// Lut tables built on all cores, v2.2.31
+// The table is calculated row by row (one Context::compute_lut_row_xxx call each). Rows are handed out in small
+// chunks to worker threads, every worker has its own Parser::Context. Rows are independent, the table is the same
+// as the one built by a single thread. Small tables are built by the calling thread only.
+// The returned compute error is the one after the last row, the same as with a sequential loop.
+// An exception of a worker (bad_alloc) is rethrown by the calling thread after all workers finished.
+
+typedef std::function<void(Parser::Context &ctx, size_t row)> RowFunction;
+
+// row_size: entries per row, only used to decide how many threads are worth starting
+int compute_rows(const std::vector<Filtering::Parser::Symbol> &expr, const String &scale_inputs, int clamp_float, int cpu_flags,
+  size_t nRows, size_t row_size, const RowFunction &compute_row);
+
+} } } } }
+
+#endif
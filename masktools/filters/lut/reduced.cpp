@@ -0,0 +1,132 @@
+#include "reduced.h"
+#include "parallel.h"
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Reduced {
+
+typedef void(Processor)(Byte *pDst, ptrdiff_t nDstPitch, const Byte **pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Byte *lut);
+
+static int get_used(int inputs, int *used)
+{
+  int dims = 0;
+  for (int k = 0; k < 4; k++)
+    if (inputs & (1 << k))
+      used[dims++] = k;
+  return dims;
+}
+
+size_t lut_size(int inputs, int bits_per_pixel)
+{
+  int used[4];
+  const int dims = get_used(inputs, used);
+  const int pixelsize = bits_per_pixel == 8 ? 1 : 2;
+  // a constant is still calculated as one full row
+  const int index_bits = (dims > 0 ? dims : 1) * bits_per_pixel;
+  if (index_bits + 1 >= (int)sizeof(size_t) * 8)
+    return 0;
+  return ((size_t)1 << index_bits) * pixelsize;
+}
+
+String layout(int inputs)
+{
+  int used[4];
+  const int dims = get_used(inputs, used);
+  String result;
+  for (int k = 0; k < dims; k++)
+    result += "xyza"[used[k]];
+  return result;
+}
+
+bool use_lut(int inputs, int nInputs, int bits_per_pixel, bool realtime, bool realtime_requested)
+{
+  if (bits_per_pixel > 16 || realtime_requested || inputs == (1 << nInputs) - 1)
+    return false;
+  const size_t size = lut_size(inputs, bits_per_pixel);
+  if (size == 0)
+    return false;
+  // smaller than the full table anyway
+  if (!realtime)
+    return true;
+  // the full table would be too large, this one may not
+  return size <= MAX_DEFAULT_LUT_SIZE;
+}
+
+Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int inputs, int nInputs, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error)
+{
+  Byte *lut = new Byte[lut_size(inputs, bits_per_pixel)];
+
+  int used[4];
+  const int dims = get_used(inputs, used);
+  // the last used input runs along the rows, the others are taken from the row number
+  const int ramp_input = dims > 0 ? used[dims - 1] : 0;
+  const size_t rows = (size_t)1 << (dims > 1 ? (dims - 1) * bits_per_pixel : 0);
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+
+  // rows are calculated by several threads (Lut::Parallel)
+  // problem if compute_error != Parser::Context::compute_error_t::CE_NONE
+  compute_error = Parallel::compute_rows(expr, scale_inputs, clamp_float, cpu_flags, rows, (size_t)1 << bits_per_pixel, [&](Parser::Context &ctx, size_t row) {
+    int values[4] = { 0, 0, 0, 0 }; // unused inputs are not read
+    size_t rest = row;
+    for (int k = dims - 2; k >= 0; k--) {
+      values[used[k]] = (int)(rest & max_pixel_value);
+      rest >>= bits_per_pixel;
+    }
+    if (bits_per_pixel == 8)
+      ctx.compute_lut_row_byte(lut + (row << 8), values, nInputs, ramp_input);
+    else
+      ctx.compute_lut_row_word(reinterpret_cast<Word *>(lut) + (row << bits_per_pixel), values, nInputs, ramp_input, bits_per_pixel);
+  });
+
+  return lut;
+}
+
+template<typename pixel_t, int bits_per_pixel, int dims>
+static void lut_t_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte **pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Byte *lut)
+{
+  const pixel_t *table = reinterpret_cast<const pixel_t *>(lut);
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  for (int y = 0; y < nHeight; y++)
+  {
+    for (int x = 0; x < nWidth; x++) {
+      size_t index = 0;
+      for (int k = 0; k < dims; k++) {
+        int pixel = reinterpret_cast<const pixel_t *>(pSrcs[k])[x];
+        if (sizeof(pixel_t) == 2 && bits_per_pixel != 16) pixel = min(pixel, max_pixel_value);
+        index = (index << bits_per_pixel) + pixel;
+      }
+      reinterpret_cast<pixel_t *>(pDst)[x] = table[index];
+    }
+    pDst += nDstPitch;
+    for (int k = 0; k < dims; k++)
+      pSrcs[k] += nSrcPitches[k];
+  }
+}
+
+#define REDUCED_PROCESSORS(pixel_t, bits) { &lut_t_c<pixel_t, bits, 0>, &lut_t_c<pixel_t, bits, 1>, &lut_t_c<pixel_t, bits, 2>, &lut_t_c<pixel_t, bits, 3> }
+
+static Processor *processors[5][4] = {
+  REDUCED_PROCESSORS(Byte, 8),
+  REDUCED_PROCESSORS(Word, 10),
+  REDUCED_PROCESSORS(Word, 12),
+  REDUCED_PROCESSORS(Word, 14),
+  REDUCED_PROCESSORS(Word, 16)
+};
+
+#undef REDUCED_PROCESSORS
+
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Byte *lut, int inputs, int bits_per_pixel)
+{
+  int used[4];
+  const int dims = get_used(inputs, used);
+  const Byte *srcs[4];
+  ptrdiff_t pitches[4];
+  for (int k = 0; k < dims; k++) {
+    srcs[k] = pSrcs[used[k]];
+    pitches[k] = nSrcPitches[used[k]];
+  }
+  // 8, 10, 12, 14, 16 bits; a table with all four inputs is never reduced
+  processors[(bits_per_pixel - 8) / 2][dims](pDst, nDstPitch, srcs, pitches, nWidth, nHeight, lut);
+}
+
+} } } } }
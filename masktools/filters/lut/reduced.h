@@ -0,0 +1,36 @@
+#ifndef __Mt_Lut_Reduced_H__
+#define __Mt_Lut_Reduced_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Reduced {
+
+// Tables over the inputs an expression really reads, v2.2.31
+// mt_lutxy, mt_lutxyz and mt_lutxyza ask the compiled expression which of x, y, z, a it uses
+// (Context::get_used_inputs). When some are not used, the table is built over the others only:
+// "x y max" in mt_lutxyz needs 64 KBytes instead of 16 MBytes, "x 2 *" a single 1D row.
+// The used inputs keep their x, y, z, a order in the index, e.g. y and a at 8 bits: lut[(y << 8) + a].
+// A constant expression reads lut[0].
+// inputs: bit mask of the used inputs, bit 0 = x, 1 = y, 2 = z, 3 = a
+
+// largest table built by default instead of realtime evaluation, same as a 12 bit mt_lutxy
+const size_t MAX_DEFAULT_LUT_SIZE = 32 * 1024 * 1024;
+
+// size in bytes, 0 when it does not fit into memory
+size_t lut_size(int inputs, int bits_per_pixel);
+
+// the used inputs as a table layout name for Lut::Cache, e.g. "ya"
+String layout(int inputs);
+
+// realtime: the filter's choice for its full table, realtime_requested: realtime=true was given explicitly
+bool use_lut(int inputs, int nInputs, int bits_per_pixel, bool realtime, bool realtime_requested);
+
+Byte *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int inputs, int nInputs, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags, int& compute_error);
+
+// pSrcs, nSrcPitches: x, y, z, a planes, only the used ones are read. pDst may be the same as pSrcs[0].
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Byte *lut, int inputs, int bits_per_pixel);
+
+} } } } }
+
+#endif
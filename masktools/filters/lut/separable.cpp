@@ -0,0 +1,96 @@
+#include "separable.h"
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Separable {
+
+typedef void(Processor)(Byte *pDst, ptrdiff_t nDstPitch, const Byte **pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Parser::SeparableTables &lut);
+
+bool use_lut(size_t table_size, int bits_per_pixel, bool realtime, bool realtime_requested)
+{
+  if (bits_per_pixel > 16 || realtime_requested)
+    return false;
+  return realtime || table_size == 0 || table_size > MAX_DIRECT_LUT_SIZE;
+}
+
+Parser::SeparableTables *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags)
+{
+  Parser::Context ctx(expr, scale_inputs, clamp_float);
+  ctx.SetCpuFlags(cpu_flags);
+  Parser::SeparableTables *lut = new Parser::SeparableTables;
+  if (!ctx.compute_separable(*lut, bits_per_pixel)) {
+    delete lut;
+    return nullptr;
+  }
+  return lut;
+}
+
+// rows are processed in chunks, combined values are kept in int
+template<typename pixel_t, int bits_per_pixel>
+static void separable_t_c(Byte *pDst, ptrdiff_t nDstPitch, const Byte **pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Parser::SeparableTables &lut)
+{
+  const int CHUNK = 256;
+  const int max_pixel_value = (1 << bits_per_pixel) - 1;
+  const Word *tail = lut.tail.data();
+  int combined[CHUNK];
+
+  for (int y = 0; y < nHeight; y++)
+  {
+    for (int x0 = 0; x0 < nWidth; x0 += CHUNK) {
+      const int n = min(CHUNK, nWidth - x0);
+      for (int k = 0; k < lut.nLeaves; k++) {
+        const pixel_t *src = reinterpret_cast<const pixel_t *>(pSrcs[k]) + x0;
+        const int *leaf = lut.leaves[k].data();
+        if (k == 0) {
+          for (int i = 0; i < n; i++)
+            combined[i] = leaf[min((int)src[i], max_pixel_value)];
+          continue;
+        }
+        switch (lut.op[k]) {
+        case Parser::Program::OP_ADD:
+          for (int i = 0; i < n; i++) combined[i] += leaf[min((int)src[i], max_pixel_value)];
+          break;
+        case Parser::Program::OP_SUB:
+          if (lut.reversed[k])
+            for (int i = 0; i < n; i++) combined[i] = leaf[min((int)src[i], max_pixel_value)] - combined[i];
+          else
+            for (int i = 0; i < n; i++) combined[i] -= leaf[min((int)src[i], max_pixel_value)];
+          break;
+        case Parser::Program::OP_MIN:
+          for (int i = 0; i < n; i++) combined[i] = min(combined[i], leaf[min((int)src[i], max_pixel_value)]);
+          break;
+        default: // OP_MAX
+          for (int i = 0; i < n; i++) combined[i] = max(combined[i], leaf[min((int)src[i], max_pixel_value)]);
+          break;
+        }
+      }
+      pixel_t *dst = reinterpret_cast<pixel_t *>(pDst) + x0;
+      for (int i = 0; i < n; i++)
+        dst[i] = (pixel_t)tail[combined[i] - lut.lo];
+    }
+    pDst += nDstPitch;
+    for (int k = 0; k < lut.nLeaves; k++)
+      pSrcs[k] += nSrcPitches[k];
+  }
+}
+
+static Processor *processors[5] = {
+  &separable_t_c<Byte, 8>,
+  &separable_t_c<Word, 10>,
+  &separable_t_c<Word, 12>,
+  &separable_t_c<Word, 14>,
+  &separable_t_c<Word, 16>
+};
+
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Parser::SeparableTables &lut, int bits_per_pixel)
+{
+  const Byte *srcs[4];
+  ptrdiff_t pitches[4];
+  for (int k = 0; k < lut.nLeaves; k++) {
+    srcs[k] = pSrcs[lut.input[k]];
+    pitches[k] = nSrcPitches[lut.input[k]];
+  }
+  processors[(bits_per_pixel - 8) / 2](pDst, nDstPitch, srcs, pitches, nWidth, nHeight, lut);
+}
+
+} } } } }
@@ -0,0 +1,28 @@
+#ifndef __Mt_Lut_Separable_H__
+#define __Mt_Lut_Separable_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Separable {
+
+// Chained 1D tables for separable expressions, v2.2.31
+// An expression like "x 3 * y 5 * + 8 /" is evaluated as tail[leaf_x[x] + leaf_y[y]]: one small integer table
+// per input and one over the combined values (Parser::Context::compute_separable). Used instead of a large
+// 2D/3D table or instead of realtime evaluation, results are identical.
+
+// tables up to this size are faster looked up directly
+const size_t MAX_DIRECT_LUT_SIZE = 256 * 1024;
+
+// table_size: the 2D/3D table (full or Reduced) the filter would use otherwise
+bool use_lut(size_t table_size, int bits_per_pixel, bool realtime, bool realtime_requested);
+
+// nullptr when the expression is not separable
+Parser::SeparableTables *calculateLut(const std::vector<Filtering::Parser::Symbol> &expr, int bits_per_pixel, String scale_inputs, int clamp_float, int cpu_flags);
+
+// pSrcs, nSrcPitches: x, y, z, a planes, only the used ones are read. pDst may be the same as pSrcs[0].
+void process(Byte *pDst, ptrdiff_t nDstPitch, const Byte * const *pSrcs, const ptrdiff_t *nSrcPitches, int nWidth, int nHeight, const Parser::SeparableTables &lut, int bits_per_pixel);
+
+} } } } }
+
+#endif
@@ -0,0 +1,172 @@
+#include "stats.h"
+#include <algorithm>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Stats {
+
+class Filter {
+public:
+  struct Plane {
+    bool used;
+    String expression;
+    String path;
+    Parser::ContextPool *contexts;
+    std::atomic<uint64_t> frames;
+    std::atomic<uint64_t> pixels;
+    std::atomic<uint64_t> nanoseconds;
+  };
+
+  String name;
+  Plane planes[4];
+
+  Filter(const String &name) : name(name) {
+    for (auto &p : planes) {
+      p.used = false;
+      p.contexts = nullptr;
+      p.frames = 0;
+      p.pixels = 0;
+      p.nanoseconds = 0;
+    }
+  }
+};
+
+// function statics: filters may be created while other static objects are initialized
+static std::atomic<bool> &profiling()
+{
+  static std::atomic<bool> flag(false);
+  return flag;
+}
+
+static std::mutex &registry_lock()
+{
+  static std::mutex lock;
+  return lock;
+}
+
+static std::vector<Filter *> &registry()
+{
+  static std::vector<Filter *> filters;
+  return filters;
+}
+
+// guarded by registry_lock
+static int &created()
+{
+  static int count = 0;
+  return count;
+}
+
+void set_enabled(bool enable)
+{
+  profiling() = enable;
+}
+
+bool enabled()
+{
+  return profiling();
+}
+
+Filter *create(const char *name)
+{
+  if (!profiling())
+    return nullptr;
+  std::lock_guard<std::mutex> guard(registry_lock());
+  Filter *stats = new Filter(String(name) + " #" + std::to_string(++created()));
+  registry().push_back(stats);
+  return stats;
+}
+
+void destroy(Filter *stats)
+{
+  if (!stats)
+    return;
+  std::lock_guard<std::mutex> guard(registry_lock());
+  std::vector<Filter *> &filters = registry();
+  filters.erase(std::remove(filters.begin(), filters.end(), stats), filters.end());
+  delete stats;
+}
+
+void set_plane(Filter *stats, int plane, const String &expression, const String &path, Parser::ContextPool *contexts)
+{
+  if (!stats)
+    return;
+  Filter::Plane &p = stats->planes[plane];
+  p.used = true;
+  p.expression = expression;
+  p.path = path;
+  p.contexts = contexts;
+  if (contexts)
+    contexts->EnableProfile(true);
+}
+
+Timer::~Timer()
+{
+  if (!stats)
+    return;
+  const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start);
+  Filter::Plane &p = stats->planes[plane];
+  p.frames++;
+  p.pixels += pixels;
+  p.nanoseconds += (uint64_t)elapsed.count();
+}
+
+static String format_plane(const Filter &stats, int plane, const Filter::Plane &p)
+{
+  char buf[256];
+  snprintf(buf, sizeof(buf), "%s plane %d \"", stats.name.c_str(), plane);
+  String line = buf + p.expression + "\": " + p.path;
+  snprintf(buf, sizeof(buf), ", %llu frames, %llu pixels, %.1f ms", (unsigned long long)p.frames, (unsigned long long)p.pixels, p.nanoseconds / 1e6);
+  line += buf;
+  if (!p.contexts)
+    return line;
+
+  const Parser::Context::Profile profile = p.contexts->get_profile();
+  for (int k = 0; k < Parser::Context::Profile::PATH_COUNT; k++) {
+    if (profile.blocks[k] == 0)
+      continue;
+    snprintf(buf, sizeof(buf), ", %s %llu blocks", Parser::Context::Profile::path_name(k), (unsigned long long)profile.blocks[k]);
+    line += buf;
+  }
+  String ops;
+  if (profile.int_ops > 0) {
+    snprintf(buf, sizeof(buf), " int %llu", (unsigned long long)profile.int_ops);
+    ops += buf;
+  }
+  for (int k = 0; k <= Parser::Program::OP_SCALE; k++) {
+    if (profile.ops[k] == 0)
+      continue;
+    snprintf(buf, sizeof(buf), "%s %s %llu", ops.empty() ? "" : ",", Parser::Context::Profile::op_name(k), (unsigned long long)profile.ops[k]);
+    ops += buf;
+  }
+  if (!ops.empty())
+    line += ", ops" + ops;
+  return line;
+}
+
+String report(bool reset)
+{
+  std::lock_guard<std::mutex> guard(registry_lock());
+  String result;
+  for (Filter *stats : registry()) {
+    for (int i = 0; i < 4; i++) {
+      Filter::Plane &p = stats->planes[i];
+      if (!p.used)
+        continue;
+      result += format_plane(*stats, i, p) + "\n";
+      if (reset) {
+        p.frames = 0;
+        p.pixels = 0;
+        p.nanoseconds = 0;
+        if (p.contexts)
+          p.contexts->clear_profile();
+      }
+    }
+  }
+  return result;
+}
+
+} } } } }
@@ -0,0 +1,58 @@
+#ifndef __Mt_Lut_Stats_H__
+#define __Mt_Lut_Stats_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Stats {
+
+// Expression profiling, mt_exprstats(), v2.2.31
+// mt_exprstats(true) switches profiling on for the mt_lut, mt_lutxy, mt_lutxyz and mt_lutxyza filters created
+// afterwards (like mt_lutcache), mt_exprstats(false) off again. Profiled filters count per processed plane:
+// - the path taken: table, table over some inputs (e.g. "table xz"), separable, lazy table, realtime,
+//   approx (float_tolerance) or expr (use_expr, the frames are processed by Expr then, not counted here)
+// - frames, pixels and wall time of process()
+// - realtime: the evaluated blocks per evaluator (double, int, float, interpreter) and the instructions executed
+//   by opcode, from the Parser::Context counters (Context::Profile)
+// mt_exprstats() returns the report of the living profiled filters, one line per plane, e.g.
+//   mt_lutxy #1 plane 0 "x y - abs": realtime, 100 frames, 207360000 pixels, 85.2 ms, int 6480000 blocks, ops int 497664000
+// mt_exprstats(reset=true) clears the counters after the report. Within ScriptClip the report shows the state at
+// the current frame. Profiling off costs one pointer check per plane.
+
+void set_enabled(bool enable);
+bool enabled();
+
+class Filter;
+
+// a profiled filter instance, nullptr when profiling is off. name: e.g. "mt_lutxy"
+Filter *create(const char *name);
+// unregisters it, before its ContextPools are deleted
+void destroy(Filter *stats);
+
+// expression: as given to the filter, contexts: realtime evaluation (profiling is enabled on it), or nullptr
+void set_plane(Filter *stats, int plane, const String &expression, const String &path, Parser::ContextPool *contexts);
+
+String report(bool reset);
+
+// times a process() call, nothing when stats is nullptr
+class Timer {
+  Filter *stats;
+  int plane;
+  int pixels;
+  std::chrono::steady_clock::time_point start;
+public:
+  Timer(Filter *stats, int plane, int pixels) : stats(stats), plane(plane), pixels(pixels) {
+    if (stats)
+      start = std::chrono::steady_clock::now();
+  }
+  ~Timer();
+  Timer(const Timer &) = delete;
+  Timer &operator=(const Timer &) = delete;
+};
+
+} } } } }
+
+#endif
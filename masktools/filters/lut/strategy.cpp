@@ -0,0 +1,155 @@
+#include "strategy.h"
+#include "crossplane.h"
+#include "reduced.h"
+#include <algorithm>
+#include <cstdio>
+#include <limits>
+#include <thread>
+
+using namespace Filtering;
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Strategy {
+
+// one instruction on one pixel by the JIT compiled Expr (float, 8 pixels per instruction)
+static const double EXPR_OP_COST = 0.3;
+// creating the Expr clip (parse and compile), once
+static const double EXPR_SETUP_COST = 1e6;
+// getting a frame from the Expr clip
+static const double EXPR_FRAME_COST = 1e4;
+// building a lazy table entry: gathered and evaluated in short rows
+static const double LAZY_ENTRY_COST = 2.0;
+// lookup and check of a lazy table entry
+static const double LAZY_LOOKUP_COST = 2.0;
+// share of the pixels of a frame which are new pairs for the lazy table, after the first frame
+static const double LAZY_NEW_PAIRS = 0.05;
+
+// a lookup in a table of this many bytes
+static double lookup_cost(size_t table_size)
+{
+  if (table_size <= 256 * 1024)
+    return 0.5;
+  if (table_size <= 8 * 1024 * 1024)
+    return 1.5;
+  return 4.0;
+}
+
+const char *name(Choice choice)
+{
+  switch (choice) {
+  case TABLE: return "table";
+  case LAZY_TABLE: return "lazy table";
+  case REALTIME: return "realtime";
+  case EXPR: return "expr";
+  default: return "";
+  }
+}
+
+String Decision::describe() const
+{
+  String result = String(name(choice)) + " (";
+  bool first = true;
+  for (int k = 0; k < CHOICE_COUNT; k++) {
+    if (cost[k] < 0)
+      continue;
+    char buf[64];
+    snprintf(buf, sizeof(buf), "%s%s %.3g", first ? "" : ", ", name((Choice)k), cost[k]);
+    result += buf;
+    first = false;
+  }
+  return result + ")";
+}
+
+bool measure(Workload &workload, const std::vector<Parser::Symbol> &expr, const String &scale_inputs, int clamp_float)
+{
+  Parser::Context ctx(expr, scale_inputs, clamp_float);
+  if (!ctx.check())
+    return false;
+  workload.program_length = max(workload.program_length, ctx.get_program_length(workload.bits_per_pixel));
+  if (workload.bits_per_pixel <= 16)
+    workload.used_inputs |= ctx.get_used_inputs(workload.bits_per_pixel) & ((1 << workload.nInputs) - 1);
+  else
+    workload.used_inputs = (1 << workload.nInputs) - 1;
+  if (!ctx.get_neighbours().empty())
+    workload.neighbours = true;
+  if (CrossPlane::last_plane(ctx.get_neighbours()) >= 0)
+    workload.other_planes = true;
+  return true;
+}
+
+bool add_planes(Workload &workload, Parser::Parser &parser, const Parameters &parameters, const Operator operators[4], int planes, const int pixels[4], const String &scale_inputs, int clamp_float)
+{
+  static const char *expr_strs[] = { "yExpr", "uExpr", "vExpr", "aExpr" };
+  std::vector<String> different;
+  for (int i = 0; i < planes; i++) {
+    if (operators[i] != PROCESS)
+      continue;
+    String expr;
+    if (parameters[expr_strs[i]].is_defined())
+      expr = parameters[expr_strs[i]].toString();
+    else if (!parameters["expr"].undefinedOrEmptyString())
+      expr = parameters["expr"].toString();
+    if (expr.empty())
+      continue;
+    workload.pixels += pixels[i];
+    if (std::find(different.begin(), different.end(), expr) != different.end())
+      continue;
+    different.push_back(expr);
+    workload.expressions++;
+    parser.parse_strict(expr, Parser::SYMBOL_SEPARATORS);
+    if (parser.getErrorPos() >= 0 || !measure(workload, parser.getExpression(), scale_inputs, clamp_float))
+      return false;
+  }
+  return true;
+}
+
+Decision choose(const Workload &workload)
+{
+  Decision decision;
+  const double ops = max(workload.program_length, 1);
+  const double frames = max(workload.frames, 1);
+  const double pixels = workload.pixels * frames;
+  const int expressions = max(workload.expressions, 1);
+  const double threads = max((int)std::thread::hardware_concurrency(), 1);
+
+  const bool table_possible = workload.bits_per_pixel <= 16 && !workload.neighbours;
+  decision.table_size = table_possible ? Reduced::lut_size(workload.used_inputs, workload.bits_per_pixel) : 0;
+  double entries = 0;
+  if (decision.table_size > 0) {
+    int dims = 0;
+    for (int k = 0; k < 4; k++)
+      dims += (workload.used_inputs >> k) & 1;
+    entries = (double)((size_t)1 << (max(dims, 1) * workload.bits_per_pixel));
+  }
+
+  for (int k = 0; k < CHOICE_COUNT; k++)
+    decision.cost[k] = -1;
+
+  // a quarter of the address space at most on 32 bit
+  const size_t max_table_size = std::min<size_t>(MAX_TABLE_SIZE, std::numeric_limits<size_t>::max() / 4 / expressions);
+  if (workload.allowed[TABLE] && decision.table_size > 0 && decision.table_size <= max_table_size)
+    decision.cost[TABLE] = expressions * entries * ops / threads + pixels * lookup_cost(decision.table_size);
+
+  if (workload.allowed[LAZY_TABLE] && table_possible) {
+    const double evaluated = std::min(entries > 0 ? entries : pixels, workload.pixels * (1 + LAZY_NEW_PAIRS * (frames - 1)));
+    decision.cost[LAZY_TABLE] = expressions * evaluated * ops * LAZY_ENTRY_COST + pixels * LAZY_LOOKUP_COST;
+  }
+
+  if (workload.allowed[REALTIME])
+    decision.cost[REALTIME] = pixels * ops;
+
+  if (workload.allowed[EXPR] && !workload.other_planes)
+    decision.cost[EXPR] = EXPR_SETUP_COST + pixels * ops * EXPR_OP_COST + frames * EXPR_FRAME_COST;
+
+  // realtime is always possible
+  decision.choice = REALTIME;
+  double best = -1;
+  for (int k = 0; k < CHOICE_COUNT; k++) {
+    if (decision.cost[k] >= 0 && (best < 0 || decision.cost[k] < best)) {
+      best = decision.cost[k];
+      decision.choice = (Choice)k;
+    }
+  }
+  return decision;
+}
+
+} } } } }
@@ -0,0 +1,68 @@
+#ifndef __Mt_Lut_Strategy_H__
+#define __Mt_Lut_Strategy_H__
+
+#include "../../common/base/filter.h"
+#include "../../../common/parser/parser.h"
+
+namespace Filtering { namespace MaskTools { namespace Filters { namespace Lut { namespace Strategy {
+
+// Automatic choice of the evaluation mode, use_expr=4, v2.2.31
+// mt_lut, mt_lutxy, mt_lutxyz and mt_lutxyza estimate the cost of every mode over the whole clip and use the
+// cheapest one:
+// - table: building it (table entries x program length, on all cores) plus one lookup per pixel. Lookups into
+//   tables larger than the CPU caches cost more. Tables over MAX_TABLE_SIZE are not considered.
+// - lazy table (mt_lutxy 14 and 16 bits): the pairs seen are evaluated once, one lookup per pixel
+// - realtime: pixels x program length, every frame
+// - Expr offload: pixels x program length at the lower cost of the JIT compiled Expr, plus creating the Expr clip
+// The estimates are in relative units, one program instruction on one pixel by the realtime evaluator is 1.
+// Reading all expressions costs one parse and compile each, the result is the same as when the chosen mode is
+// given explicitly.
+
+enum Choice {
+  TABLE,
+  LAZY_TABLE,
+  REALTIME,
+  EXPR,
+  CHOICE_COUNT
+};
+
+// tables larger than this are never chosen
+const size_t MAX_TABLE_SIZE = 1024 * 1024 * 1024;
+
+struct Workload {
+  int nInputs;         // of the filter
+  int used_inputs;     // bit mask of the inputs the expressions read, like Context::get_used_inputs
+  int bits_per_pixel;
+  int program_length;  // instructions of the longest compiled expression
+  int expressions;     // different tables needed
+  bool neighbours;     // relative pixel operands (x[-1,0]): no table
+  bool other_planes;   // other plane operands (x.Y): no table and no Expr
+  double pixels;       // processed pixels per frame, all planes
+  int frames;
+  bool allowed[CHOICE_COUNT];
+
+  Workload() : nInputs(0), used_inputs(0), bits_per_pixel(8), program_length(0), expressions(0), neighbours(false), other_planes(false), pixels(0), frames(0), allowed() { }
+};
+
+struct Decision {
+  Choice choice;
+  double cost[CHOICE_COUNT]; // estimated cost over the clip, negative when the mode is not possible
+  size_t table_size;         // bytes per table
+  String describe() const;   // e.g. "table (table 2.1e+07, realtime 8.6e+09, expr 2.4e+09)"
+};
+
+const char *name(Choice choice);
+
+// adds an expression: program_length, used_inputs and neighbours cover all of the added ones
+// false when the expression does not compile
+bool measure(Workload &workload, const std::vector<Filtering::Parser::Symbol> &expr, const String &scale_inputs, int clamp_float);
+
+// adds the expressions of the processed planes (yExpr..aExpr or expr), pixels: per plane, planes: plane count
+// false when one does not parse or compile, the filter reports it then
+bool add_planes(Workload &workload, Parser::Parser &parser, const Parameters &parameters, const Operator operators[4], int planes, const int pixels[4], const String &scale_inputs, int clamp_float);
+
+Decision choose(const Workload &workload);
+
+} } } } }
+
+#endif
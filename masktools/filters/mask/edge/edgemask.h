@@ -512,24 +512,23 @@ public:
            {
              Float coefficient;
 
-             if (!coeffs.size())
+             if ((int)coeffs.size() <= i)
              {
                error = "invalid mode";
                return;
              }
 
-             print(LOG_DEBUG, "%i\n", coeffs.size());
-             matrix_f[i] = coefficient = static_cast<Float>(coeffs.front().getValue(0, 0, 0));
+             print(LOG_DEBUG, "%i\n", (int)coeffs.size() - i);
+             matrix_f[i] = coefficient = static_cast<Float>(coeffs[i].getValue(0, 0, 0));
 
              nNegative = nNegative + (coefficient < 0 ? -coefficient : 0);
              nPositive = nPositive + (coefficient > 0 ? +coefficient : 0);
-             coeffs.pop_front();
            }
            Float nSum = max<Float>(nNegative, nPositive);
 
            // when there is a 10th value, it overwrites max(possum, negsum)
-           if (coeffs.size())
-             nSum = static_cast<Float>(coeffs.front().getValue(0, 0, 0));
+           if (coeffs.size() > 9)
+             nSum = static_cast<Float>(coeffs[9].getValue(0, 0, 0));
 
            /* disable asm if sum of coefficients indicates a risk of overflow */
 #if 0
@@ -544,7 +543,7 @@ public:
            {
              if ((1 << i) >= nSum)
              {
-               if (!coeffs.size())
+               if (coeffs.size() <= 9)
                  nSum = (Float)(1 << i);
                break;
              }
@@ -570,23 +569,22 @@ public:
            {
              Short coefficient;
 
-             if (!coeffs.size())
+             if ((int)coeffs.size() <= i)
              {
                error = "invalid mode";
                return;
              }
 
-             print(LOG_DEBUG, "%i\n", coeffs.size());
-             matrix[i] = coefficient = static_cast<Short>(coeffs.front().getValue(0, 0, 0));
+             print(LOG_DEBUG, "%i\n", (int)coeffs.size() - i);
+             matrix[i] = coefficient = static_cast<Short>(coeffs[i].getValue(0, 0, 0));
 
              nNegative += coefficient < 0 ? -coefficient : 0;
              nPositive += coefficient > 0 ? +coefficient : 0;
-             coeffs.pop_front();
            }
            int nSum = max<int>(nNegative, nPositive);
 
-           if (coeffs.size())
-             nSum = static_cast<Short>(coeffs.front().getValue(0, 0, 0));
+           if (coeffs.size() > 9)
+             nSum = static_cast<Short>(coeffs[9].getValue(0, 0, 0));
 
            /* disable asm if sum of coefficients indicates a risk of overflow */
            if (nNegative > 128 || nPositive > 128)
@@ -601,7 +599,7 @@ public:
            {
              if ((1 << i) >= nSum)
              {
-               if (!coeffs.size())
+               if (coeffs.size() <= 9)
                  nSum = 1 << i;
                break;
              }
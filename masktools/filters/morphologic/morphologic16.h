@@ -44,11 +44,8 @@ protected:
       coordinates_list = new int[coordinates_count];
       int i = 0;
 
-      while ( !coeffs.empty() )
-      {
-         coordinates_list[i++] = int( coeffs.front().getValue(0, 0, 0) );
-         coeffs.pop_front();
-      }
+      for (auto &coeff : coeffs)
+         coordinates_list[i++] = int( coeff.getValue(0, 0, 0) );
    }
 
 public:
@@ -21,6 +21,8 @@
 #include "../../../common/utils/utils.h"
 #include "../../helpers/forms/forms.h"
 #include "../../helpers/parser/spirit.h"
+#include "../../filters/lut/diskcache.h"
+#include "../../filters/lut/stats.h"
 
 using namespace Filtering;
 using namespace Filtering::MaskTools::Helpers::Forms;
@@ -56,6 +58,24 @@ AVSValue __cdecl CreateGenericForm(AVSValue args, void *user_data, IScriptEnviro
    return AVSValue((new String(bf(args[0].AsInt(-1), args[1].AsInt(-1), args[2].AsInt(1), args[3].AsInt(1), args[4].AsBool(true))))->c_str()); /* grrrrr -> memory leak */
 }
 
+// v2.2.31: mt_lutcache("path"): directory of the lut disk cache for the filters created afterwards, "": off
+AVSValue __cdecl SetLutCache(AVSValue args, void *user_data, IScriptEnvironment *env)
+{
+   UNUSED(user_data); UNUSED(env);
+   MaskTools::Filters::Lut::DiskCache::set_directory(args[0].AsString(""));
+   return AVSValue();
+}
+
+// v2.2.31: mt_exprstats(): report of the profiled lut filters, enable: profiling of the filters created afterwards
+AVSValue __cdecl ExprStats(AVSValue args, void *user_data, IScriptEnvironment *env)
+{
+   UNUSED(user_data);
+   if (args[0].Defined())
+      MaskTools::Filters::Lut::Stats::set_enabled(args[0].AsBool());
+   const String report = MaskTools::Filters::Lut::Stats::report(args[1].AsBool(false));
+   return AVSValue(env->SaveString(report.c_str()));
+}
+
 template<Form rf>
 static void DeclareRadiusForm(const String &name, IScriptEnvironment *env)
 {
@@ -93,6 +113,8 @@ void DeclareHelpers(IScriptEnvironment* env)
    DeclareGenericForm<LosangeToString>("mt_freelosange", env);
    DeclareStringConverter<Converter>("mt_polish", env);
    DeclareStringConverter<Infix>("mt_infix", env);
+   env->AddFunction("mt_lutcache", "[path]s", SetLutCache, NULL);
+   env->AddFunction("mt_exprstats", "[enable]b[reset]b", ExprStats, NULL);
 }
 
 } } } }
\ No newline at end of file